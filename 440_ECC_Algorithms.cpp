@@ -4,10 +4,22 @@
 #include <iostream>
 #include <iomanip>
 #include <memory>
+#include <cstring>
 #include <functional>
+#include <vector>
+#include <sstream>
 #include "Chunk.h"
 #include "ParityBit.h"
 #include "HammingCode.h"
+#include "HsiaoCode.h"
+#include "ReedSolomon.h"
+#include "BCHCode.h"
+#include "CrcCheck.h"
+#include "InterleavedCode.h"
+#include "ChipkillCode.h"
+#include "LinearCode.h"
+#include "FaultInjection.h"
+#include "ErrorPatternAnalyzer.h"
 
 using std::cout;
 using std::endl;
@@ -26,7 +38,7 @@ void identify_corrupt_bits(size_t cout_width, const BitStream<encoded_bits>& ori
         auto c = original.test(idx) != maybeCorrupt.test(idx) ? "^" : " "; // MSB to LSB ordering
         cout << c;
     }
-    cout << std::string(" ", cout_width - encoded_bits) << "corrupted bits\n";
+    cout << std::string(cout_width - encoded_bits, ' ') << "corrupted bits\n";
 }
 
 
@@ -63,7 +75,7 @@ void demo_parity(uint8_t* data,
     auto rbs = BitStream<data_bits>(result.decoded_bits);
 
     // store in new buffer
-    const auto tmpBuf = std::shared_ptr<uint8_t[]>(new uint8_t[(data_bits + 8) / 8], std::default_delete<uint8_t>());
+    const auto tmpBuf = std::shared_ptr<uint8_t[]>(new uint8_t[(data_bits + 8) / 8], std::default_delete<uint8_t[]>());
     memset(tmpBuf.get(), 0, (data_bits + 8) / 8);
 
     rbs.to_buffer(tmpBuf.get());
@@ -146,7 +158,7 @@ void demo_hamming(uint8_t* data,
     auto rbs = BitStream<data_bits>(result.decoded_bits);
 
     // store in new buffer
-    const auto tmpBuf = std::shared_ptr<uint8_t[]>(new uint8_t[(data_bits + 8) / 8], std::default_delete<uint8_t>());
+    const auto tmpBuf = std::shared_ptr<uint8_t[]>(new uint8_t[(data_bits + 8) / 8], std::default_delete<uint8_t[]>());
     memset(tmpBuf.get(), 0, (data_bits + 8) / 8);
 
     rbs.to_buffer(tmpBuf.get());
@@ -215,7 +227,7 @@ void example_parity_1()
 
     // no corruption
     demo_parity<data_bits>(reinterpret_cast<uint8_t*>(&val), print_data<char>, 
-        [](Chunk_t& memory) {
+        [](Chunk_t&) {
             // nop
         });
 }
@@ -262,7 +274,7 @@ void example_hamming_1()
 
         // print function
         print_data<char>,
-        [](Hamming_t::Chunk_t& memory)
+        [](Hamming_t::Chunk_t&)
     {
         // nop
     });
@@ -326,55 +338,207 @@ void example_hamming_4()
 }
 
 
-void hamming();
+template <class Strategy, class ErrorModel>
+void run_fault_injection(ThreadPool& pool, const char* name, const ErrorModel& model, uint64_t trials)
+{
+    const auto result = FaultInjector<Strategy>(pool).run(model, trials);
+
+    cout << std::left << setw(16) << name << setw(10) << model.name() << std::right << std::scientific << std::setprecision(2)
+         << setw(11) << model.p
+         << setw(11) << result.corrected_rate
+         << setw(11) << result.detected_rate
+         << setw(11) << result.miscorrection_rate
+         << setw(11) << result.undetected_rate
+         << setw(11) << result.residual_rate << " +- " << result.residual_std_error
+         << std::defaultfloat << std::setprecision(6) << endl;
+}
 
-int main() 
+
+// Monte Carlo estimates of what each code does under random errors (per codeword rates)
+void fault_injection()
 {
-    example_parity_1();
-    example_parity_2();
-    example_parity_3();
+    ThreadPool pool;
+    const uint64_t trials = 200000; // per number of errors in a codeword
 
-    example_hamming_1();
-    example_hamming_2();
-    example_hamming_3();
-    example_hamming_4();
+    cout << "---------- Fault injection -------------\n";
+    cout << std::left << setw(16) << "Code" << setw(10) << "Model" << std::right
+         << setw(11) << "p" << setw(11) << "corrected" << setw(11) << "detected"
+         << setw(11) << "miscorr" << setw(11) << "undetected" << setw(11) << "residual" << endl;
 
-    return 0;
+    for (const auto p : { 1e-3, 1e-6 })
+    {
+        run_fault_injection<ParityBit<64>>(pool, "ParityBit<64>", BitFlipModel(p), trials);
+        run_fault_injection<Crc32cCheck<64>>(pool, "Crc32cCheck<64>", BitFlipModel(p), trials);
+        run_fault_injection<HammingCode<64>>(pool, "HammingCode<64>", BitFlipModel(p), trials);
+        run_fault_injection<HsiaoCode<64>>(pool, "HsiaoCode<64>", BitFlipModel(p), trials);
+        run_fault_injection<BCHCode<64, 2>>(pool, "BCHCode<64, 2>", BitFlipModel(p), trials);
+        run_fault_injection<HammingCode<64>>(pool, "HammingCode<64>", BurstModel(p, 4), trials);
+        run_fault_injection<ReedSolomon<10, 8>>(pool, "RS(10, 8)", BurstModel(p, 4), trials);
+        run_fault_injection<HammingCode<64>>(pool, "HammingCode<64>", StuckAtModel(p, false), trials);
+        run_fault_injection<HsiaoCode<128>>(pool, "HsiaoCode<128>", DeviceFailureModel(p, 4), trials);
+        run_fault_injection<ChipkillCode<4>>(pool, "ChipkillCode<4>", DeviceFailureModel(p, 4), trials);
+        run_fault_injection<ChipkillCode<8>>(pool, "ChipkillCode<8>", DeviceFailureModel(p, 8), trials);
+    }
+
+    cout << "---------- end fault injection -------- \n" << endl;
+}
+
+
+template <class Strategy>
+void run_burst_tolerance(ThreadPool& pool, size_t depth, const std::vector<size_t>& lengths, uint64_t trials)
+{
+    std::vector<double> corrected, silent;
+
+    // one burst per group: only the first stratum is sampled, its rates are what a burst does
+    for (const auto length : lengths)
+    {
+        const auto stratum = FaultInjector<Strategy>(pool).run(BurstModel(1e-6, length), trials, 1).strata[0];
+
+        corrected.push_back(100.0 * (stratum.clean + stratum.corrected) / stratum.trials);
+        silent.push_back(100.0 * (stratum.miscorrected + stratum.undetected) / stratum.trials);
+    }
+
+    cout << std::fixed << std::setprecision(1) << std::right << "depth " << setw(2) << depth << "  corrected";
+
+    for (const auto rate : corrected)
+        cout << setw(7) << rate;
+
+    cout << "\n          silent   ";
+
+    for (const auto rate : silent)
+        cout << setw(7) << rate;
+
+    cout << std::defaultfloat << std::setprecision(6) << std::left << endl;
 }
 
 
-// used to test Hamming code 
-void hamming()
+// HammingCode<64> codewords interleaved to increasing depths, each group hit by one burst:
+// % of groups that decode to the right data, and % that silently decode to the wrong data
+void burst_tolerance()
 {
-    int i = 0b0000000001011011;
+    ThreadPool pool;
+    const uint64_t trials = 20000;
+    const std::vector<size_t> lengths = { 1, 2, 3, 4, 8, 16, 32, 64 };
 
-    const auto size_bits = 7; // just the 1011011 part
+    cout << "---------- Burst tolerance -------------\n";
+    cout << "HammingCode<64>, one burst per group of interleaved codewords (% of groups)\n";
+    cout << "burst length:      ";
 
-    typedef HammingCode<size_bits> Hamming_t;
-    typedef Chunk<size_bits, Hamming_t::TOTAL_BIT_COUNT> Chunk_t;
+    for (const auto length : lengths)
+        cout << std::right << setw(7) << length;
 
-    const auto hammingStrategy = std::dynamic_pointer_cast<Chunk_t::StrategyPtr::element_type>(std::make_shared<Hamming_t>());
+    cout << std::left << endl;
 
+    run_burst_tolerance<HammingCode<64>>(pool, 1, lengths, trials);
+    run_burst_tolerance<InterleavedCode<HammingCode<64>, 2>>(pool, 2, lengths, trials);
+    run_burst_tolerance<InterleavedCode<HammingCode<64>, 4>>(pool, 4, lengths, trials);
+    run_burst_tolerance<InterleavedCode<HammingCode<64>, 8>>(pool, 8, lengths, trials);
+    run_burst_tolerance<InterleavedCode<HammingCode<64>, 16>>(pool, 16, lengths, trials);
+    run_burst_tolerance<InterleavedCode<HammingCode<64>, 32>>(pool, 32, lengths, trials);
 
-    for (size_t corruptIdx = 0; corruptIdx < Hamming_t::TOTAL_BIT_COUNT - 1; ++corruptIdx) {
-        auto chunk = Chunk_t(hammingStrategy);
-        auto bs = BitStream<size_bits>::from_buffer(reinterpret_cast<const uint8_t*>(&i), size_bits);
+    cout << "---------- end burst tolerance -------- \n" << endl;
+}
 
-        chunk.store(bs);
-        chunk.corrupt(corruptIdx);
-        chunk.corrupt((corruptIdx + 1) % size_bits);
 
-        const auto result = chunk.retrieve();
-        auto rbs = BitStream<size_bits>(result.decoded_bits);
+template <class Strategy>
+void run_error_patterns(ThreadPool& pool, const char* name, const Strategy& strategy = Strategy())
+{
+    const auto report = ErrorPatternAnalyzer<Strategy>(pool, strategy).analyze();
+
+    cout << name << " (every pattern checked against " << report.data_words_checked << " data words, "
+         << report.linearity_violations << " linearity violations)\n";
+
+    cout << std::right << setw(8) << "errors" << setw(10) << "patterns" << setw(11) << "corrected" << setw(10) << "detected"
+         << setw(10) << "miscorr" << setw(12) << "undetected" << endl;
+
+    for (const auto& row : report.rows)
+    {
+        cout << setw(8) << row.weight << setw(10) << row.patterns
+             << setw(11) << row.outcomes[OUTCOME_CORRECTED] << setw(10) << row.outcomes[OUTCOME_DETECTED]
+             << setw(10) << row.outcomes[OUTCOME_MISCORRECTED] << setw(12) << row.outcomes[OUTCOME_UNDETECTED] << endl;
+    }
 
-        // final result
-        int j = 0;
+    if (!report.codeword_weights.empty())
+    {
+        cout << "codeword weights (weight:count):";
 
-        rbs.to_buffer(reinterpret_cast<uint8_t*>(&j));
+        for (size_t w = 0; w < report.codeword_weights.size(); ++w)
+            if (report.codeword_weights[w] != 0)
+                cout << " " << w << ":" << report.codeword_weights[w];
 
-        assert(!result.correct || !result.success);
-        assert(!result.success);
+        cout << "\nminimum distance: " << report.minimum_distance << endl;
     }
+
+    cout << std::left << endl;
+}
+
+
+// exact outcome of every 1, 2 and 3 bit error
+void error_patterns()
+{
+    ThreadPool pool;
+
+    cout << "---------- Error patterns --------------\n";
+
+    run_error_patterns<ParityBit<7>>(pool, "ParityBit<7>");
+    run_error_patterns<Crc32cCheck<64>>(pool, "Crc32cCheck<64>");
+    run_error_patterns<HammingCode<7>>(pool, "HammingCode<7>");
+    run_error_patterns<HammingCode<64>>(pool, "HammingCode<64>");
+    run_error_patterns<HsiaoCode<7>>(pool, "HsiaoCode<7>");
+    run_error_patterns<HsiaoCode<64>>(pool, "HsiaoCode<64>");
+    run_error_patterns<ReedSolomon<10, 8>>(pool, "ReedSolomon<10, 8>");
+    run_error_patterns<BCHCode<64, 2>>(pool, "BCHCode<64, 2>");
+
+    cout << "---------- end error patterns --------- \n" << endl;
+}
+
+
+// LinearCode built from matrices: HsiaoCode<64>'s (decodes exactly as HsiaoCode<64> does), and the
+// Golay code read from text, correcting up to 3 errors
+void linear_codes()
+{
+    ThreadPool pool;
+
+    cout << "---------- Linear codes ----------------\n";
+
+    LinearCode<64, 72> hsiao;
+
+    if (hsiao.build(linear_code_matrices_of<HsiaoCode<64>>()))
+        run_error_patterns(pool, "LinearCode<64, 72> (HsiaoCode<64> matrices)", hsiao);
+    else
+        cout << "HsiaoCode<64> matrices: " << hsiao.error() << endl;
+
+    std::istringstream golay_text(GOLAY_23_12);
+    LinearCodeMatrices golay_matrices;
+    LinearCode<12, 23> golay;
+    std::string error;
+
+    if (parse_linear_code_matrices(golay_text, golay_matrices, error) && golay.build(golay_matrices, 3))
+        run_error_patterns(pool, "LinearCode<12, 23> (Golay, 3 errors)", golay);
+    else
+        cout << "Golay: " << (error.empty() ? golay.error() : error) << endl;
+
+    cout << "---------- end linear codes ----------- \n" << endl;
+}
+
+
+int main() 
+{
+    example_parity_1();
+    example_parity_2();
+    example_parity_3();
+
+    example_hamming_1();
+    example_hamming_2();
+    example_hamming_3();
+    example_hamming_4();
+
+    fault_injection();
+    burst_tolerance();
+    error_patterns();
+    linear_codes();
+
+    return 0;
 }
 
 /*/////////////////////////////////////////////////////////////////////////////
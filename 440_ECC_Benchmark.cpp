@@ -0,0 +1,1113 @@
+/*-----------------------------------------------------------------------------
+ * 440_ECC_Benchmark.cpp
+ *---------------------------------------------------------------------------*/
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <ctime>
+#include "Chunk.h"
+#include "StaticChunk.h"
+#include "ParityBit.h"
+#include "HammingCode.h"
+#include "HsiaoCode.h"
+#include "ReedSolomon.h"
+#include "BCHCode.h"
+#include "CrcCheck.h"
+#include "BitslicedHammingCode.h"
+#include "InterleavedCode.h"
+#include "ChipkillCode.h"
+#include "RuntimeCode.h"
+#include "LinearCode.h"
+#include "BulkProtect.h"
+#include "Scrubber.h"
+
+using std::cout;
+using std::endl;
+using std::setw;
+
+
+// results are accumulated here so the optimizer can't throw the measured work away
+static volatile size_t g_sink = 0;
+
+
+// runs fn(i) for the given number of iterations and returns the average ns per call
+template <class Func>
+double measure_ns(size_t iterations, Func&& fn)
+{
+    // warm up caches and branch predictors first
+    for (size_t i = 0; i < iterations / 10 + 1; ++i)
+        fn(i);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < iterations; ++i)
+        fn(i);
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+
+// one measurement. Everything reported is also collected here, so it can be written out as JSON
+struct BenchResult
+{
+    std::string group;
+    std::string name;
+    double value;
+    std::string unit;
+    double bytes_per_second;    // 0 when throughput doesn't apply
+};
+
+static std::vector<BenchResult> g_results;
+static std::string g_group;
+static bool g_print_text = true;
+static std::string g_filter;
+
+
+// starts a group of benchmarks; returns false if it's filtered out and should be skipped
+bool begin_group(const std::string& group)
+{
+    if (!g_filter.empty() && group.find(g_filter) == std::string::npos)
+        return false;
+
+    g_group = group;
+
+    if (g_print_text)
+        cout << "---------- " << group << " " << std::string(group.size() < 30 ? 30 - group.size() : 0, '-') << "\n";
+
+    return true;
+}
+
+void end_group()
+{
+    if (g_print_text)
+        cout << endl;
+}
+
+
+// bytes = bytes processed per unit measured, to also report throughput
+void report(const std::string& name, double value, const char* unit = "ns/codeword", double bytes = 0.0)
+{
+    // bytes per ns is GB/s
+    const auto gb_per_second = bytes > 0.0 && value > 0.0 ? bytes / value : 0.0;
+
+    g_results.push_back({ g_group, name, value, unit, gb_per_second * 1e9 });
+
+    if (!g_print_text)
+        return;
+
+    cout << std::left << setw(56) << name << std::right << std::fixed << std::setprecision(2) << setw(10) << value << " " << unit;
+
+    if (gb_per_second > 0.0)
+        cout << setw(10) << gb_per_second << " GB/s";
+
+    cout << "\n";
+}
+
+
+std::string json_escape(const std::string& text)
+{
+    std::string escaped;
+
+    for (const auto c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+
+// roughly the layout of Google Benchmark's JSON output: a context object, then one entry per measurement
+void write_json(std::ostream& out, const char* executable)
+{
+    const auto now = std::time(nullptr);
+    char date[32];
+
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    out << "{\n  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"executable\": \"" << json_escape(executable) << "\",\n";
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#if defined(__clang__)
+    out << "    \"compiler\": \"clang " << json_escape(__clang_version__) << "\",\n";
+#elif defined(__GNUC__)
+    out << "    \"compiler\": \"gcc " << json_escape(__VERSION__) << "\",\n";
+#elif defined(_MSC_VER)
+    out << "    \"compiler\": \"msvc " << _MSC_VER << "\",\n";
+#endif
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\"\n";
+#else
+    out << "    \"library_build_type\": \"debug\"\n";
+#endif
+    out << "  },\n  \"benchmarks\": [\n";
+
+    for (size_t i = 0; i < g_results.size(); ++i)
+    {
+        const auto& r = g_results[i];
+
+        out << "    { \"group\": \"" << json_escape(r.group) << "\", \"name\": \"" << json_escape(r.name) << "\", "
+            << "\"value\": " << std::setprecision(6) << std::defaultfloat << r.value << ", \"unit\": \"" << json_escape(r.unit) << "\"";
+
+        if (r.bytes_per_second > 0.0)
+            out << ", \"bytes_per_second\": " << std::setprecision(6) << r.bytes_per_second;
+
+        out << " }" << (i + 1 < g_results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+}
+
+
+// random data words to feed the codecs, so we're not measuring one lucky bit pattern
+template <size_t data_bits>
+std::vector<std::bitset<data_bits>> make_random_data(size_t count)
+{
+    std::mt19937_64 rng(data_bits);
+    std::vector<std::bitset<data_bits>> data(count);
+
+    for (auto& bits : data)
+        for (size_t i = 0; i < data_bits; ++i)
+            bits[i] = (rng() & 1) != 0;
+
+    return data;
+}
+
+
+
+/*
+ * The Hamming parity kernel as it was before this work started, copied verbatim: every stored
+ * bit is tested against every check bit, and each check bit is handed to a std::function,
+ * which the compiler can't see through. Kept here only so the benchmark can show what the
+ * statically dispatched, table driven kernels save per codeword
+ */
+template <size_t data_bits>
+struct LegacyHammingParity
+{
+    typedef HammingCode<data_bits> Hamming_t;
+    typedef typename Hamming_t::StoredDataBits_t StoredDataBits_t;
+    typedef std::function<void (StoredDataBits_t& data, size_t parityIdx, bool parityVal)> ParityCalcPostFunc_t;
+
+    static constexpr size_t CHECK_BIT_COUNT = Hamming_t::CHECK_BIT_COUNT;
+    static constexpr size_t TOTAL_BIT_COUNT = Hamming_t::TOTAL_BIT_COUNT;
+
+    static void compute_parity_bits(StoredDataBits_t& encoded, ParityCalcPostFunc_t func)
+    {
+        // compute parity bits
+        for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+        {
+            const size_t mask = 1 << i;
+
+            // compute parity value by looking at all bits
+            // with the ith bit set in their index
+            size_t counter = 0;
+
+            for (size_t position = 0; position < TOTAL_BIT_COUNT; ++position) {
+                const auto t = (mask & (position + 1));
+
+                if (t != 0)
+                    if (encoded.test(position))
+                        ++counter;
+            }
+
+            // use even parity bit: counter should be an even value
+            // set parity bit to 1 if it's not
+            const auto parityBit = counter % 2 == 1;
+
+            func(encoded, mask - 1, parityBit); // parity bit actual idx is 0-based
+        }
+    }
+
+    // the calls encode and decode made
+    static void set_parity_bits(StoredDataBits_t& encoded)
+    {
+        compute_parity_bits(encoded, [](StoredDataBits_t& data, size_t parityIdx, bool parityVal) { data[parityIdx] = parityVal; });
+    }
+
+    static size_t compute_syndrome(StoredDataBits_t& stored)
+    {
+        auto corrupt = false;
+        size_t corruptIdx = 0, position = 1;
+
+        compute_parity_bits(stored, [&corrupt, &corruptIdx, &position](StoredDataBits_t&, size_t, bool parityVal)
+        {
+            if (parityVal)
+                corrupt = true;
+
+            if (corrupt && parityVal)
+                corruptIdx += position;
+
+            position *= 2;
+        });
+
+        return corruptIdx;
+    }
+};
+
+
+// a check a benchmark makes before timing anything: prints failure if it didn't pass
+bool check(bool passed, const std::string& failure)
+{
+    if (!passed)
+        std::cerr << "check failed: " << failure << "\n";
+
+    return passed;
+}
+
+
+// parity kernel only: the legacy std::function callback vs. the statically dispatched kernels.
+// Their outputs are compared (check bits of codewords with them cleared, syndromes of codewords
+// with one bit flipped) before anything is timed; returns false if they differ
+template <size_t data_bits>
+bool bench_hamming_parity_kernel(size_t iterations)
+{
+    typedef HammingCode<data_bits> Hamming_t;
+    typedef LegacyHammingParity<data_bits> Legacy_t;
+
+    constexpr auto SW = Hamming_t::STORED_WORD_COUNT;
+
+    const Hamming_t hamming;
+    const auto data = make_random_data<data_bits>(1024);
+    const auto prefix = "HammingCode<" + std::to_string(data_bits) + "> ";
+    std::vector<typename Hamming_t::StoredDataBits_t> unset, corrupted;
+    std::vector<uint64_t> unset_words(data.size() * SW), corrupted_words(data.size() * SW);
+    std::mt19937_64 rng(data_bits);
+    bool same = true;
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        const auto encoded = hamming.encode(data[i]);
+
+        unset.push_back(encoded);
+        corrupted.push_back(encoded);
+
+        for (size_t c = 0; c < Hamming_t::CHECK_BIT_COUNT; ++c)
+            unset.back().reset((size_t(1) << c) - 1);
+
+        corrupted.back().flip(rng() % Hamming_t::TOTAL_BIT_COUNT);
+        bitset_to_words(unset.back(), unset_words.data() + i * SW);
+        bitset_to_words(corrupted.back(), corrupted_words.data() + i * SW);
+
+        auto legacy = unset.back();
+        uint64_t words[SW];
+
+        Legacy_t::set_parity_bits(legacy);
+        std::copy_n(unset_words.data() + i * SW, SW, words);
+        Hamming_t::set_parity_words(words);
+
+        same = same && legacy == encoded && words_to_bitset<Hamming_t::TOTAL_BIT_COUNT>(words) == encoded;
+        same = same && Legacy_t::compute_syndrome(corrupted.back()) == Hamming_t::compute_syndrome_words(corrupted_words.data() + i * SW);
+    }
+
+    if (!check(same, prefix + "legacy and static parity kernels differ"))
+        return false;
+
+    report(prefix + "set parity (std::function)", measure_ns(iterations, [&](size_t i)
+    {
+        auto bits = unset[i % unset.size()];
+        Legacy_t::set_parity_bits(bits);
+        g_sink = g_sink + bits.count();
+    }));
+
+    report(prefix + "set parity (static)", measure_ns(iterations, [&](size_t i)
+    {
+        uint64_t words[SW];
+
+        std::copy_n(unset_words.data() + (i % unset.size()) * SW, SW, words);
+        Hamming_t::set_parity_words(words);
+        g_sink = g_sink + words[0];
+    }));
+
+    report(prefix + "syndrome (std::function)", measure_ns(iterations, [&](size_t i)
+    {
+        auto bits = corrupted[i % corrupted.size()];
+        g_sink = g_sink + Legacy_t::compute_syndrome(bits);
+    }));
+
+    report(prefix + "syndrome (static)", measure_ns(iterations, [&](size_t i)
+    {
+        g_sink = g_sink + Hamming_t::compute_syndrome_words(corrupted_words.data() + (i % corrupted.size()) * SW);
+    }));
+
+    return true;
+}
+
+
+/*
+ * BitStream conversions as they were before they went word-at-a-time: one bit per
+ * iteration. Kept here only so the benchmark can compare the two
+ */
+template <size_t Size>
+struct LegacyBitStream
+{
+    static std::bitset<Size> from_buffer(const uint8_t* buf, size_t length_bits)
+    {
+        std::bitset<Size> bits;
+
+        for (size_t bitIdx = 0; bitIdx < length_bits; bitIdx += 8)
+        {
+            auto byteVal = *(buf + bitIdx / 8);
+
+            for (size_t bit = 0; bit < 8 && (bitIdx + bit < length_bits); ++bit) {
+                bits[bitIdx + bit] = (byteVal & 1) > 0;
+                byteVal >>= 1;
+            }
+        }
+
+        return bits;
+    }
+
+    static void to_buffer(const std::bitset<Size>& bits, uint8_t* buf)
+    {
+        for (size_t bitIdx = 0; bitIdx < Size; bitIdx += 8)
+        {
+            uint8_t byteVal = 0;
+
+            for (size_t bit = 0; bit < 8 && (bitIdx + bit < Size); ++bit)
+                byteVal |= (bits.test(bitIdx + bit) ? 1 : 0) << bit;
+
+            *(buf + bitIdx / 8) = byteVal;
+        }
+    }
+
+    template <size_t OtherSize>
+    static std::bitset<Size> convert_bitset_to_bitset(const std::bitset<OtherSize>& bitset)
+    {
+        std::bitset<Size> bits;
+
+        for (size_t i = 0; i < std::min(Size, bitset.size()); ++i)
+            bits[i] = bitset[i];
+
+        return bits;
+    }
+};
+
+
+// BitStream packing/unpacking: bit-by-bit vs. word-at-a-time
+template <size_t Size>
+void bench_bitstream_conversion(size_t iterations)
+{
+    typedef LegacyBitStream<Size> Legacy_t;
+
+    std::vector<uint8_t> buf((Size + 7) / 8 + 8);
+    std::mt19937_64 rng(Size);
+
+    for (auto& b : buf)
+        b = static_cast<uint8_t>(rng());
+
+    auto bits = BitStream<Size>::from_buffer(buf.data(), Size);
+    const auto prefix = "BitStream<" + std::to_string(Size) + "> ";
+
+    report(prefix + "from_buffer (bitwise)", measure_ns(iterations, [&](size_t)
+    {
+        g_sink = g_sink + Legacy_t::from_buffer(buf.data(), Size).test(0);
+    }), "ns/conversion");
+
+    report(prefix + "from_buffer (words)", measure_ns(iterations, [&](size_t)
+    {
+        g_sink = g_sink + BitStream<Size>::from_buffer(buf.data(), Size).test(0);
+    }), "ns/conversion");
+
+    report(prefix + "to_buffer (bitwise)", measure_ns(iterations, [&](size_t)
+    {
+        Legacy_t::to_buffer(bits, buf.data());
+        g_sink = g_sink + buf[0];
+    }), "ns/conversion");
+
+    report(prefix + "to_buffer (words)", measure_ns(iterations, [&](size_t)
+    {
+        bits.to_buffer(buf.data());
+        g_sink = g_sink + buf[0];
+    }), "ns/conversion");
+
+    // unaligned width, like the 20 bit case BitStream is meant to handle
+    report(prefix + "convert to " + std::to_string(Size + 3) + " (bitwise)", measure_ns(iterations, [&](size_t)
+    {
+        g_sink = g_sink + LegacyBitStream<Size + 3>::convert_bitset_to_bitset(bits).test(0);
+    }), "ns/conversion");
+
+    report(prefix + "convert to " + std::to_string(Size + 3) + " (words)", measure_ns(iterations, [&](size_t)
+    {
+        g_sink = g_sink + BitStream<Size + 3>::convert_bitset_to_bitset(bits).test(0);
+    }), "ns/conversion");
+}
+
+
+/*
+ * Encode/decode cost per codeword and data throughput, through the per-codeword API (one virtual
+ * call each) and the batch API (one call for all of them). Decodes run on clean codewords and on
+ * corrupted ones, with one random bit flipped in each. The two APIs' outputs are compared before
+ * anything is timed; returns false if they differ
+ */
+template <size_t data_bits, class Strategy>
+bool bench_codec(const std::string& name, size_t count, size_t rounds, const Strategy& prototype = Strategy())
+{
+    typedef CorrectionStrategy<data_bits, Strategy::TOTAL_BIT_COUNT> Strategy_t;
+
+    const std::shared_ptr<Strategy_t> strategy = std::make_shared<Strategy>(prototype);
+    const auto data = make_random_data<data_bits>(count);
+    const auto bytes = data_bits / 8.0;
+
+    std::vector<uint64_t> words(count * Strategy_t::DATA_WORD_COUNT);
+    std::vector<uint64_t> encoded(count * Strategy_t::STORED_WORD_COUNT);
+    std::vector<uint64_t> decoded(count * Strategy_t::DATA_WORD_COUNT);
+    std::vector<uint8_t> status(count);
+    std::vector<std::bitset<Strategy::TOTAL_BIT_COUNT>> stored(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        bitset_to_words(data[i], &words[i * Strategy_t::DATA_WORD_COUNT]);
+        stored[i] = strategy->encode(data[i]);
+    }
+
+    strategy->encode_batch(words.data(), count, encoded.data());
+
+    auto corrupted = encoded;
+    auto corrupted_stored = stored;
+    std::mt19937_64 rng(data_bits);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto bit = rng() % Strategy::TOTAL_BIT_COUNT;
+
+        corrupted_stored[i].flip(bit);
+        flip_word_bit(&corrupted[i * Strategy_t::STORED_WORD_COUNT], bit);
+    }
+
+    bool same = true;
+
+    for (const auto is_corrupted : { false, true })
+    {
+        const auto& in_stored = is_corrupted ? corrupted_stored : stored;
+
+        strategy->decode_batch((is_corrupted ? corrupted : encoded).data(), count, decoded.data(), status.data());
+
+        for (size_t i = 0; i < count && same; ++i)
+        {
+            const auto result = strategy->decode(in_stored[i]);
+            const auto compact = strategy->decode_compact(in_stored[i]);
+
+            same = words_to_bitset<Strategy::TOTAL_BIT_COUNT>(&encoded[i * Strategy_t::STORED_WORD_COUNT]) == stored[i] &&
+                   compact.decoded_bits == result.decoded_bits && compact.status == result.status() &&
+                   words_to_bitset<data_bits>(&decoded[i * Strategy_t::DATA_WORD_COUNT]) == result.decoded_bits &&
+                   status[i] == result.status();
+        }
+    }
+
+    if (!check(same, name + " per-codeword and batch outputs differ"))
+        return false;
+
+    report(name + " encode", measure_ns(rounds, [&](size_t)
+    {
+        for (size_t i = 0; i < count; ++i)
+            stored[i] = strategy->encode(data[i]);
+
+        g_sink = g_sink + stored[count - 1].count();
+    }) / static_cast<double>(count), "ns/codeword", bytes);
+
+    report(name + " encode_batch", measure_ns(rounds, [&](size_t)
+    {
+        strategy->encode_batch(words.data(), count, encoded.data());
+        g_sink = g_sink + encoded[0];
+    }) / static_cast<double>(count), "ns/codeword", bytes);
+
+    for (const auto is_corrupted : { false, true })
+    {
+        const auto& in_stored = is_corrupted ? corrupted_stored : stored;
+        const auto& in_encoded = is_corrupted ? corrupted : encoded;
+        const std::string variant = is_corrupted ? " (corrupted)" : " (clean)";
+
+        report(name + " decode" + variant, measure_ns(rounds, [&](size_t)
+        {
+            for (size_t i = 0; i < count; ++i)
+                g_sink = g_sink + strategy->decode(in_stored[i]).decoded_bits.count();
+        }) / static_cast<double>(count), "ns/codeword", bytes);
+
+        report(name + " decode_compact" + variant, measure_ns(rounds, [&](size_t)
+        {
+            for (size_t i = 0; i < count; ++i)
+                g_sink = g_sink + strategy->decode_compact(in_stored[i]).status;
+        }) / static_cast<double>(count), "ns/codeword", bytes);
+
+        report(name + " decode_batch" + variant, measure_ns(rounds, [&](size_t)
+        {
+            strategy->decode_batch(in_encoded.data(), count, decoded.data(), status.data());
+            g_sink = g_sink + decoded[0];
+        }) / static_cast<double>(count), "ns/codeword", bytes);
+    }
+
+    return true;
+}
+
+
+// batch encode / decode (one bit flipped per codeword) of a fixed-width template against the
+// RuntimeCode of the same width, on the same data
+template <size_t data_bits, class Strategy>
+void bench_runtime_width(const std::string& name, const RuntimeCode& runtime, size_t count, size_t rounds)
+{
+    const Strategy strategy;
+    const auto bytes = data_bits / 8.0;
+    const auto data_words = Strategy::DATA_WORD_COUNT;
+    const auto stored_words = Strategy::STORED_WORD_COUNT;
+
+    std::vector<uint64_t> words(count * data_words);
+    std::vector<uint64_t> encoded(count * stored_words);
+    std::vector<uint64_t> decoded(count * data_words);
+    std::vector<uint8_t> status(count);
+    std::mt19937_64 rng(data_bits);
+
+    for (auto& w : words)
+        w = rng();
+
+    strategy.encode_batch(words.data(), count, encoded.data());
+
+    for (size_t i = 0; i < count; ++i)
+        flip_word_bit(&encoded[i * stored_words], rng() % Strategy::TOTAL_BIT_COUNT);
+
+    auto corrupted = encoded;
+
+    report(name + " encode_batch", measure_ns(rounds, [&](size_t)
+    {
+        strategy.encode_batch(words.data(), count, encoded.data());
+        g_sink = g_sink + encoded[0];
+    }) / static_cast<double>(count), "ns/codeword", bytes);
+
+    report(name + " runtime encode_batch", measure_ns(rounds, [&](size_t)
+    {
+        runtime.encode_batch(words.data(), count, encoded.data());
+        g_sink = g_sink + encoded[0];
+    }) / static_cast<double>(count), "ns/codeword", bytes);
+
+    report(name + " decode_batch (corrupted)", measure_ns(rounds, [&](size_t)
+    {
+        strategy.decode_batch(corrupted.data(), count, decoded.data(), status.data());
+        g_sink = g_sink + decoded[0];
+    }) / static_cast<double>(count), "ns/codeword", bytes);
+
+    report(name + " runtime decode_batch (corrupted)", measure_ns(rounds, [&](size_t)
+    {
+        runtime.decode_batch(corrupted.data(), count, decoded.data(), status.data());
+        g_sink = g_sink + decoded[0];
+    }) / static_cast<double>(count), "ns/codeword", bytes);
+}
+
+
+// ParityBit has no TOTAL_BIT_COUNT of its own
+template <size_t data_bits>
+struct ParityBit_t : ParityBit<data_bits>
+{
+    static constexpr size_t TOTAL_BIT_COUNT = data_bits + 1;
+};
+
+
+// protect / verify_and_repair of a bytes long buffer on 1, 2, 4, ... threads, up to one per
+// hardware thread. Throughput should grow about linearly until memory bandwidth runs out. The
+// single thread baseline runs the same blocks without a pool
+template <class Strategy>
+void bench_bulk(const std::string& name, size_t bytes, size_t rounds)
+{
+    typedef ChunkArray<Strategy> Region_t;
+
+    const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint8_t> buffer(bytes);
+    std::mt19937_64 rng(bytes);
+
+    for (auto& byte : buffer)
+        byte = static_cast<uint8_t>(rng());
+
+    for (size_t threads = 1; ; threads = std::min<size_t>(threads * 2, hardware))
+    {
+        // the calling thread works too, so the pool has one thread less
+        std::unique_ptr<ThreadPool> pool(threads > 1 ? new ThreadPool(threads - 1) : nullptr);
+        Region_t region(bytes, false, Strategy(), pool.get());
+        const auto codewords = static_cast<double>(region.chunk_count());
+        const auto suffix = " (" + std::to_string(threads) + (threads == 1 ? " thread)" : " threads)");
+
+        report(name + " protect" + suffix, measure_ns(rounds, [&](size_t)
+        {
+            if (pool)
+                protect(*pool, region, buffer.data(), bytes);
+            else
+                region.write(0, buffer.data(), bytes);
+        }) / codewords, "ns/codeword", Region_t::DATA_BYTES_PER_CHUNK);
+
+        report(name + " verify_and_repair" + suffix, measure_ns(rounds, [&](size_t)
+        {
+            BulkReport result;
+
+            if (pool)
+                result = verify_and_repair(*pool, region);
+            else
+                verify_block(region, 0, region.chunk_count(), true, result);
+
+            g_sink = g_sink + result.codewords;
+        }) / codewords, "ns/codeword", Region_t::DATA_BYTES_PER_CHUNK);
+
+        if (threads == hardware)
+            break;
+    }
+}
+
+
+// one unthrottled Scrubber pass over a region on every hardware thread, with a single bit error
+// injected in one codeword in 256 before each pass (so the write-back path is timed too)
+template <class Strategy>
+void bench_scrub(const std::string& name, size_t bytes, size_t rounds)
+{
+    typedef ChunkArray<Strategy> Region_t;
+
+    const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool pool(std::max(1u, hardware - 1));
+    Region_t region(bytes, false, Strategy(), &pool);
+    Scrubber<Strategy> scrubber(region, pool);
+    std::mt19937_64 rng(bytes);
+    std::vector<uint8_t> buffer(bytes);
+
+    for (auto& byte : buffer)
+        byte = static_cast<uint8_t>(rng());
+
+    protect(pool, region, buffer.data(), bytes);
+
+    report(name + " scrub_pass (" + std::to_string(pool.size() + 1) + " threads)", measure_ns(rounds, [&](size_t)
+    {
+        for (size_t chunk = 0; chunk < region.chunk_count(); chunk += 256)
+            region.corrupt(chunk * Region_t::NumEncodedBits + rng() % Region_t::NumEncodedBits);
+
+        scrubber.scrub_pass();
+    }) / static_cast<double>(region.chunk_count()), "ns/codeword", Region_t::DATA_BYTES_PER_CHUNK);
+
+    g_sink = g_sink + scrubber.stats().corrected;
+}
+
+
+// GF(2^8) multiply-accumulate of a buffer by a constant: byte at a time through the log/antilog
+// tables vs. the split nibble region kernel (vectorized where SSSE3 / AVX2 are enabled), and
+// RS(255, 223) parity over 223 data shards of that size, as a storage stripe would be encoded
+void bench_gf256_region(size_t length, size_t rounds)
+{
+    typedef ReedSolomon<255, 223> RS_t;
+
+    const std::string prefix = std::to_string(length) + " bytes: ";
+
+    std::vector<uint8_t> src(length);
+    std::vector<uint8_t> dst(length);
+    std::mt19937_64 rng(length);
+
+    for (auto& b : src)
+        b = static_cast<uint8_t>(rng());
+
+    report(prefix + "mul_add (log tables)", measure_ns(rounds, [&](size_t i)
+    {
+        const auto c = static_cast<uint8_t>(i | 1);
+
+        for (size_t j = 0; j < length; ++j)
+            dst[j] ^= GF256::mul(c, src[j]);
+
+        g_sink = g_sink + dst[0];
+    }), "ns/call", static_cast<double>(length));
+
+    report(prefix + "mul_add_region (split nibble)", measure_ns(rounds, [&](size_t i)
+    {
+        GF256::mul_add_region(static_cast<uint8_t>(i | 1), src.data(), dst.data(), length);
+        g_sink = g_sink + dst[0];
+    }), "ns/call", static_cast<double>(length));
+
+    std::vector<uint8_t> shards(RS_t::SYMBOL_COUNT * length);
+    const uint8_t* data[RS_t::DATA_SYMBOL_COUNT];
+    uint8_t* parity[RS_t::CHECK_SYMBOL_COUNT];
+
+    for (auto& b : shards)
+        b = static_cast<uint8_t>(rng());
+
+    for (size_t i = 0; i < RS_t::DATA_SYMBOL_COUNT; ++i)
+        data[i] = &shards[i * length];
+
+    for (size_t j = 0; j < RS_t::CHECK_SYMBOL_COUNT; ++j)
+        parity[j] = &shards[(RS_t::DATA_SYMBOL_COUNT + j) * length];
+
+    report(prefix + "RS(255, 223) encode_columns", measure_ns(rounds / 100 + 1, [&](size_t)
+    {
+        RS_t::encode_columns(data, parity, length);
+        g_sink = g_sink + parity[0][0];
+    }), "ns/stripe", static_cast<double>(RS_t::DATA_SYMBOL_COUNT * length));
+}
+
+
+// BCH decode_batch cost by the number of bad bits per codeword: a single error is located
+// directly, more take Berlekamp-Massey and a Chien search that stops at the last root
+template <size_t data_bits, size_t t>
+void bench_bch_decode(const std::string& name, size_t count, size_t rounds)
+{
+    typedef BCHCode<data_bits, t> BCH_t;
+
+    const auto data = make_random_data<data_bits>(count);
+    const auto bytes = data_bits / 8.0;
+
+    std::vector<uint64_t> words(count * BCH_t::DATA_WORD_COUNT);
+    std::vector<uint64_t> encoded(count * BCH_t::STORED_WORD_COUNT);
+    std::vector<uint64_t> decoded(count * BCH_t::DATA_WORD_COUNT);
+    std::vector<uint8_t> status(count);
+    std::mt19937_64 rng(data_bits + t);
+
+    for (size_t i = 0; i < count; ++i)
+        bitset_to_words(data[i], &words[i * BCH_t::DATA_WORD_COUNT]);
+
+    const BCH_t code;
+
+    code.encode_batch(words.data(), count, encoded.data());
+
+    for (const auto errors : { size_t(1), size_t(2), t })
+    {
+        if (errors > t || (errors == t && t <= 2))
+            continue;
+
+        auto corrupted = encoded;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto* codeword = &corrupted[i * BCH_t::STORED_WORD_COUNT];
+
+            for (size_t flipped = 0; flipped < errors;)
+            {
+                const auto bit = rng() % BCH_t::TOTAL_BIT_COUNT;
+
+                // distinct bits: skip ones already flipped
+                if (test_word_bit(codeword, bit) == test_word_bit(&encoded[i * BCH_t::STORED_WORD_COUNT], bit))
+                {
+                    flip_word_bit(codeword, bit);
+                    ++flipped;
+                }
+            }
+        }
+
+        report(name + " decode_batch (" + std::to_string(errors) + " bad bits)", measure_ns(rounds, [&](size_t)
+        {
+            code.decode_batch(corrupted.data(), count, decoded.data(), status.data());
+            g_sink = g_sink + decoded[0];
+        }) / static_cast<double>(count), "ns/codeword", bytes);
+    }
+}
+
+
+// checksum throughput over one buffer: table slicing, the best scalar kernel (crc32 instruction
+// for CRC-32C), and what update() picks (PCLMULQDQ folding for large buffers), against memcpy
+void bench_crc(size_t length, size_t rounds)
+{
+    const std::string prefix = std::to_string(length) + " bytes: ";
+    const auto bytes = static_cast<double>(length);
+
+    std::vector<uint8_t> src(length);
+    std::vector<uint8_t> dst(length);
+    std::mt19937_64 rng(length);
+
+    for (auto& b : src)
+        b = static_cast<uint8_t>(rng());
+
+    report(prefix + "memcpy", measure_ns(rounds, [&](size_t)
+    {
+        memcpy(dst.data(), src.data(), length);
+        g_sink = g_sink + dst[length - 1];
+    }), "ns/call", bytes);
+
+    report(prefix + "CRC-32C slicing by 8", measure_ns(rounds, [&](size_t)
+    {
+        g_sink = g_sink + Crc32c::update_slicing(Crc32c::INIT, src.data(), length);
+    }), "ns/call", bytes);
+
+    report(prefix + "CRC-32C scalar", measure_ns(rounds, [&](size_t)
+    {
+        g_sink = g_sink + Crc32c::update_scalar(Crc32c::INIT, src.data(), length);
+    }), "ns/call", bytes);
+
+    report(prefix + "CRC-32C", measure_ns(rounds, [&](size_t)
+    {
+        g_sink = g_sink + Crc32c::compute(src.data(), length);
+    }), "ns/call", bytes);
+
+    report(prefix + "CRC-64 slicing by 8", measure_ns(rounds, [&](size_t)
+    {
+        g_sink = g_sink + Crc64::update_slicing(Crc64::INIT, src.data(), length);
+    }), "ns/call", bytes);
+
+    report(prefix + "CRC-64", measure_ns(rounds, [&](size_t)
+    {
+        g_sink = g_sink + Crc64::compute(src.data(), length);
+    }), "ns/call", bytes);
+}
+
+
+// runtime-polymorphic Chunk vs. StaticChunk on the same strategy: store + retrieve per codeword,
+// and the cost of copying the chunk around (shared_ptr refcount vs. nothing)
+template <size_t data_bits>
+void bench_chunk_dispatch(size_t iterations)
+{
+    typedef HammingCode<data_bits> Hamming_t;
+    typedef typename Hamming_t::Chunk_t Chunk_t;
+    typedef StaticChunk<Hamming_t> StaticChunk_t;
+
+    const auto data = make_random_data<data_bits>(1024);
+    std::vector<BitStream<data_bits>> streams(data.begin(), data.end());
+    const auto prefix = "HammingCode<" + std::to_string(data_bits) + "> ";
+
+    Chunk_t chunk(std::make_shared<Hamming_t>());
+    StaticChunk_t static_chunk;
+
+    report(prefix + "Chunk store + retrieve_compact", measure_ns(iterations, [&](size_t i)
+    {
+        chunk.store(streams[i % streams.size()]);
+        g_sink = g_sink + chunk.retrieve_compact().status;
+    }));
+
+    report(prefix + "StaticChunk store + retrieve_compact", measure_ns(iterations, [&](size_t i)
+    {
+        static_chunk.store(streams[i % streams.size()]);
+        g_sink = g_sink + static_chunk.retrieve_compact().status;
+    }));
+
+    report(prefix + "Chunk copy + retrieve_compact", measure_ns(iterations, [&](size_t)
+    {
+        const auto copy = chunk;
+        g_sink = g_sink + copy.retrieve_compact().status;
+    }));
+
+    report(prefix + "StaticChunk copy + retrieve_compact", measure_ns(iterations, [&](size_t)
+    {
+        const auto copy = static_chunk;
+        g_sink = g_sink + copy.retrieve_compact().status;
+    }));
+}
+
+
+// rewriting part of a codeword: storing the whole thing again vs. update() of a byte or a word,
+// which only flips the changed bits and the check bits they feed
+template <class Strategy>
+void bench_partial_write(const std::string& name, size_t iterations)
+{
+    constexpr auto data_bits = Strategy::NUM_DATA_BITS;
+
+    const auto data = make_random_data<data_bits>(64);
+    std::vector<BitStream<data_bits>> streams(data.begin(), data.end());
+    std::mt19937_64 rng(5);
+    std::vector<uint64_t> words(1024);
+
+    for (auto& word : words)
+        word = rng();
+
+    StaticChunk<Strategy> chunk;
+
+    chunk.store(streams[0]);
+
+    report(name + " store", measure_ns(iterations, [&](size_t i)
+    {
+        chunk.store(streams[i % streams.size()]);
+    }), "ns/write");
+
+    report(name + " update (8 bits)", measure_ns(iterations, [&](size_t i)
+    {
+        chunk.update((i * 8) % (data_bits - 7), words[i % words.size()], 8);
+    }), "ns/write");
+
+    report(name + " update (64 bits)", measure_ns(iterations, [&](size_t i)
+    {
+        chunk.update((i * 64) % (data_bits - 63), words[i % words.size()], 64);
+    }), "ns/write");
+
+    g_sink = g_sink + chunk.retrieve_compact().status;
+}
+
+
+void print_usage(const char* executable)
+{
+    std::cerr << "usage: " << executable << " [--json] [--out=FILE] [--filter=TEXT]\n"
+              << "  --json         print results as JSON instead of text\n"
+              << "  --out=FILE     also write results as JSON to FILE\n"
+              << "  --filter=TEXT  only run groups whose name contains TEXT\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    std::string out_file;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--json")
+            g_print_text = false;
+        else if (arg.compare(0, 6, "--out=") == 0)
+            out_file = arg.substr(6);
+        else if (arg.compare(0, 9, "--filter=") == 0)
+            g_filter = arg.substr(9);
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    const size_t iterations = 2000000;
+    bool ok = true;
+
+    if (begin_group("Hamming parity kernel"))
+    {
+        ok = bench_hamming_parity_kernel<7>(iterations) && ok;
+        ok = bench_hamming_parity_kernel<32>(iterations) && ok;
+        ok = bench_hamming_parity_kernel<64>(iterations) && ok;
+        ok = bench_hamming_parity_kernel<512>(iterations / 10) && ok;
+        end_group();
+    }
+
+    if (begin_group("BitStream conversion"))
+    {
+        bench_bitstream_conversion<7>(iterations);
+        bench_bitstream_conversion<20>(iterations);
+        bench_bitstream_conversion<64>(iterations);
+        bench_bitstream_conversion<100>(iterations);
+        bench_bitstream_conversion<512>(iterations / 10);
+        bench_bitstream_conversion<4096>(iterations / 100);
+        bench_bitstream_conversion<32768>(iterations / 1000); // 4 KiB
+        end_group();
+    }
+
+    if (begin_group("Chunk vs. StaticChunk"))
+    {
+        bench_chunk_dispatch<64>(iterations / 4);
+        end_group();
+    }
+
+    if (begin_group("partial write"))
+    {
+        bench_partial_write<ParityBit<4096>>("ParityBit<4096>", iterations / 16);
+        bench_partial_write<HammingCode<64>>("HammingCode<64>", iterations / 4);
+        bench_partial_write<HammingCode<4096>>("HammingCode<4096>", iterations / 16);
+        bench_partial_write<HsiaoCode<64>>("HsiaoCode<64>", iterations / 4);
+        end_group();
+    }
+
+    if (begin_group("GF(256) region"))
+    {
+        bench_gf256_region(256, 100000);
+        bench_gf256_region(4096, 10000);
+        end_group();
+    }
+
+    if (begin_group("CRC"))
+    {
+        bench_crc(64, 100000);
+        bench_crc(4096, 10000);
+        bench_crc(1 << 20, 50);
+        end_group();
+    }
+
+    if (begin_group("codec"))
+    {
+        ok = bench_codec<7, ParityBit_t<7>>("ParityBit<7>", 4096, 200) && ok;
+        ok = bench_codec<7, HammingCode<7>>("HammingCode<7>", 4096, 200) && ok;
+        ok = bench_codec<7, HsiaoCode<7>>("HsiaoCode<7>", 4096, 200) && ok;
+        ok = bench_codec<7, BitslicedHammingCode<7>>("BitslicedHammingCode<7>", 4096, 200) && ok;
+        ok = bench_codec<32, ParityBit_t<32>>("ParityBit<32>", 4096, 200) && ok;
+        ok = bench_codec<32, HammingCode<32>>("HammingCode<32>", 4096, 200) && ok;
+        ok = bench_codec<32, HsiaoCode<32>>("HsiaoCode<32>", 4096, 200) && ok;
+        ok = bench_codec<64, ParityBit_t<64>>("ParityBit<64>", 4096, 200) && ok;
+        ok = bench_codec<64, HammingCode<64>>("HammingCode<64>", 4096, 200) && ok;
+        ok = bench_codec<64, HsiaoCode<64>>("HsiaoCode<64>", 4096, 200) && ok;
+        ok = bench_codec<64, BitslicedHammingCode<64>>("BitslicedHammingCode<64>", 4096, 200) && ok;
+        ok = bench_codec<512, InterleavedCode<HammingCode<64>, 8>>("InterleavedCode<HammingCode<64>, 8>", 512, 200) && ok;
+        ok = bench_codec<4096, InterleavedCode<HammingCode<64>, 64>>("InterleavedCode<HammingCode<64>, 64>", 64, 200) && ok;
+        ok = bench_codec<128, ParityBit_t<128>>("ParityBit<128>", 2048, 100) && ok;
+        ok = bench_codec<128, HammingCode<128>>("HammingCode<128>", 2048, 100) && ok;
+        ok = bench_codec<128, HsiaoCode<128>>("HsiaoCode<128>", 2048, 100) && ok;
+        ok = bench_codec<128, ChipkillCode<4>>("ChipkillCode<4>", 2048, 100) && ok;
+        ok = bench_codec<256, ChipkillCode<8>>("ChipkillCode<8>", 2048, 100) && ok;
+        ok = bench_codec<512, ParityBit_t<512>>("ParityBit<512>", 1024, 50) && ok;
+        ok = bench_codec<512, HammingCode<512>>("HammingCode<512>", 1024, 50) && ok;
+        ok = bench_codec<512, HsiaoCode<512>>("HsiaoCode<512>", 1024, 50) && ok;
+        ok = bench_codec<64, LinearCode<64, 72>>("LinearCode<64, 72> (Hsiao)", 4096, 200, LinearCode<64, 72>(linear_code_matrices_of<HsiaoCode<64>>())) && ok;
+        ok = bench_codec<64, LinearCode<64, 72>>("LinearCode<64, 72> (Hamming)", 4096, 200, LinearCode<64, 72>(linear_code_matrices_of<HammingCode<64>>())) && ok;
+        ok = bench_codec<512, LinearCode<512, 523>>("LinearCode<512, 523> (Hsiao)", 1024, 50, LinearCode<512, 523>(linear_code_matrices_of<HsiaoCode<512>>())) && ok;
+        ok = bench_codec<64, ReedSolomon<10, 8>>("ReedSolomon<10, 8>", 4096, 200) && ok;
+        ok = bench_codec<1784, ReedSolomon<255, 223>>("ReedSolomon<255, 223>", 512, 10) && ok;
+        ok = bench_codec<64, BCHCode<64, 2>>("BCHCode<64, 2>", 4096, 200) && ok;
+        ok = bench_codec<512, BCHCode<512, 2>>("BCHCode<512, 2>", 1024, 50) && ok;
+        ok = bench_codec<512, BCHCode<512, 4>>("BCHCode<512, 4>", 1024, 50) && ok;
+        ok = bench_codec<512, BCHCode<512, 8>>("BCHCode<512, 8>", 1024, 50) && ok;
+        ok = bench_codec<32768, BCHCode<32768, 8>>("BCHCode<32768, 8>", 32, 5) && ok;
+        ok = bench_codec<512, Crc32cCheck<512>>("Crc32cCheck<512>", 1024, 50) && ok;
+        ok = bench_codec<512, Crc64Check<512>>("Crc64Check<512>", 1024, 50) && ok;
+        ok = bench_codec<32768, Crc32cCheck<32768>>("Crc32cCheck<32768>", 32, 5) && ok;
+        end_group();
+    }
+
+    if (begin_group("runtime width"))
+    {
+        bench_runtime_width<7, ParityBit_t<7>>("ParityBit<7>", RuntimeParityBit(7), 4096, 200);
+        bench_runtime_width<7, HammingCode<7>>("HammingCode<7>", RuntimeHammingCode(7), 4096, 200);
+        bench_runtime_width<64, ParityBit_t<64>>("ParityBit<64>", RuntimeParityBit(64), 4096, 200);
+        bench_runtime_width<64, HammingCode<64>>("HammingCode<64>", RuntimeHammingCode(64), 4096, 200);
+        bench_runtime_width<512, ParityBit_t<512>>("ParityBit<512>", RuntimeParityBit(512), 1024, 50);
+        bench_runtime_width<512, HammingCode<512>>("HammingCode<512>", RuntimeHammingCode(512), 1024, 50);
+        bench_runtime_width<4096, HammingCode<4096>>("HammingCode<4096>", RuntimeHammingCode(4096), 128, 20);
+        end_group();
+    }
+
+    if (begin_group("bulk protect"))
+    {
+        bench_bulk<ParityBit<64>>("ParityBit<64>", 64 << 20, 5);
+        bench_bulk<HammingCode<64>>("HammingCode<64>", 64 << 20, 5);
+        end_group();
+    }
+
+    if (begin_group("scrub"))
+    {
+        bench_scrub<HammingCode<64>>("HammingCode<64>", 64 << 20, 5);
+        bench_scrub<HsiaoCode<64>>("HsiaoCode<64>", 64 << 20, 5);
+        end_group();
+    }
+
+    if (begin_group("BCH decode"))
+    {
+        bench_bch_decode<512, 4>("BCHCode<512, 4>", 1024, 20);
+        bench_bch_decode<512, 8>("BCHCode<512, 8>", 1024, 20);
+        bench_bch_decode<32768, 8>("BCHCode<32768, 8>", 16, 3);
+        end_group();
+    }
+
+    if (!g_print_text)
+        write_json(cout, argv[0]);
+
+    if (!out_file.empty())
+    {
+        std::ofstream out(out_file);
+
+        if (!out)
+        {
+            std::cerr << "can't write " << out_file << "\n";
+            return 1;
+        }
+
+        write_json(out, argv[0]);
+    }
+
+    return ok ? 0 : 1;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end 440_ECC_Benchmark.cpp
+ *///////////////////////////////////////////////////////////////////////////*/
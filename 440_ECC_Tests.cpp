@@ -0,0 +1,1509 @@
+/*-----------------------------------------------------------------------------
+ * 440_ECC_Tests.cpp
+ *---------------------------------------------------------------------------*/
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chunk.h"
+#include "HammingCode.h"
+#include "HsiaoCode.h"
+#include "ChunkArray.h"
+#include "Scrubber.h"
+#include "StaticChunk.h"
+#include "ReedSolomon.h"
+#include "BCHCode.h"
+#include "BitslicedHammingCode.h"
+#include "CrcCheck.h"
+#include "EccContainer.h"
+#include "EccTelemetry.h"
+#include "FaultInjection.h"
+#include "ErrorPatternAnalyzer.h"
+#include "LinearCode.h"
+#include "InterleavedCode.h"
+#include "ChipkillCode.h"
+#include "ParityBit.h"
+#include "RuntimeCode.h"
+#include "BulkProtect.h"
+
+using std::cout;
+using std::endl;
+
+
+// every heap allocation made by the process is counted, so allocation-free paths can be checked.
+// All the replaceable forms (array, nothrow, over-aligned) go through the same pair of functions,
+// so none of them slips past the count or is freed by the wrong deallocator
+static std::atomic<size_t> g_allocations(0);
+
+static void* counted_allocate(size_t size, size_t alignment) noexcept
+{
+    ++g_allocations;
+
+    if (size == 0)
+        size = 1;
+
+    if (alignment <= alignof(std::max_align_t))
+        return malloc(size);
+
+#ifdef _MSC_VER
+    return _aligned_malloc(size, alignment);
+#else
+    void* p = nullptr;
+
+    return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+#endif
+}
+
+static void counted_free(void* p, size_t alignment) noexcept
+{
+#ifdef _MSC_VER
+    if (alignment > alignof(std::max_align_t))
+    {
+        _aligned_free(p);
+        return;
+    }
+#else
+    (void)alignment;
+#endif
+    free(p);
+}
+
+static void* counted_allocate_or_throw(size_t size, size_t alignment)
+{
+    if (auto p = counted_allocate(size, alignment))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return counted_allocate_or_throw(size, 0); }
+void* operator new[](size_t size) { return counted_allocate_or_throw(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return counted_allocate_or_throw(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return counted_allocate_or_throw(size, static_cast<size_t>(al)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted_allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted_allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return counted_allocate(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return counted_allocate(size, static_cast<size_t>(al)); }
+
+void operator delete(void* p) noexcept { counted_free(p, 0); }
+void operator delete[](void* p) noexcept { counted_free(p, 0); }
+void operator delete(void* p, size_t) noexcept { counted_free(p, 0); }
+void operator delete[](void* p, size_t) noexcept { counted_free(p, 0); }
+void operator delete(void* p, std::align_val_t al) noexcept { counted_free(p, static_cast<size_t>(al)); }
+void operator delete[](void* p, std::align_val_t al) noexcept { counted_free(p, static_cast<size_t>(al)); }
+void operator delete(void* p, size_t, std::align_val_t al) noexcept { counted_free(p, static_cast<size_t>(al)); }
+void operator delete[](void* p, size_t, std::align_val_t al) noexcept { counted_free(p, static_cast<size_t>(al)); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { counted_free(p, 0); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { counted_free(p, 0); }
+void operator delete(void* p, std::align_val_t al, const std::nothrow_t&) noexcept { counted_free(p, static_cast<size_t>(al)); }
+void operator delete[](void* p, std::align_val_t al, const std::nothrow_t&) noexcept { counted_free(p, static_cast<size_t>(al)); }
+
+
+/*
+ * Self-checking tests, run by ctest (or directly: a non-zero exit status means a check failed).
+ * Each test is a function; CHECK reports a failed condition and carries on
+ */
+static size_t g_failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { ++g_failures; cout << "  FAILED: " << #condition << " (line " << __LINE__ << ")" << endl; } } while (0)
+
+
+// the bitsliced batches give exactly HammingCode's codewords, decoded data and status, for
+// count codewords that end in a partial block, with garbage in the inputs' unused high bits.
+// The codewords take turns being clean, having a single error, a double error, and a double or
+// triple error whose syndrome points past the end of the codeword (where any syndrome can)
+template <size_t NumDataBits, size_t LaneWords>
+void check_bitsliced_matches_scalar(size_t count)
+{
+    typedef HammingCode<NumDataBits> Hamming_t;
+    typedef BitslicedHammingCode<NumDataBits, LaneWords> Bitsliced_t;
+
+    constexpr auto DW = Hamming_t::DATA_WORD_COUNT;
+    constexpr auto SW = Hamming_t::STORED_WORD_COUNT;
+    constexpr auto TOTAL = Hamming_t::TOTAL_BIT_COUNT;
+
+    const Hamming_t hamming;
+    const Bitsliced_t bitsliced;
+    std::mt19937_64 rng(NumDataBits * 1000 + LaneWords);
+    std::vector<uint64_t> data(count * DW), encoded(count * SW), expected(count * SW);
+    std::vector<uint64_t> decoded(count * DW);
+    std::vector<uint8_t> status(count);
+    size_t wrong = 0;
+
+    for (auto& w : data)
+        w = rng();
+
+    bitsliced.encode_batch(data.data(), count, encoded.data());
+
+    for (size_t i = 0; i < count; ++i)
+        bitset_to_words(hamming.encode(words_to_bitset<NumDataBits>(&data[i * DW])), &expected[i * SW]);
+
+    CHECK(encoded == expected);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        static const size_t ERRORS[] = { 0, 1, 2, 2, 3 };   // by kind
+        auto* word = &encoded[i * SW];
+        const auto kind = i % 5;
+        size_t bits[3], syndrome = 0;
+
+        for (size_t tries = 0; tries < 1000; ++tries)
+        {
+            syndrome = 0;
+
+            for (size_t e = 0; e < 3; ++e)
+            {
+                bits[e] = rng() % TOTAL;
+                syndrome ^= e < ERRORS[kind] ? bits[e] + 1 : 0;
+            }
+
+            const auto distinct = bits[0] != bits[1] && bits[0] != bits[2] && bits[1] != bits[2];
+
+            if (distinct && (kind < 3 || syndrome > TOTAL))
+                break;
+        }
+
+        for (size_t e = 0; e < ERRORS[kind]; ++e)
+            flip_word_bit(word, bits[e]);
+
+        if (TOTAL % 64 != 0)
+            word[SW - 1] |= rng() << (TOTAL % 64);
+    }
+
+    bitsliced.decode_batch(encoded.data(), count, decoded.data(), status.data());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto result = hamming.decode(words_to_bitset<TOTAL>(&encoded[i * SW]));
+
+        wrong += words_to_bitset<NumDataBits>(&decoded[i * DW]) != result.decoded_bits || status[i] != result.status();
+
+        if (NumDataBits % 64 != 0)
+            wrong += (decoded[i * DW + DW - 1] >> (NumDataBits % 64)) != 0;
+    }
+
+    CHECK(wrong == 0);
+}
+
+
+template <size_t NumDataBits>
+void check_bitsliced_matches_scalar()
+{
+    for (const size_t count : { 1, 300, 1100 })
+    {
+        check_bitsliced_matches_scalar<NumDataBits, 1>(count);
+        check_bitsliced_matches_scalar<NumDataBits, 4>(count);
+        check_bitsliced_matches_scalar<NumDataBits, 8>(count);
+        check_bitsliced_matches_scalar<NumDataBits, BITSLICE_LANE_WORDS>(count);
+    }
+}
+
+
+void test_bitsliced_hamming()
+{
+    check_bitsliced_matches_scalar<1>();
+    check_bitsliced_matches_scalar<2>();
+    check_bitsliced_matches_scalar<4>();
+    check_bitsliced_matches_scalar<7>();
+    check_bitsliced_matches_scalar<57>();
+    check_bitsliced_matches_scalar<64>();
+    check_bitsliced_matches_scalar<128>();
+    check_bitsliced_matches_scalar<300>();
+}
+
+
+// a fixed seed gives the same counts whatever the thread count, and the strata's weights, with
+// P(no event) and the unsampled tail, add up to 1
+template <class ErrorModel>
+void check_fault_injection(const ErrorModel& model, ThreadPool& one, ThreadPool& three)
+{
+    typedef HammingCode<64> Strategy_t;
+
+    const auto first = FaultInjector<Strategy_t>(one, 7).run(model, 3000, 5);
+    const auto second = FaultInjector<Strategy_t>(three, 7).run(model, 3000, 5);
+    const auto other_seed = FaultInjector<Strategy_t>(three, 8).run(model, 3000, 5);
+    const auto same = [](const FaultInjectionResult& a, const FaultInjectionResult& b)
+    {
+        if (a.strata.size() != b.strata.size())
+            return false;
+
+        for (size_t k = 0; k < a.strata.size(); ++k)
+        {
+            const auto& x = a.strata[k];
+            const auto& y = b.strata[k];
+
+            if (x.clean != y.clean || x.corrected != y.corrected || x.detected != y.detected ||
+                x.miscorrected != y.miscorrected || x.undetected != y.undetected)
+                return false;
+        }
+
+        return true;
+    };
+
+    CHECK(same(first, second));
+    CHECK(first.residual_rate == second.residual_rate);
+    CHECK(!same(first, other_seed));
+
+    auto total = binomial_probability(model.sites(Strategy_t::NUM_ENCODED_BITS), 0, model.p) + first.unsampled_probability;
+
+    for (const auto& stratum : first.strata)
+    {
+        total += stratum.probability;
+        CHECK(stratum.trials == 3000);
+        CHECK(stratum.clean + stratum.corrected + stratum.detected + stratum.miscorrected + stratum.undetected == 3000);
+    }
+
+    CHECK(std::abs(total - 1.0) < 1e-9);
+}
+
+
+void test_fault_injection()
+{
+    ThreadPool one(1), three(3);
+
+    for (const auto p : { 1e-6, 0.05 })
+    {
+        check_fault_injection(BitFlipModel(p), one, three);
+        check_fault_injection(BurstModel(p, 4), one, three);
+        check_fault_injection(DeviceFailureModel(p, 8), one, three);
+        check_fault_injection(StuckAtModel(p, true), one, three);
+    }
+}
+
+
+// the analyzer's exhaustive tables for codes whose numbers are known: HammingCode<7> has
+// minimum distance 3 and corrects every single error; the Golay code has minimum distance 7, its
+// textbook weight distribution, and corrects every pattern of up to 3 errors
+void test_error_patterns()
+{
+    ThreadPool pool(2);
+
+    const auto hamming = ErrorPatternAnalyzer<HammingCode<7>>(pool).analyze();
+
+    CHECK(hamming.data_words_checked == 128);
+    CHECK(hamming.linearity_violations == 0);
+    CHECK(hamming.minimum_distance == 3);
+    CHECK(hamming.rows.size() == 3);
+    CHECK(hamming.rows[0].patterns == 12 && hamming.rows[0].outcomes[OUTCOME_CORRECTED] == 12);
+    CHECK(hamming.rows[1].patterns == 66 && hamming.rows[1].outcomes[OUTCOME_UNDETECTED] == 0);
+    CHECK(hamming.rows[2].patterns == 220);
+
+    std::istringstream text(GOLAY_23_12);
+    LinearCodeMatrices matrices;
+    LinearCode<12, 23> golay;
+    std::string error;
+
+    CHECK(parse_linear_code_matrices(text, matrices, error));
+    CHECK(golay.build(matrices, 3));
+
+    const auto report = ErrorPatternAnalyzer<LinearCode<12, 23>>(pool, golay).analyze();
+    std::vector<uint64_t> weights(24, 0);
+
+    weights[0] = weights[23] = 1;
+    weights[7] = weights[16] = 253;
+    weights[8] = weights[15] = 506;
+    weights[11] = weights[12] = 1288;
+
+    CHECK(report.data_words_checked == 4096);
+    CHECK(report.linearity_violations == 0);
+    CHECK(report.minimum_distance == 7);
+    CHECK(report.codeword_weights == weights);
+
+    for (const auto& row : report.rows)
+        CHECK(row.outcomes[OUTCOME_CORRECTED] == row.patterns);
+}
+
+
+// a Hsiao code has the given number of check bits, corrects every single error and reports every
+// double error uncorrectable, through the batch and the bitset paths
+template <size_t NumDataBits>
+void check_hsiao_sec_ded(ThreadPool& pool, size_t check_bits)
+{
+    typedef HsiaoCode<NumDataBits> Hsiao_t;
+
+    constexpr auto TOTAL = Hsiao_t::TOTAL_BIT_COUNT;
+
+    CHECK(Hsiao_t::CHECK_BIT_COUNT == check_bits);
+
+    const auto report = ErrorPatternAnalyzer<Hsiao_t>(pool).analyze(2);
+
+    CHECK(report.linearity_violations == 0);
+    CHECK(report.rows.size() == 2);
+    CHECK(report.rows[0].patterns == TOTAL && report.rows[0].outcomes[OUTCOME_CORRECTED] == TOTAL);
+    CHECK(report.rows[1].patterns == TOTAL * (TOTAL - 1) / 2 && report.rows[1].outcomes[OUTCOME_DETECTED] == report.rows[1].patterns);
+
+    const Hsiao_t hsiao;
+    std::mt19937_64 rng(NumDataBits);
+    std::bitset<NumDataBits> data;
+    size_t wrong = 0;
+
+    for (size_t i = 0; i < NumDataBits; ++i)
+        data[i] = (rng() & 1) != 0;
+
+    const auto encoded = hsiao.encode(data);
+
+    for (size_t i = 0; i < TOTAL; ++i)
+    {
+        auto single = encoded;
+
+        single.flip(i);
+
+        const auto result = hsiao.decode(single);
+
+        wrong += result.decoded_bits != data || result.status() != (DECODE_ERROR_DETECTED | DECODE_CORRECTED);
+
+        for (size_t j = i + 1; j < TOTAL; ++j)
+        {
+            auto twice = single;
+
+            twice.flip(j);
+            wrong += (hsiao.decode(twice).status() & DECODE_UNCORRECTABLE) == 0;
+        }
+    }
+
+    CHECK(wrong == 0);
+}
+
+
+void test_hsiao()
+{
+    ThreadPool pool(2);
+
+    check_hsiao_sec_ded<32>(pool, 7);
+    check_hsiao_sec_ded<64>(pool, 8);
+    check_hsiao_sec_ded<128>(pool, 9);
+}
+
+
+// RS(255, 223) corrects up to 16 bad bytes, reports 17 uncorrectable rather than miscorrecting,
+// and its batch paths give the same codewords, data and status as encode / decode
+void test_reed_solomon()
+{
+    typedef ReedSolomon<255, 223> Rs_t;
+
+    constexpr auto DW = Rs_t::DATA_WORD_COUNT;
+    constexpr auto SW = Rs_t::STORED_WORD_COUNT;
+    constexpr size_t COUNT = 40;
+
+    const Rs_t rs;
+    std::mt19937_64 rng(15);
+    std::vector<uint64_t> data(COUNT * DW), encoded(COUNT * SW), decoded(COUNT * DW);
+    std::vector<uint8_t> status(COUNT);
+
+    for (size_t i = 0; i < COUNT; ++i)
+        for (size_t w = 0; w < DW; ++w)
+            data[i * DW + w] = rng() & (w + 1 == DW ? Rs_t::LAST_DATA_WORD_MASK : ~uint64_t(0));
+
+    rs.encode_batch(data.data(), COUNT, encoded.data());
+
+    size_t wrong = 0;
+
+    for (size_t i = 0; i < COUNT; ++i)
+        wrong += words_to_bitset<Rs_t::TOTAL_BIT_COUNT>(&encoded[i * SW]) != rs.encode(words_to_bitset<Rs_t::DATA_BIT_COUNT>(&data[i * DW]));
+
+    CHECK(wrong == 0);
+
+    for (const size_t errors : { 0, 1, 8, 16, 17 })
+    {
+        auto corrupted = encoded;
+
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            std::set<size_t> symbols;
+
+            while (symbols.size() < errors)
+                symbols.insert(rng() % Rs_t::SYMBOL_COUNT);
+
+            for (const auto symbol : symbols)
+                write_word_bits(&corrupted[i * SW], symbol * 8, 8, read_word_bits(&corrupted[i * SW], symbol * 8, 8) ^ (1 + rng() % 255));
+        }
+
+        rs.decode_batch(corrupted.data(), COUNT, decoded.data(), status.data());
+
+        size_t bad_outcome = 0;
+
+        wrong = 0;
+
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            const auto result = rs.decode(words_to_bitset<Rs_t::TOTAL_BIT_COUNT>(&corrupted[i * SW]));
+            const auto intact = result.decoded_bits == words_to_bitset<Rs_t::DATA_BIT_COUNT>(&data[i * DW]);
+            const auto outcome = classify_outcome(intact, result.status());
+
+            wrong += words_to_bitset<Rs_t::DATA_BIT_COUNT>(&decoded[i * DW]) != result.decoded_bits || status[i] != result.status();
+
+            if (errors == 0)
+                bad_outcome += outcome != OUTCOME_CLEAN;
+            else if (errors <= Rs_t::CORRECTABLE_SYMBOLS)
+                bad_outcome += outcome != OUTCOME_CORRECTED;
+            else
+                bad_outcome += outcome != OUTCOME_DETECTED;
+        }
+
+        CHECK(wrong == 0);
+        CHECK(bad_outcome == 0);
+    }
+}
+
+
+// every codeword of a BCH code has the roots alpha^1 .. alpha^2T, any T bad bits are corrected,
+// and the batch paths give the same codewords, data and status as encode / decode
+template <size_t NumDataBits, size_t T>
+void check_bch(size_t count)
+{
+    typedef BCHCode<NumDataBits, T> Bch_t;
+    typedef typename Bch_t::Field_t Field_t;
+
+    constexpr auto DW = Bch_t::DATA_WORD_COUNT;
+    constexpr auto SW = Bch_t::STORED_WORD_COUNT;
+    constexpr auto TOTAL = Bch_t::TOTAL_BIT_COUNT;
+
+    const Bch_t bch;
+    const auto* exp = Field_t::exp_table();
+    std::mt19937_64 rng(NumDataBits + T);
+    std::vector<uint64_t> data(count * DW), encoded(count * SW), decoded(count * DW);
+    std::vector<uint8_t> status(count);
+    size_t wrong = 0;
+
+    for (size_t i = 0; i < count; ++i)
+        for (size_t w = 0; w < DW; ++w)
+            data[i * DW + w] = rng() & (w + 1 == DW ? Bch_t::LAST_DATA_WORD_MASK : ~uint64_t(0));
+
+    bch.encode_batch(data.data(), count, encoded.data());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        wrong += words_to_bitset<TOTAL>(&encoded[i * SW]) != bch.encode(words_to_bitset<NumDataBits>(&data[i * DW]));
+
+        // bit p is the coefficient of x^(TOTAL - 1 - p)
+        for (size_t j = 1; j <= 2 * T; ++j)
+        {
+            uint32_t value = 0;
+
+            for (size_t p = 0; p < TOTAL; ++p)
+                if (test_word_bit(&encoded[i * SW], p))
+                    value ^= exp[j * (TOTAL - 1 - p) % Field_t::ORDER];
+
+            wrong += value != 0;
+        }
+    }
+
+    CHECK(wrong == 0);
+
+    for (size_t errors = 0; errors <= T; ++errors)
+    {
+        auto corrupted = encoded;
+        size_t bad_outcome = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::set<size_t> bits;
+
+            while (bits.size() < errors)
+                bits.insert(rng() % TOTAL);
+
+            for (const auto bit : bits)
+                flip_word_bit(&corrupted[i * SW], bit);
+        }
+
+        bch.decode_batch(corrupted.data(), count, decoded.data(), status.data());
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto result = bch.decode(words_to_bitset<TOTAL>(&corrupted[i * SW]));
+            const auto intact = result.decoded_bits == words_to_bitset<NumDataBits>(&data[i * DW]);
+
+            wrong += words_to_bitset<NumDataBits>(&decoded[i * DW]) != result.decoded_bits || status[i] != result.status();
+            bad_outcome += classify_outcome(intact, result.status()) != (errors == 0 ? OUTCOME_CLEAN : OUTCOME_CORRECTED);
+        }
+
+        CHECK(wrong == 0);
+        CHECK(bad_outcome == 0);
+    }
+}
+
+
+void test_bch()
+{
+    // BCH(15, 7), t = 2, over GF(16) with x^4 + x + 1: the data polynomial 1 (the last data bit)
+    // encodes to the generator itself, x^8 + x^7 + x^6 + x^4 + 1
+    std::bitset<7> one;
+    std::bitset<15> generator;
+
+    one.set(6);
+
+    for (const auto power : { 8, 7, 6, 4, 0 })
+        generator.set(14 - power);
+
+    CHECK((BCHCode<7, 2>::TOTAL_BIT_COUNT == 15));
+    CHECK((BCHCode<7, 2>().encode(one) == generator));
+
+    check_bch<7, 2>(64);
+    check_bch<512, 4>(64);
+    check_bch<4096, 8>(8);
+}
+
+
+// every kernel of a CRC gives what a bit at a time reference gives, at every length up to a few
+// fold blocks and at odd offsets, and streaming in pieces gives the one shot value
+template <class Crc_t>
+void check_crc_kernels()
+{
+    typedef typename Crc_t::Value_t Value_t;
+
+    const auto poly = static_cast<Value_t>(reflect_bits(Crc_t::POLY, Crc_t::WIDTH));
+    const auto reference = [poly](const uint8_t* data, size_t length)
+    {
+        auto state = Crc_t::INIT;
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            state ^= data[i];
+
+            for (size_t bit = 0; bit < 8; ++bit)
+                state = static_cast<Value_t>((state >> 1) ^ (state & 1 ? poly : 0));
+        }
+
+        return static_cast<Value_t>(state ^ Crc_t::XOR_OUT);
+    };
+
+    std::mt19937_64 rng(Crc_t::WIDTH);
+    std::vector<uint8_t> buffer(1024 + 8);
+    size_t wrong = 0;
+
+    for (auto& byte : buffer)
+        byte = static_cast<uint8_t>(rng());
+
+    for (size_t offset = 0; offset < 3; ++offset)
+    {
+        for (size_t length = 0; length + offset <= buffer.size() && length <= 3 * 256 + 17; ++length)
+        {
+            const auto* data = &buffer[offset];
+            const auto expected = reference(data, length);
+
+            wrong += Crc_t::compute(data, length) != expected;
+            wrong += static_cast<Value_t>(Crc_t::update_slicing(Crc_t::INIT, data, length) ^ Crc_t::XOR_OUT) != expected;
+            wrong += static_cast<Value_t>(Crc_t::update_scalar(Crc_t::INIT, data, length) ^ Crc_t::XOR_OUT) != expected;
+
+#if ECC_X86_64
+            if (length >= 64 && cpu_has_pclmul())
+                wrong += static_cast<Value_t>(Crc_t::update_folded(Crc_t::INIT, data, length) ^ Crc_t::XOR_OUT) != expected;
+#endif
+        }
+    }
+
+    CHECK(wrong == 0);
+
+    for (size_t piece = 1; piece <= buffer.size(); piece = piece * 3 + 1)
+    {
+        Crc_t crc;
+
+        for (size_t i = 0; i < buffer.size(); i += piece)
+            crc.update(&buffer[i], std::min(piece, buffer.size() - i));
+
+        wrong += crc.value() != Crc_t::compute(buffer.data(), buffer.size());
+
+        crc.reset();
+        crc.update(buffer.data(), 0);
+        wrong += crc.value() != Crc_t::compute(nullptr, 0);
+    }
+
+    CHECK(wrong == 0);
+}
+
+
+void test_crc()
+{
+    const char check[] = "123456789";
+
+    CHECK(Crc32c::compute(check, 9) == 0xE3069283);
+    CHECK(Crc64::compute(check, 9) == 0x995DC9BBDF1939FA);
+
+    check_crc_kernels<Crc32c>();
+    check_crc_kernels<Crc64>();
+}
+
+
+// every burst of up to Depth bits (first and last bit flipped, the ones between random) that
+// starts at every step-th stored bit is corrected by interleaved Hamming, and decode_batch gives
+// the same data and status as decode
+template <size_t Depth>
+void check_interleaved_bursts(size_t step)
+{
+    typedef InterleavedCode<HammingCode<64>, Depth> Code_t;
+
+    constexpr auto DW = Code_t::DATA_WORD_COUNT;
+    constexpr auto SW = Code_t::STORED_WORD_COUNT;
+    constexpr auto TOTAL = Code_t::TOTAL_BIT_COUNT;
+    constexpr size_t GROUPS = 4;
+
+    const Code_t code;
+    std::mt19937_64 rng(Depth);
+    std::vector<uint64_t> data(GROUPS * DW), encoded(GROUPS * SW);
+    size_t wrong = 0;
+
+    for (auto& word : data)
+        word = rng();
+
+    code.encode_batch(data.data(), GROUPS, encoded.data());
+
+    for (size_t g = 0; g < GROUPS; ++g)
+        wrong += words_to_bitset<TOTAL>(&encoded[g * SW]) != code.encode(words_to_bitset<Code_t::NUM_DATA_BITS>(&data[g * DW]));
+
+    CHECK(wrong == 0);
+
+    std::vector<uint64_t> corrupted;
+    std::vector<size_t> groups;
+
+    for (size_t start = 0; start < TOTAL; start += step)
+    {
+        for (size_t length = 1; length <= Depth && start + length <= TOTAL; ++length)
+        {
+            const auto g = groups.size() % GROUPS;
+
+            groups.push_back(g);
+            corrupted.insert(corrupted.end(), &encoded[g * SW], &encoded[g * SW] + SW);
+
+            auto* words = &corrupted[corrupted.size() - SW];
+
+            for (size_t bit = start; bit < start + length; ++bit)
+                if (bit == start || bit + 1 == start + length || (rng() & 1))
+                    flip_word_bit(words, bit);
+        }
+    }
+
+    std::vector<uint64_t> decoded(groups.size() * DW);
+    std::vector<uint8_t> status(groups.size());
+    size_t bad_outcome = 0;
+
+    code.decode_batch(corrupted.data(), groups.size(), decoded.data(), status.data());
+
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        const auto result = code.decode(words_to_bitset<TOTAL>(&corrupted[i * SW]));
+        const auto intact = result.decoded_bits == words_to_bitset<Code_t::NUM_DATA_BITS>(&data[groups[i] * DW]);
+
+        wrong += words_to_bitset<Code_t::NUM_DATA_BITS>(&decoded[i * DW]) != result.decoded_bits || status[i] != result.status();
+        bad_outcome += classify_outcome(intact, result.status()) != OUTCOME_CORRECTED;
+    }
+
+    CHECK(wrong == 0);
+    CHECK(bad_outcome == 0);
+}
+
+
+void test_interleaved()
+{
+    check_interleaved_bursts<2>(1);
+    check_interleaved_bursts<8>(1);
+    check_interleaved_bursts<64>(37);
+}
+
+
+// chipkill corrects every single symbol error (every position, every value) and detects every
+// double symbol error: all value pairs when there are at most max_pairs of them, else max_pairs
+// random ones per position pair. decode_batch agrees with decode throughout
+template <size_t SymbolBits>
+void check_chipkill(size_t max_pairs)
+{
+    typedef ChipkillCode<SymbolBits> Code_t;
+
+    constexpr auto DW = Code_t::DATA_WORD_COUNT;
+    constexpr auto SW = Code_t::STORED_WORD_COUNT;
+    constexpr auto SYMBOLS = Code_t::SYMBOL_COUNT;
+    constexpr auto MASK = Code_t::SYMBOL_MASK;
+
+    const Code_t code;
+    std::mt19937_64 rng(SymbolBits);
+    std::vector<uint64_t> data(DW), encoded(SW);
+
+    for (auto& word : data)
+        word = rng();
+
+    data[DW - 1] &= Code_t::LAST_DATA_WORD_MASK;
+    code.encode_batch(data.data(), 1, encoded.data());
+    CHECK(words_to_bitset<Code_t::TOTAL_BIT_COUNT>(encoded.data()) == code.encode(words_to_bitset<Code_t::DATA_BIT_COUNT>(data.data())));
+
+    const auto corrupt = [&](std::vector<uint64_t>& out, size_t position, uint32_t error)
+    {
+        auto* words = &out[out.size() - SW];
+
+        write_word_bits(words, position * SymbolBits, SymbolBits, read_word_bits(words, position * SymbolBits, SymbolBits) ^ error);
+    };
+
+    const auto decode_all = [&](const std::vector<uint64_t>& corrupted, DecodeOutcome expected)
+    {
+        const auto count = corrupted.size() / SW;
+        std::vector<uint64_t> decoded(count * DW);
+        std::vector<uint8_t> status(count);
+        size_t wrong = 0;
+        size_t bad_outcome = 0;
+
+        code.decode_batch(corrupted.data(), count, decoded.data(), status.data());
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto result = code.decode(words_to_bitset<Code_t::TOTAL_BIT_COUNT>(&corrupted[i * SW]));
+            const auto intact = result.decoded_bits == words_to_bitset<Code_t::DATA_BIT_COUNT>(data.data());
+
+            wrong += words_to_bitset<Code_t::DATA_BIT_COUNT>(&decoded[i * DW]) != result.decoded_bits || status[i] != result.status();
+            bad_outcome += classify_outcome(intact, result.status()) != expected;
+        }
+
+        CHECK(wrong == 0);
+        CHECK(bad_outcome == 0);
+    };
+
+    std::vector<uint64_t> singles;
+
+    for (size_t position = 0; position < SYMBOLS; ++position)
+    {
+        for (uint32_t error = 1; error <= MASK; ++error)
+        {
+            singles.insert(singles.end(), encoded.begin(), encoded.end());
+            corrupt(singles, position, error);
+        }
+    }
+
+    decode_all(singles, OUTCOME_CORRECTED);
+
+    const bool every_pair = size_t(MASK) * MASK <= max_pairs;
+    std::vector<uint64_t> doubles;
+
+    for (size_t first = 0; first < SYMBOLS; ++first)
+    {
+        for (size_t second = first + 1; second < SYMBOLS; ++second)
+        {
+            for (size_t n = 0; n < (every_pair ? size_t(MASK) * MASK : max_pairs); ++n)
+            {
+                doubles.insert(doubles.end(), encoded.begin(), encoded.end());
+                corrupt(doubles, first, every_pair ? uint32_t(n / MASK + 1) : uint32_t(rng() % MASK + 1));
+                corrupt(doubles, second, every_pair ? uint32_t(n % MASK + 1) : uint32_t(rng() % MASK + 1));
+            }
+        }
+    }
+
+    decode_all(doubles, OUTCOME_DETECTED);
+}
+
+
+void test_chipkill()
+{
+    check_chipkill<4>(225);
+    check_chipkill<8>(64);
+}
+
+
+// a run time code writes the same words as the template it mirrors, and decodes them (clean,
+// and with one or two flipped bits) to the same data and status
+template <class Strategy>
+void check_runtime_matches(const RuntimeCode& runtime)
+{
+    constexpr auto DW = Strategy::DATA_WORD_COUNT;
+    constexpr auto SW = Strategy::STORED_WORD_COUNT;
+    constexpr size_t COUNT = 33;
+
+    CHECK(runtime.data_bits() == Strategy::NUM_DATA_BITS);
+    CHECK(runtime.total_bits() == Strategy::NUM_ENCODED_BITS);
+    CHECK(runtime.data_word_count() == DW);
+    CHECK(runtime.stored_word_count() == SW);
+
+    const Strategy strategy;
+    std::mt19937_64 rng(Strategy::NUM_DATA_BITS);
+    std::vector<uint64_t> data(COUNT * DW), expected(COUNT * SW), encoded(COUNT * SW);
+    std::vector<uint64_t> expected_data(COUNT * DW), decoded(COUNT * DW);
+    std::vector<uint8_t> expected_status(COUNT), status(COUNT);
+
+    for (size_t i = 0; i < COUNT; ++i)
+        for (size_t w = 0; w < DW; ++w)
+            data[i * DW + w] = rng() & (w + 1 == DW ? Strategy::LAST_DATA_WORD_MASK : ~uint64_t(0));
+
+    strategy.encode_batch(data.data(), COUNT, expected.data());
+    runtime.encode_batch(data.data(), COUNT, encoded.data());
+    CHECK(encoded == expected);
+
+    for (size_t errors = 0; errors <= 2; ++errors)
+    {
+        auto corrupted = expected;
+
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            std::set<size_t> bits;
+
+            while (bits.size() < std::min<size_t>(errors, Strategy::NUM_ENCODED_BITS))
+                bits.insert(rng() % Strategy::NUM_ENCODED_BITS);
+
+            for (const auto bit : bits)
+                flip_word_bit(&corrupted[i * SW], bit);
+        }
+
+        strategy.decode_batch(corrupted.data(), COUNT, expected_data.data(), expected_status.data());
+        runtime.decode_batch(corrupted.data(), COUNT, decoded.data(), status.data());
+
+        CHECK(decoded == expected_data);
+        CHECK(status == expected_status);
+    }
+}
+
+
+template <size_t N>
+void check_runtime_widths()
+{
+    check_runtime_matches<HammingCode<N>>(RuntimeHammingCode(N));
+    check_runtime_matches<ParityBit<N>>(RuntimeParityBit(N));
+}
+
+
+void test_runtime_codes()
+{
+    check_runtime_widths<1>();
+    check_runtime_widths<63>();
+    check_runtime_widths<64>();
+    check_runtime_widths<65>();
+    check_runtime_widths<4096>();
+}
+
+
+// LinearCode built from a strategy's matrices encodes like it and decodes like it, with up to 3
+// flipped bits (for SEC-DED codes that takes in miscorrections and reported failures alike)
+template <class Strategy>
+void check_linear_code_matches(size_t count)
+{
+    typedef LinearCode<Strategy::NUM_DATA_BITS, Strategy::NUM_ENCODED_BITS> Linear_t;
+
+    constexpr auto DW = Strategy::DATA_WORD_COUNT;
+    constexpr auto SW = Strategy::STORED_WORD_COUNT;
+
+    const Strategy strategy;
+    Linear_t linear;
+
+    CHECK(linear.build(linear_code_matrices_of(strategy)));
+
+    std::mt19937_64 rng(Strategy::NUM_ENCODED_BITS);
+    std::vector<uint64_t> data(count * DW), expected(count * SW), encoded(count * SW);
+    std::vector<uint64_t> expected_data(count * DW), decoded(count * DW);
+    std::vector<uint8_t> expected_status(count), status(count);
+
+    for (size_t i = 0; i < count; ++i)
+        for (size_t w = 0; w < DW; ++w)
+            data[i * DW + w] = rng() & (w + 1 == DW ? Strategy::LAST_DATA_WORD_MASK : ~uint64_t(0));
+
+    strategy.encode_batch(data.data(), count, expected.data());
+    linear.encode_batch(data.data(), count, encoded.data());
+    CHECK(encoded == expected);
+
+    for (size_t errors = 0; errors <= 3; ++errors)
+    {
+        auto corrupted = expected;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::set<size_t> bits;
+
+            while (bits.size() < errors)
+                bits.insert(rng() % Strategy::NUM_ENCODED_BITS);
+
+            for (const auto bit : bits)
+                flip_word_bit(&corrupted[i * SW], bit);
+        }
+
+        strategy.decode_batch(corrupted.data(), count, expected_data.data(), expected_status.data());
+        linear.decode_batch(corrupted.data(), count, decoded.data(), status.data());
+
+        CHECK(decoded == expected_data);
+        CHECK(status == expected_status);
+    }
+}
+
+
+// LinearCode: matches HsiaoCode when built from its matrices, the Golay code corrects every
+// pattern of up to 3 errors on any data, and malformed matrices are refused
+void test_linear_code()
+{
+    check_linear_code_matches<HsiaoCode<64>>(256);
+    check_linear_code_matches<HsiaoCode<128>>(64);
+
+    std::istringstream golay_text(GOLAY_23_12);
+    LinearCodeMatrices matrices;
+    LinearCode<12, 23> golay;
+    std::string error;
+
+    CHECK(!golay.built());
+    CHECK(parse_linear_code_matrices(golay_text, matrices, error));
+    CHECK(golay.build(matrices, 3));
+    CHECK(golay.correct_weight() == 3);
+
+    // every pattern of weight 3 or less on a few random data words, through decode_batch
+    std::mt19937_64 rng(23);
+    std::vector<uint64_t> corrupted;
+    std::vector<uint64_t> words;
+    std::vector<size_t> weights;
+
+    for (size_t d = 0; d < 4; ++d)
+    {
+        const uint64_t data = rng() & low_bits_mask(12);
+        uint64_t encoded;
+
+        golay.encode_words(&data, &encoded);
+
+        for (uint64_t pattern = 0; pattern < (uint64_t(1) << 23); ++pattern)
+        {
+            const auto weight = popcount64(pattern);
+
+            if (weight > 3)
+                continue;
+
+            corrupted.push_back(encoded ^ pattern);
+            words.push_back(data);
+            weights.push_back(weight);
+        }
+    }
+
+    CHECK(corrupted.size() == 4 * 2048);
+
+    std::vector<uint64_t> decoded(corrupted.size());
+    std::vector<uint8_t> status(corrupted.size());
+    size_t wrong = 0;
+
+    golay.decode_batch(corrupted.data(), corrupted.size(), decoded.data(), status.data());
+
+    for (size_t i = 0; i < corrupted.size(); ++i)
+        wrong += decoded[i] != words[i] || status[i] != (weights[i] == 0 ? DECODE_CLEAN : DECODE_ERROR_DETECTED | DECODE_CORRECTED);
+
+    CHECK(wrong == 0);
+
+    // (7, 4) Hamming, G = [I | P] and H = [P^T | I]
+    const std::string g = "G\n1000110\n0100011\n0010111\n0001101\n";
+    const std::string h = "H\n1011100\n1110010\n0111001\n";
+
+    const auto parse = [](const std::string& text, LinearCodeMatrices& parsed)
+    {
+        std::istringstream in(text);
+        std::string parse_error;
+        const auto ok = parse_linear_code_matrices(in, parsed, parse_error);
+
+        // a refusal always says why
+        CHECK(ok == parse_error.empty());
+
+        return ok;
+    };
+
+    const auto parses = [&parse](const std::string& text)
+    {
+        LinearCodeMatrices parsed;
+
+        return parse(text, parsed);
+    };
+
+    for (const auto& text : { g, g + h, h + g })
+    {
+        LinearCodeMatrices parsed;
+        LinearCode<4, 7> hamming;
+
+        CHECK(parse(text, parsed) && hamming.build(parsed));
+    }
+
+    CHECK(!parses(""));
+    CHECK(!parses("1000110\n" + g));                                  // row before G / H
+    CHECK(!parses("G\n1000110\n0100011\n0010121\n0001101\n"));      // not binary
+    CHECK(!parses("G\n1000110\n0100011\n001011\n0001101\n"));       // short row
+    CHECK(!parses(g + "H\n1011100\n1110010\n"));                     // too few H rows
+    CHECK(!parses(g + h + "1111111\n"));                              // too many H rows
+    CHECK(!parses(g + "H\n1011100\n1110010\n0101110\n"));           // rank deficient H
+    CHECK(!parses("G\n1000110\n0100011\n1000110\n0001101\n"));     // rank deficient G
+    CHECK(!parses("G\n110\n011\n101\n"));                            // as many rows as columns
+
+    // G * H^T != 0 is left to build()
+    LinearCode<4, 7> wrong_size;
+
+    CHECK(parse(g + "H\n1011100\n1110010\n1000000\n", matrices));
+    CHECK(!wrong_size.build(matrices));
+    std::istringstream golay_again(GOLAY_23_12);
+
+    CHECK(parse_linear_code_matrices(golay_again, matrices, error));
+    CHECK(!wrong_size.build(matrices));
+    CHECK(!wrong_size.built() && !wrong_size.error().empty());
+}
+
+
+// all of a region's codewords, unpacked
+template <class Strategy>
+std::vector<uint64_t> stored_codewords(const ChunkArray<Strategy>& region)
+{
+    std::vector<uint64_t> encoded(region.chunk_count() * Strategy::STORED_WORD_COUNT);
+
+    region.load_chunks(0, region.chunk_count(), encoded.data());
+    return encoded;
+}
+
+
+// protect / verify_and_repair on a pool leave the same codewords, and report the same chunks,
+// as serial ChunkArray::write, reads of every chunk and writes of the corrected ones back
+template <class Strategy>
+void check_bulk_matches_serial(ThreadPool& pool, size_t blocks, bool corrects = true)
+{
+    typedef ChunkArray<Strategy> Region_t;
+
+    constexpr auto CHUNK_BYTES = Region_t::DATA_BYTES_PER_CHUNK;
+
+    // a partly written last chunk, and a short last parallel block
+    const size_t bytes = blocks * Region_t::PARALLEL_BLOCK_CHUNKS * CHUNK_BYTES + 5 * CHUNK_BYTES + 3;
+    const size_t length = bytes - CHUNK_BYTES / 2;
+
+    Region_t bulk(bytes, false, Strategy(), &pool);
+    Region_t serial(bytes);
+    std::mt19937_64 rng(24);
+    std::vector<uint8_t> data(length), chunk(CHUNK_BYTES);
+
+    for (auto& byte : data)
+        byte = static_cast<uint8_t>(rng());
+
+    protect(pool, bulk, data.data(), length);
+    serial.write(0, data.data(), length);
+
+    CHECK(stored_codewords(bulk) == stored_codewords(serial));
+
+    // 0 to 5 errors in every 7th chunk, the same in both
+    for (size_t c = 0; c < serial.chunk_count(); c += 7)
+    {
+        for (size_t e = 0; e < c % 6; ++e)
+        {
+            const auto bit = c * Strategy::NUM_ENCODED_BITS + rng() % Strategy::NUM_ENCODED_BITS;
+
+            bulk.corrupt(bit);
+            serial.corrupt(bit);
+        }
+    }
+
+    const auto corrupted = stored_codewords(serial);
+    BulkReport expected;
+
+    for (size_t c = 0; c < serial.chunk_count(); ++c)
+    {
+        const auto result = serial.read(c * CHUNK_BYTES, CHUNK_BYTES, chunk.data());
+
+        ++expected.codewords;
+
+        if (result.uncorrectable > 0)
+        {
+            ++expected.uncorrectable;
+            expected.uncorrectable_offsets.push_back(c * CHUNK_BYTES);
+        } else if (result.corrected > 0)
+        {
+            ++expected.corrected;
+            expected.corrected_offsets.push_back(c * CHUNK_BYTES);
+            serial.write(c * CHUNK_BYTES, chunk.data(), CHUNK_BYTES);
+        }
+    }
+
+    const auto same = [](const BulkReport& a, const BulkReport& b)
+    {
+        return a.codewords == b.codewords && a.corrected == b.corrected && a.uncorrectable == b.uncorrectable &&
+            a.corrected_offsets == b.corrected_offsets && a.uncorrectable_offsets == b.uncorrectable_offsets;
+    };
+
+    CHECK((expected.corrected > 0) == corrects && expected.uncorrectable > 0);
+
+    // checking only changes nothing
+    CHECK(same(verify_and_repair(pool, bulk, false), expected));
+    CHECK(stored_codewords(bulk) == corrupted);
+
+    CHECK(same(verify_and_repair(pool, bulk), expected));
+    CHECK(stored_codewords(bulk) == stored_codewords(serial));
+
+    // only the uncorrectable ones are left
+    const auto again = verify_and_repair(pool, bulk);
+
+    CHECK(again.corrected == 0 && again.uncorrectable_offsets == expected.uncorrectable_offsets);
+}
+
+
+void test_bulk_protect()
+{
+    ThreadPool pool(3);
+
+    check_bulk_matches_serial<HammingCode<64>>(pool, 3);
+    check_bulk_matches_serial<ParityBit<64>>(pool, 3, false);
+    check_bulk_matches_serial<BCHCode<512, 4>>(pool, 2);
+}
+
+
+// injected single bit errors are corrected and written back by a pass, a double error is
+// counted but left alone, and the data reads back intact
+void test_scrubber_repairs_injected_errors()
+{
+    typedef HammingCode<64> Strategy_t;
+    typedef ChunkArray<Strategy_t> Region_t;
+
+    constexpr size_t BYTES = 5 * Scrubber<Strategy_t>::SLICE_CHUNKS * Region_t::DATA_BYTES_PER_CHUNK + 24;
+
+    ThreadPool pool(3);
+    Region_t region(BYTES);
+    Scrubber<Strategy_t> scrubber(region, pool);
+    std::mt19937_64 rng(10);
+    std::vector<uint8_t> data(BYTES), out(BYTES);
+
+    for (auto& byte : data)
+        byte = static_cast<uint8_t>(rng());
+
+    scrubber.write(0, data.data(), BYTES);
+
+    // distinct chunks: the last one gets a second error, making it uncorrectable
+    std::set<size_t> chunks;
+
+    while (chunks.size() < 300)
+        chunks.insert(rng() % region.chunk_count());
+
+    for (const auto chunk : chunks)
+        region.corrupt(chunk * Region_t::NumEncodedBits + rng() % Region_t::NumEncodedBits);
+
+    const auto broken = *chunks.rbegin();
+
+    region.corrupt(broken * Region_t::NumEncodedBits + (broken * Region_t::NumEncodedBits + 1) % Region_t::NumEncodedBits);
+    region.corrupt(broken * Region_t::NumEncodedBits);
+
+    scrubber.scrub_pass();
+
+    auto stats = scrubber.stats();
+
+    CHECK(stats.passes == 1);
+    CHECK(stats.chunks_scrubbed == region.chunk_count());
+    CHECK(stats.uncorrectable == 1);
+    CHECK(stats.corrected + stats.uncorrectable == chunks.size());
+
+    // a second pass finds nothing left to correct
+    scrubber.scrub_pass();
+    stats = scrubber.stats();
+
+    CHECK(stats.corrected + stats.uncorrectable == chunks.size() + 1);
+
+    const auto result = scrubber.read(0, BYTES, out.data());
+    const auto broken_offset = broken * Region_t::DATA_BYTES_PER_CHUNK;
+
+    CHECK(result.corrected == 0);
+    CHECK(result.uncorrectable == 1);
+    CHECK(std::equal(data.begin(), data.begin() + broken_offset, out.begin()));
+    CHECK(std::equal(data.begin() + std::min(BYTES, broken_offset + Region_t::DATA_BYTES_PER_CHUNK), data.end(),
+                     out.begin() + std::min(BYTES, broken_offset + Region_t::DATA_BYTES_PER_CHUNK)));
+}
+
+
+// foreground writes through the scrubber while it runs in the background are never undone by
+// a write-back, and stop() doesn't wait out the rate limit
+void test_scrubber_background()
+{
+    typedef HammingCode<64> Strategy_t;
+    typedef ChunkArray<Strategy_t> Region_t;
+
+    constexpr size_t BYTES = 4 * Scrubber<Strategy_t>::SLICE_CHUNKS * Region_t::DATA_BYTES_PER_CHUNK;
+
+    ThreadPool pool(2);
+    Region_t region(BYTES);
+    Scrubber<Strategy_t> scrubber(region, pool);
+    std::mt19937_64 rng(11);
+    std::vector<uint8_t> data(BYTES, 0), out(BYTES);
+
+    for (size_t round = 0; round < 4; ++round)
+    {
+        // an error in every codeword for the scrubber to write back (injected while it's stopped:
+        // corrupt() isn't synchronized), then newer writes racing with those write-backs
+        for (size_t chunk = 0; chunk < region.chunk_count(); ++chunk)
+            region.corrupt(chunk * Region_t::NumEncodedBits + rng() % Region_t::NumEncodedBits);
+
+        const auto passes = scrubber.stats().passes;
+
+        scrubber.start();
+
+        // until the background thread has been over the whole region at least once
+        while (scrubber.stats().passes == passes)
+        {
+            const auto offset = rng() % BYTES;
+            const auto value = static_cast<uint8_t>(rng());
+
+            data[offset] = value;
+            scrubber.write(offset, &value, 1);
+            std::this_thread::yield();
+        }
+
+        // stopping cuts a pass short: finish it, so no codeword gets a second error next round
+        scrubber.stop();
+        scrubber.scrub_pass();
+    }
+
+    const auto result = scrubber.read(0, BYTES, out.data());
+
+    CHECK(result.corrected == 0);
+    CHECK(result.uncorrectable == 0);
+    CHECK(out == data);
+
+    // at one byte per second the next slice is due in hours; stop() must cut the wait short
+    scrubber.set_rate(1);
+    scrubber.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    scrubber.stop();
+
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    CHECK(!scrubber.running());
+}
+
+
+// a thread's telemetry slot is handed on when it exits: threads run one after another, many
+// more of them than there are slots, all count in the same slot and nothing is lost
+void test_telemetry_thread_slots()
+{
+    TelemetrySource source("test");
+    const auto threads = 3 * TelemetrySource::MAX_THREAD_SLOTS;
+
+    for (size_t i = 0; i < threads; ++i)
+        std::thread([&source] { source.record_encode(2, TelemetrySample::begin(2)); }).join();
+
+    CHECK(source.snapshot().encoded == 2 * threads);
+    CHECK(source.thread_slot_count() == 1);
+}
+
+
+// single codeword counts are batched per thread: they are all there once the counting thread
+// has exited, or straight away in its own snapshot, also when it switches between sources
+void test_telemetry_batches()
+{
+    TelemetrySource first("first");
+    TelemetrySource second("second");
+    const uint8_t corrected = DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+    const uint8_t uncorrectable = DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
+
+    std::thread([&]
+    {
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            first.count_encode();
+            second.count_decode(DECODE_CLEAN, true);
+        }
+
+        first.count_decode(corrected, true);
+        first.count_decode(corrected, false);
+        first.count_decode(uncorrectable, false);
+        first.count_decode(DECODE_CLEAN, false);
+    }).join();
+
+    const auto counted = first.snapshot();
+
+    CHECK(counted.encoded == 1000);
+    CHECK(counted.outcomes[OUTCOME_CLEAN] == 0 && counted.outcomes[OUTCOME_CORRECTED] == 1);
+    CHECK(counted.outcomes[OUTCOME_MISCORRECTED] == 1 && counted.outcomes[OUTCOME_DETECTED] == 1);
+    CHECK(counted.outcomes[OUTCOME_UNDETECTED] == 1);
+    CHECK(second.snapshot().outcomes[OUTCOME_CLEAN] == 1000 && second.snapshot().decoded() == 1000);
+
+    for (size_t i = 0; i < 3; ++i)
+        first.count_encode();
+
+    CHECK(first.snapshot().encoded == 1003);
+
+    const auto before = telemetry_of<ParityBit<3>>().snapshot().encoded;
+
+    for (size_t i = 0; i < 5; ++i)
+        TelemetrySource::count_encode_of<ParityBit<3>>();
+
+    CHECK(telemetry_of<ParityBit<3>>().snapshot().encoded == before + 5);
+}
+
+
+// retrieving a value from a chunk and unpacking it to a POD type doesn't touch the allocator
+void test_retrieval_allocations()
+{
+    typedef HammingCode<64> Hamming_t;
+
+    Hamming_t::Chunk_t chunk(std::make_shared<Hamming_t>());
+    auto bs = BitStream<64>::from(uint64_t(0x0123456789abcdef));
+    uint32_t halves[2];
+    size_t wrong = 0;
+
+    chunk.store(bs);
+    chunk.retrieve();   // anything allocated once, on first use (telemetry slots), is done with
+
+    const size_t before = g_allocations;
+
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        wrong += BitStream<64>(chunk.retrieve().decoded_bits).to<uint64_t>() != 0x0123456789abcdef;
+
+        BitStream<64>(chunk.retrieve_compact().decoded_bits).to_many(halves, 2);
+        wrong += halves[0] != 0x89abcdef || halves[1] != 0x01234567;
+    }
+
+    CHECK(g_allocations == before);
+    CHECK(wrong == 0);
+}
+
+
+// partial writes: the incremental update keeps a stored error for the next decode to correct,
+// the decoding default corrects it first, and one it can't correct blocks the write
+void test_chunk_update()
+{
+    StaticChunk<HammingCode<64>> hamming;
+
+    hamming.corrupt(5);
+    CHECK(hamming.update(8, 0xA5, 8) == DECODE_CLEAN);
+    CHECK(hamming.retrieve().stored_bits != HammingCode<64>().encode(hamming.retrieve().original_bits));
+
+    auto result = hamming.retrieve();
+
+    CHECK(result.correct);
+    CHECK(result.status() == (DECODE_ERROR_DETECTED | DECODE_CORRECTED));
+    CHECK(read_bitset_bits(result.decoded_bits, 8, 8) == 0xA5);
+
+    // long writes take the encode path: still the codeword of the data, error and all
+    StaticChunk<HsiaoCode<64>> hsiao;
+
+    hsiao.corrupt(70);
+    CHECK(hsiao.update(16, 0x0123456789AB, 48) == DECODE_CLEAN);
+    CHECK(hsiao.update(8, 0x5A5A, 16) == DECODE_CLEAN);
+    CHECK(hsiao.update(0, 0, 8) == DECODE_CLEAN);
+
+    const auto error = hsiao.retrieve().stored_bits ^ HsiaoCode<64>().encode(hsiao.retrieve().original_bits);
+
+    CHECK(error.count() == 1 && error.test(70));
+
+    CHECK(hamming.update(0, 0xFFFFFFFFFFFF, 48) == DECODE_CLEAN);
+    result = hamming.retrieve();
+    CHECK(result.correct);
+    CHECK(result.status() == (DECODE_ERROR_DETECTED | DECODE_CORRECTED));
+
+    // and one of every data bit replaces the codeword, error included
+    CHECK(hamming.update(0, ~uint64_t(0), 64) == DECODE_CLEAN);
+    CHECK(hamming.retrieve().status() == DECODE_CLEAN);
+
+    StaticChunk<BCHCode<64, 2>> bch;
+
+    bch.corrupt(40);
+    CHECK(bch.update(0, 0x1234, 16) == (DECODE_ERROR_DETECTED | DECODE_CORRECTED));
+
+    const auto bch_result = bch.retrieve();
+
+    CHECK(bch_result.correct);
+    CHECK(bch_result.status() == DECODE_CLEAN);
+    CHECK(read_bitset_bits(bch_result.decoded_bits, 0, 16) == 0x1234);
+
+    StaticChunk<Crc32cCheck<512>> crc;
+
+    crc.corrupt(100);
+
+    const auto before = crc.retrieve().stored_bits;
+    const auto status = crc.update(64, ~uint64_t(0), 64);
+
+    CHECK(decode_unrepaired(status));
+    CHECK(crc.retrieve().stored_bits == before);
+    CHECK(read_bitset_bits(crc.retrieve().original_bits, 64, 64) == 0);
+}
+
+
+// a block never holds more codewords than the data needs, and parse() only accepts the layout
+// make() gives: headers with a consistent CRC but tampered fields are rejected
+void test_container_header()
+{
+    const auto small = ContainerHeader::make(CONTAINER_BCH_32768_8, 32768, 32896, 3, 1 << 20);
+
+    CHECK(small.codewords_per_block() == 1);
+    CHECK(small.block_count == 1);
+    CHECK(small.container_size() == ContainerHeader::BODY_OFFSET + 8192);
+
+    const auto header = ContainerHeader::make(CONTAINER_HAMMING_64, 64, 72, 100000, 4096);
+    std::vector<uint8_t> container(static_cast<size_t>(header.container_size()));
+    ContainerHeader parsed;
+    std::string error;
+
+    const auto parses = [&](const ContainerHeader& candidate)
+    {
+        candidate.serialize(container.data());
+        return ContainerHeader::parse(container.data(), container.size(), parsed, error);
+    };
+
+    CHECK(parses(header));
+    CHECK(parsed.codewords_per_block() == header.codewords_per_block());
+    CHECK(parsed.container_size() == container.size());
+
+    auto bad = header;
+    bad.block_stored_bytes += ContainerHeader::BLOCK_ALIGNMENT;
+    CHECK(!parses(bad));
+
+    bad = header;
+    bad.block_data_bytes -= 3;
+    CHECK(!parses(bad));
+
+    bad = header;
+    bad.stored_bits = 71;
+    CHECK(!parses(bad));
+
+    bad = header;
+    bad.original_size = UINT64_MAX;
+    CHECK(!parses(bad));
+
+    bad = header;
+    bad.block_count = UINT64_MAX / header.block_stored_bytes + 1;
+    CHECK(!parses(bad));
+
+    bad = header;
+    bad.block_data_bytes *= 2;
+    bad.block_count = (bad.original_size + bad.block_data_bytes - 1) / bad.block_data_bytes;
+    CHECK(!parses(bad));
+
+    container.resize(container.size() - 1);
+    CHECK(!parses(header));
+}
+
+
+int main()
+{
+    const struct
+    {
+        const char* name;
+        void (*run)();
+    } tests[] = {
+        { "bitsliced hamming", test_bitsliced_hamming },
+        { "fault injection", test_fault_injection },
+        { "error patterns", test_error_patterns },
+        { "hsiao", test_hsiao },
+        { "reed solomon", test_reed_solomon },
+        { "bch", test_bch },
+        { "crc", test_crc },
+        { "interleaved bursts", test_interleaved },
+        { "chipkill", test_chipkill },
+        { "runtime codes", test_runtime_codes },
+        { "linear code", test_linear_code },
+        { "bulk protect", test_bulk_protect },
+        { "scrubber repairs injected errors", test_scrubber_repairs_injected_errors },
+        { "scrubber background", test_scrubber_background },
+        { "telemetry thread slots", test_telemetry_thread_slots },
+        { "telemetry batches", test_telemetry_batches },
+        { "retrieval allocations", test_retrieval_allocations },
+        { "chunk update", test_chunk_update },
+        { "container header", test_container_header },
+    };
+
+    for (const auto& test : tests)
+    {
+        const auto before = g_failures;
+
+        test.run();
+        cout << (g_failures == before ? "ok      " : "FAILED  ") << test.name << endl;
+    }
+
+    return g_failures == 0 ? 0 : 1;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end 440_ECC_Tests.cpp
+ *///////////////////////////////////////////////////////////////////////////*/
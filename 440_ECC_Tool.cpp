@@ -0,0 +1,408 @@
+/*-----------------------------------------------------------------------------
+ * 440_ECC_Tool.cpp
+ *---------------------------------------------------------------------------*/
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include "EccContainer.h"
+#include "EccTelemetry.h"
+#include "MappedFile.h"
+#include "BlockPipeline.h"
+#include "ThreadPool.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+
+/*
+ * ecc: protects files with the codes of this project, in the container of EccContainer.h.
+ *
+ * Input and output are memory mapped, and blocks go through run_block_pipeline: the main thread
+ * starts readahead for blocks entering the window, the pool encodes / decodes them straight
+ * from one mapping into the other, and the main thread then flushes each finished block's
+ * output, drops its input pages and reports on it, in block order
+ */
+struct Options
+{
+    std::string code = "bch512t4";
+    size_t block_bytes = 1 << 20;
+    size_t threads = 0;
+    size_t window = 0;              // blocks in flight; 0 = 4 per thread
+    size_t bits = 1;                // for corrupt
+    uint64_t seed = 1;
+    bool all_blocks = false;
+    std::string telemetry_path;     // where to export telemetry, if anywhere
+    std::vector<std::string> paths;
+};
+
+
+void print_usage(const char* executable)
+{
+    cerr << "usage: " << executable << " encode [--code=NAME] [--block-size=BYTES] [OPTIONS] INPUT CONTAINER\n"
+         << "       " << executable << " decode [OPTIONS] CONTAINER OUTPUT\n"
+         << "       " << executable << " verify [OPTIONS] CONTAINER\n"
+         << "       " << executable << " repair [OPTIONS] CONTAINER\n"
+         << "       " << executable << " corrupt [--bits=N] [--seed=S] CONTAINER\n"
+         << "       " << executable << " codes\n"
+         << "options:\n"
+         << "  --threads=N    worker threads (default: one per hardware thread)\n"
+         << "  --window=N     blocks in flight (default: 4 per thread)\n"
+         << "  --all-blocks   report every block, not just those with errors\n"
+         << "  --telemetry=FILE\n"
+         << "                 write codec telemetry to FILE afterwards: JSON if it ends in .json,\n"
+         << "                 Prometheus text otherwise (needs a build with ECC_TELEMETRY)\n"
+         << "decode / verify / repair exit with 1 if any codeword was uncorrectable\n";
+}
+
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+void print_rate(const char* what, uint64_t bytes, double seconds)
+{
+    cout << what << " " << bytes << " bytes in " << std::fixed << std::setprecision(3) << seconds << " s ("
+         << std::setprecision(1) << (seconds > 0 ? bytes / seconds / 1e6 : 0.0) << " MB/s)" << std::defaultfloat << endl;
+}
+
+
+int encode(const Options& options)
+{
+    const auto* info = find_container_code(options.code);
+
+    if (info == nullptr)
+    {
+        cerr << "unknown code " << options.code << " (see: codes)\n";
+        return 2;
+    }
+
+    MappedFile input;
+    MappedFile output;
+
+    if (!input.open_read(options.paths[0]))
+    {
+        cerr << input.error() << "\n";
+        return 1;
+    }
+
+    bool ok = true;
+    const auto start = std::chrono::steady_clock::now();
+
+    with_container_code(info->code, [&](auto tag)
+    {
+        typedef typename decltype(tag)::type Strategy;
+        typedef ContainerBlockCodec<Strategy> Codec_t;
+
+        const auto header = ContainerHeader::make(info->code, Codec_t::DATA_BITS, Codec_t::STORED_BITS, input.size(), options.block_bytes);
+
+        if (!output.create(options.paths[1], static_cast<size_t>(header.container_size())))
+        {
+            cerr << output.error() << "\n";
+            ok = false;
+            return;
+        }
+
+        header.serialize(output.data());
+        input.advise_sequential();
+
+        ThreadPool pool(options.threads);
+        const Codec_t codec;
+        const auto window = options.window != 0 ? options.window : 4 * pool.size();
+
+        run_block_pipeline(pool, static_cast<size_t>(header.block_count), window,
+            [&](size_t block)
+            {
+                input.prefetch(block * header.block_data_bytes, header.block_data_bytes);
+            },
+            [&](size_t block)
+            {
+                auto* stored = reinterpret_cast<uint64_t*>(output.data() + header.block_offset(block));
+
+                codec.encode_block(input.data() + block * header.block_data_bytes, header.block_length(block),
+                                   header.codewords_per_block(), stored);
+            },
+            [&](size_t block)
+            {
+                ok &= output.flush(header.block_offset(block), header.block_stored_bytes, false);
+                input.release(block * header.block_data_bytes, header.block_data_bytes);
+            });
+
+        ok &= output.flush(0, output.size(), true);
+
+        cout << "code " << info->name << ": " << header.block_count << " blocks of " << header.block_data_bytes
+             << " data bytes (" << header.block_stored_bytes << " stored)" << endl;
+    });
+
+    if (ok)
+        print_rate("encoded", input.size(), seconds_since(start));
+    else
+        cerr << "writing " << options.paths[1] << " failed\n";
+
+    return ok ? 0 : 1;
+}
+
+
+// decode (output != null), verify (no output, no repair) and repair (no output)
+int check(const Options& options, const std::string& container_path, const std::string* output_path, bool repair)
+{
+    MappedFile container;
+    MappedFile output;
+    ContainerHeader header;
+    std::string error;
+
+    if (!container.open(container_path, repair) || !ContainerHeader::parse(container.data(), container.size(), header, error))
+    {
+        cerr << (error.empty() ? container.error() : container_path + ": " + error) << "\n";
+        return 1;
+    }
+
+    if (output_path != nullptr && !output.create(*output_path, static_cast<size_t>(header.original_size)))
+    {
+        cerr << output.error() << "\n";
+        return 1;
+    }
+
+    BlockReport total;
+    bool ok = true;
+    const auto start = std::chrono::steady_clock::now();
+
+    with_container_code(header.code, [&](auto tag)
+    {
+        typedef typename decltype(tag)::type Strategy;
+        typedef ContainerBlockCodec<Strategy> Codec_t;
+
+        ThreadPool pool(options.threads);
+        const Codec_t codec;
+        const auto window = options.window != 0 ? options.window : 4 * pool.size();
+        std::vector<BlockReport> reports(window);
+
+        container.advise_sequential();
+
+        run_block_pipeline(pool, static_cast<size_t>(header.block_count), window,
+            [&](size_t block)
+            {
+                container.prefetch(header.block_offset(block), header.block_stored_bytes);
+            },
+            [&](size_t block)
+            {
+                auto* stored = reinterpret_cast<uint64_t*>(container.data() + header.block_offset(block));
+                auto* data = output_path != nullptr ? output.data() + block * header.block_data_bytes : nullptr;
+
+                reports[block % window] = codec.decode_block(stored, header.codewords_per_block(), data, header.block_length(block), repair);
+            },
+            [&](size_t block)
+            {
+                const auto& report = reports[block % window];
+
+                if (output_path != nullptr)
+                    ok &= output.flush(block * header.block_data_bytes, header.block_data_bytes, false);
+
+                if (repair && report.corrected > 0)
+                    ok &= container.flush(header.block_offset(block), header.block_stored_bytes, false);
+                else
+                    container.release(header.block_offset(block), header.block_stored_bytes);
+
+                if (options.all_blocks || report.corrected > 0 || report.uncorrectable > 0)
+                    cout << "block " << block << ": " << report.codewords << " codewords, " << report.corrected
+                         << " corrected, " << report.uncorrectable << " uncorrectable" << endl;
+
+                total.codewords += report.codewords;
+                total.corrected += report.corrected;
+                total.uncorrectable += report.uncorrectable;
+            });
+
+        if (output_path != nullptr)
+            ok &= output.flush(0, output.size(), true);
+
+        if (repair)
+            ok &= container.flush(0, container.size(), true);
+    });
+
+    if (!ok)
+        return 1;
+
+    cout << find_container_code(header.code)->name << ": " << header.block_count << " blocks, " << total.codewords << " codewords, "
+         << total.corrected << " corrected" << (repair ? " (rewritten)" : "") << ", " << total.uncorrectable << " uncorrectable" << endl;
+    print_rate(output_path != nullptr ? "decoded" : repair ? "repaired" : "verified", header.original_size, seconds_since(start));
+
+    return total.uncorrectable > 0 ? 1 : 0;
+}
+
+
+// flips random stored bits, for trying out decode / repair
+int corrupt(const Options& options)
+{
+    MappedFile container;
+    ContainerHeader header;
+    std::string error;
+
+    if (!container.open_write(options.paths[0]) || !ContainerHeader::parse(container.data(), container.size(), header, error))
+    {
+        cerr << (error.empty() ? container.error() : options.paths[0] + ": " + error) << "\n";
+        return 1;
+    }
+
+    if (header.block_count == 0)
+        return 0;
+
+    std::mt19937_64 rng(options.seed);
+    const auto block_bits = header.codewords_per_block() * uint64_t(header.stored_bits);
+
+    for (size_t i = 0; i < options.bits; ++i)
+    {
+        const auto block = rng() % header.block_count;
+        const auto bit = rng() % block_bits;
+
+        flip_word_bit(reinterpret_cast<uint64_t*>(container.data() + header.block_offset(block)), static_cast<size_t>(bit));
+    }
+
+    if (!container.flush(0, container.size(), true))
+    {
+        cerr << "writing " << options.paths[0] << " failed\n";
+        return 1;
+    }
+
+    cout << "flipped " << options.bits << " bits" << endl;
+
+    return 0;
+}
+
+
+bool parse_size(const std::string& text, size_t& value)
+{
+    char* end;
+
+    value = static_cast<size_t>(strtoull(text.c_str(), &end, 10));
+
+    if (end == text.c_str())
+        return false;
+
+    if (*end == 'k' || *end == 'K') value <<= 10, ++end;
+    else if (*end == 'm' || *end == 'M') value <<= 20, ++end;
+
+    return *end == '\0';
+}
+
+
+// exports what the codecs reported, in the format the file name asks for
+bool write_telemetry(const std::string& path)
+{
+    if (!ECC_TELEMETRY)
+    {
+        cerr << "telemetry is not compiled in (configure with -DECC_TELEMETRY=ON)" << endl;
+        return false;
+    }
+
+    std::ofstream out(path);
+    const auto snapshot = telemetry_snapshot();
+    const auto json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+    out << (json ? snapshot.to_json() : snapshot.to_prometheus());
+
+    if (!out)
+    {
+        cerr << "can't write " << path << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    const std::string command = argv[1];
+    Options options;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        size_t value;
+        bool valid = true;
+
+        if (arg.compare(0, 7, "--code=") == 0)
+            options.code = arg.substr(7);
+        else if (arg.compare(0, 13, "--block-size=") == 0)
+            valid = parse_size(arg.substr(13), options.block_bytes) && options.block_bytes > 0;
+        else if (arg.compare(0, 10, "--threads=") == 0)
+            valid = parse_size(arg.substr(10), options.threads);
+        else if (arg.compare(0, 9, "--window=") == 0)
+            valid = parse_size(arg.substr(9), options.window);
+        else if (arg.compare(0, 7, "--bits=") == 0)
+            valid = parse_size(arg.substr(7), options.bits);
+        else if (arg.compare(0, 7, "--seed=") == 0)
+        {
+            valid = parse_size(arg.substr(7), value);
+            options.seed = value;
+        }
+        else if (arg == "--all-blocks")
+            options.all_blocks = true;
+        else if (arg.compare(0, 12, "--telemetry=") == 0)
+        {
+            options.telemetry_path = arg.substr(12);
+            valid = !options.telemetry_path.empty();
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+            valid = false;
+        else
+            options.paths.push_back(arg);
+
+        if (!valid)
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    const auto paths = options.paths.size();
+
+    if (command == "codes" && paths == 0)
+    {
+        for (const auto& info : CONTAINER_CODES)
+            cout << std::left << std::setw(12) << info.name << info.description << endl;
+
+        return 0;
+    }
+
+    int status;
+
+    if (command == "encode" && paths == 2)
+        status = encode(options);
+    else if (command == "decode" && paths == 2)
+        status = check(options, options.paths[0], &options.paths[1], false);
+    else if (command == "verify" && paths == 1)
+        status = check(options, options.paths[0], nullptr, false);
+    else if (command == "repair" && paths == 1)
+        status = check(options, options.paths[0], nullptr, true);
+    else if (command == "corrupt" && paths == 1)
+        status = corrupt(options);
+    else
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    if (!options.telemetry_path.empty() && !write_telemetry(options.telemetry_path))
+        return 2;
+
+    return status;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end 440_ECC_Tool.cpp
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,537 @@
+/*-----------------------------------------------------------------------------
+ * BCHCode.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include "CorrectionStrategy.h"
+#include "Chunk.h"
+#include "GaloisField.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// degree of the BCH generator over GF(2^m) for t errors: the product of the minimal polynomials
+// of alpha^1, alpha^3, ..., alpha^(2t - 1), each of degree the size of its cyclotomic coset
+// {i, 2i, 4i, ...} mod 2^m - 1. Cosets that already contain a smaller odd i were counted there
+constexpr size_t calc_bch_check_bits(size_t field_bits, size_t t)
+{
+    const size_t n = (size_t(1) << field_bits) - 1;
+    size_t degree = 0;
+
+    for (size_t i = 1; i < 2 * t; i += 2)
+    {
+        bool counted = false;
+        size_t size = 0;
+        size_t e = i;
+
+        do
+        {
+            counted |= e % 2 == 1 && e < i;
+            e = (2 * e) % n;
+            ++size;
+        } while (e != i);
+
+        if (!counted)
+            degree += size;
+    }
+
+    return degree;
+}
+
+
+// smallest field whose (shortened) code length 2^m - 1 holds the data and check bits
+constexpr size_t calc_bch_field_bits(size_t dataBits, size_t t, size_t field_bits = 3)
+{
+    return (size_t(1) << field_bits) - 1 > 2 * t && (size_t(1) << field_bits) - 1 >= dataBits + calc_bch_check_bits(field_bits, t)
+               ? field_bits
+               : calc_bch_field_bits(dataBits, t, field_bits + 1);
+}
+
+
+/*
+ * Binary BCH code correcting any T bit errors in NumDataBits data bits, shortened from length
+ * 2^m - 1 (m = FIELD_BITS, the smallest field that fits). Where Hamming / Hsiao stop at one bad
+ * bit, this goes on to T: e.g. BCHCode<512, 4> corrects 4 bits of a 512 bit block with 40 check
+ * bits, BCHCode<32768, 8> 8 bits of a 4 KiB page with 128.
+ *
+ * Systematic, data bits first and the check bits after, codeword bit p the coefficient of
+ * x^(N - 1 - p). The check bits are the remainder of d(x) * x^r by the generator g(x), computed
+ * the way table driven CRCs are: the remainder register is kept bit reversed, so a whole data
+ * word folds in at once, and the 64 bits pushed out of it are reduced with eight 256 entry
+ * tables, one per byte (slicing by 8). Tails shorter than a word go a byte, then a bit, at a time.
+ *
+ * Decoding recomputes the remainder and XORs it with the stored check bits. Zero is clean;
+ * otherwise the odd syndromes S_1, S_3, ... come from that r bit remainder (the even ones are
+ * squares), Berlekamp-Massey finds the error locator, and a Chien search its roots. The search
+ * steps every term by a constant in the log domain, a table lookup and a subtraction per term
+ * and position, and stops as soon as all roots are found. One or two errors need no search:
+ * their locators are solved directly, the quadratic through GF2m::solve_quadratic. A locator of
+ * degree > T, or fewer roots than its degree, is uncorrectable
+ */
+template <size_t NumDataBits, size_t T>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class BCHCode : public CorrectionStrategy<NumDataBits, NumDataBits + calc_bch_check_bits(calc_bch_field_bits(NumDataBits, T), T)>
+{
+    static_assert(T > 0, "BCH needs to correct at least one error");
+
+public:
+    static constexpr size_t CORRECTABLE_BITS = T;
+    static constexpr size_t FIELD_BITS = calc_bch_field_bits(NumDataBits, T);
+
+    static constexpr size_t DATA_BIT_COUNT = NumDataBits;
+    static constexpr size_t CHECK_BIT_COUNT = calc_bch_check_bits(FIELD_BITS, T);
+    static constexpr size_t TOTAL_BIT_COUNT = DATA_BIT_COUNT + CHECK_BIT_COUNT;
+    static constexpr size_t CHECK_WORD_COUNT = word_count(CHECK_BIT_COUNT);
+    static constexpr size_t CHECK_BYTE_COUNT = (CHECK_BIT_COUNT + 7) / 8;
+
+    typedef GF2m<FIELD_BITS> Field_t;
+
+    typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
+    typedef DecodeResult<NumDataBits, TOTAL_BIT_COUNT> DecodeResult_t;
+    typedef Chunk<NumDataBits, TOTAL_BIT_COUNT> Chunk_t;
+
+    typedef CorrectionStrategy<NumDataBits, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+    using Strategy_t::LAST_STORED_WORD_MASK;
+
+private:
+    typedef std::array<uint64_t, CHECK_WORD_COUNT> Register_t;
+
+    // the reduction tables: entry [j * 256 + b] (CHECK_WORD_COUNT words) is what byte j of the
+    // 64 bits shifted out of the register, having value b, adds to it. Built on first use
+    static const std::vector<uint64_t>& remainder_tables()
+    {
+        static const std::vector<uint64_t> tables = []
+        {
+            constexpr size_t R = CHECK_BIT_COUNT;
+
+            const auto* exp = Field_t::exp_table();
+            std::vector<uint8_t> generator{ 1 };         // coefficient of x^i at [i]
+            std::vector<bool> seen(Field_t::ORDER);
+
+            for (size_t i = 1; i < 2 * T; i += 2)
+            {
+                if (seen[i])
+                    continue;
+
+                // minimal polynomial of alpha^i: product of (x + alpha^e) over its coset
+                std::vector<uint16_t> minimal{ 1 };
+                size_t e = i;
+
+                do
+                {
+                    seen[e] = true;
+                    minimal.push_back(0);
+
+                    for (size_t j = minimal.size() - 1; j > 0; --j)
+                        minimal[j] = minimal[j - 1] ^ Field_t::mul(minimal[j], exp[e]);
+
+                    minimal[0] = Field_t::mul(minimal[0], exp[e]);
+                    e = (2 * e) % Field_t::ORDER;
+                } while (e != i);
+
+                // its coefficients are 0 or 1, so the rest is a binary polynomial product
+                std::vector<uint8_t> product(generator.size() + minimal.size() - 1);
+
+                for (size_t a = 0; a < generator.size(); ++a)
+                    for (size_t b = 0; b < minimal.size(); ++b)
+                        product[a + b] ^= generator[a] & static_cast<uint8_t>(minimal[b]);
+
+                generator = product;
+            }
+
+            // bit q (of the 64 shifted out) stands for x^(R + 63 - q); reduce each mod g(x)
+            std::vector<uint64_t> powers(64 * CHECK_WORD_COUNT);
+            std::vector<uint8_t> rem(generator.begin(), generator.begin() + R);  // x^R mod g
+
+            for (size_t s = 0; s < 64; ++s)
+            {
+                // register bit i holds the coefficient of x^(R - 1 - i)
+                for (size_t i = 0; i < R; ++i)
+                    if (rem[R - 1 - i])
+                        flip_word_bit(&powers[(63 - s) * CHECK_WORD_COUNT], i);
+
+                const auto carry = rem[R - 1];
+
+                for (size_t i = R - 1; i > 0; --i)
+                    rem[i] = rem[i - 1] ^ (carry & generator[i]);
+
+                rem[0] = carry & generator[0];
+            }
+
+            std::vector<uint64_t> t(8 * 256 * CHECK_WORD_COUNT);
+
+            for (size_t j = 0; j < 8; ++j)
+                for (size_t b = 0; b < 256; ++b)
+                    for (size_t k = 0; k < 8; ++k)
+                        if (b & (size_t(1) << k))
+                            for (size_t w = 0; w < CHECK_WORD_COUNT; ++w)
+                                t[(j * 256 + b) * CHECK_WORD_COUNT + w] ^= powers[(8 * j + k) * CHECK_WORD_COUNT + w];
+
+            return t;
+        }();
+
+        return tables;
+    }
+
+
+    // what a remainder byte adds to the odd syndromes: entry [(i * 256 + b) * T + k] is the sum
+    // of alpha^((2k + 1) * (r - 1 - bit)) over the bits set in value b of byte i. Built on first use
+    static const std::vector<uint16_t>& syndrome_tables()
+    {
+        static const std::vector<uint16_t> tables = []
+        {
+            std::vector<uint16_t> t(CHECK_BYTE_COUNT * 256 * T);
+
+            for (size_t i = 0; i < CHECK_BYTE_COUNT; ++i)
+                for (size_t b = 0; b < 256; ++b)
+                    for (size_t bit = 0; bit < 8; ++bit)
+                        if ((b & (size_t(1) << bit)) && 8 * i + bit < CHECK_BIT_COUNT)
+                            for (size_t k = 0; k < T; ++k)
+                                t[(i * 256 + b) * T + k] ^= Field_t::exp((2 * k + 1) * (CHECK_BIT_COUNT - 1 - 8 * i - bit));
+
+            return t;
+        }();
+
+        return tables;
+    }
+
+
+    static void fold(Register_t& reg, const uint64_t* entry)
+    {
+        for (size_t w = 0; w < CHECK_WORD_COUNT; ++w)
+            reg[w] ^= entry[w];
+    }
+
+
+    // reg >>= shift (< 64) across the register words
+    static void shift_right(Register_t& reg, size_t shift)
+    {
+        for (size_t w = 0; w + 1 < CHECK_WORD_COUNT; ++w)
+            reg[w] = (reg[w] >> shift) | (reg[w + 1] << (WORD_BITS - shift));
+
+        reg[CHECK_WORD_COUNT - 1] >>= shift;
+    }
+
+public:
+    // remainder of d(x) * x^r mod g(x), bit reversed (bit i = coefficient of x^(r - 1 - i)),
+    // which is the check bits in stored order. Reads only the first DATA_BIT_COUNT bits of data
+    static void compute_remainder(const uint64_t* data, uint64_t* remainder)
+    {
+        const auto* tables = remainder_tables().data();
+        Register_t reg{};
+
+        for (size_t w = 0; w < DATA_BIT_COUNT / WORD_BITS; ++w)
+        {
+            const auto v = reg[0] ^ data[w];
+
+            std::copy(reg.begin() + 1, reg.end(), reg.begin());
+            reg[CHECK_WORD_COUNT - 1] = 0;
+
+            for (size_t j = 0; j < 8; ++j)
+                fold(reg, tables + (j * 256 + ((v >> (8 * j)) & 0xFF)) * CHECK_WORD_COUNT);
+        }
+
+        size_t bit = DATA_BIT_COUNT / WORD_BITS * WORD_BITS;
+
+        for (; bit + 8 <= DATA_BIT_COUNT; bit += 8)
+        {
+            const auto v = (reg[0] ^ (data[bit / WORD_BITS] >> (bit % WORD_BITS))) & 0xFF;
+
+            shift_right(reg, 8);
+            fold(reg, tables + (7 * 256 + v) * CHECK_WORD_COUNT);
+        }
+
+        for (; bit < DATA_BIT_COUNT; ++bit)
+        {
+            const auto v = (reg[0] ^ (data[bit / WORD_BITS] >> (bit % WORD_BITS))) & 1;
+
+            shift_right(reg, 1);
+
+            // x^r: the top bit of the last table byte
+            if (v)
+                fold(reg, tables + (7 * 256 + 0x80) * CHECK_WORD_COUNT);
+        }
+
+        std::copy(reg.begin(), reg.end(), remainder);
+    }
+
+
+    // packed word kernels: encoded holds STORED_WORD_COUNT words, data DATA_WORD_COUNT words
+    static void encode_words(const uint64_t* data, uint64_t* encoded)
+    {
+        Register_t check;
+
+        std::fill(encoded, encoded + STORED_WORD_COUNT, 0);
+        std::copy(data, data + DATA_WORD_COUNT, encoded);
+        encoded[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        compute_remainder(encoded, check.data());
+        copy_word_bits(encoded, DATA_BIT_COUNT, check.data(), 0, CHECK_BIT_COUNT);
+    }
+
+
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data)
+    {
+        size_t corrupt_bits;
+        uint16_t syndrome;
+
+        return decode_words(encoded, data, corrupt_bits, syndrome);
+    }
+
+
+    // as above, also hands back the number of bits corrected (when correctable) and the low 16
+    // bits of the remainder syndrome
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data, size_t& corrupt_bits, uint16_t& syndrome)
+    {
+        const uint8_t failed = DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
+
+        Register_t remainder;
+        Register_t stored{};
+
+        compute_remainder(encoded, remainder.data());
+        copy_word_bits(stored.data(), 0, encoded, DATA_BIT_COUNT, CHECK_BIT_COUNT);
+
+        bool clean = true;
+
+        for (size_t w = 0; w < CHECK_WORD_COUNT; ++w)
+        {
+            remainder[w] ^= stored[w];
+            clean &= remainder[w] == 0;
+        }
+
+        std::copy(encoded, encoded + DATA_WORD_COUNT, data);
+        data[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        corrupt_bits = 0;
+        syndrome = static_cast<uint16_t>(remainder[0]);
+
+        if (clean)
+            return DECODE_CLEAN;
+
+        constexpr size_t n = Field_t::ORDER;
+
+        const auto* exp = Field_t::exp_table();
+        const auto* log = Field_t::log_table();
+
+        const auto mul = [exp, log](uint16_t a, uint16_t b) -> uint16_t
+        {
+            return a == 0 || b == 0 ? 0 : exp[log[a] + log[b]];
+        };
+
+        // S_j = s(alpha^j), j = 1..2T at [j - 1]; s(x) is the remainder, which has the same
+        // roots as the received word. Odd ones a table lookup per remainder byte, S_2j = S_j^2
+        std::array<uint16_t, 2 * T> syndromes{};
+
+        const auto* powers = syndrome_tables().data();
+
+        for (size_t byte = 0; byte < CHECK_BYTE_COUNT; ++byte)
+        {
+            const auto b = (remainder[byte / 8] >> (8 * (byte % 8))) & 0xFF;
+            const auto* entry = powers + (byte * 256 + b) * T;
+
+            for (size_t k = 0; k < T; ++k)
+                syndromes[2 * k] ^= entry[k];
+        }
+
+        for (size_t j = 2; j <= 2 * T; j += 2)
+            syndromes[j - 1] = mul(syndromes[j / 2 - 1], syndromes[j / 2 - 1]);
+
+        // Berlekamp-Massey: shortest LFSR lambda generating the syndromes
+        std::array<uint16_t, 2 * T + 1> lambda{};
+        std::array<uint16_t, 2 * T + 1> prev{};
+        std::array<uint16_t, 2 * T + 1> temp{};
+        size_t degree = 0;
+        size_t shift = 1;
+        uint16_t prev_discrepancy = 1;
+
+        lambda[0] = 1;
+        prev[0] = 1;
+
+        for (size_t r = 0; r < 2 * T; ++r)
+        {
+            uint16_t discrepancy = syndromes[r];
+
+            for (size_t i = 1; i <= degree; ++i)
+                discrepancy ^= mul(lambda[i], syndromes[r - i]);
+
+            if (discrepancy == 0)
+            {
+                ++shift;
+                continue;
+            }
+
+            const auto scale = exp[log[discrepancy] + n - log[prev_discrepancy]];
+
+            temp = lambda;
+
+            for (size_t i = shift; i <= 2 * T; ++i)
+                lambda[i] ^= mul(scale, prev[i - shift]);
+
+            if (2 * degree <= r)
+            {
+                degree = r + 1 - degree;
+                prev = temp;
+                prev_discrepancy = discrepancy;
+                shift = 1;
+            } else
+                ++shift;
+        }
+
+        if (degree == 0 || degree > T)
+            return failed;
+
+        // Chien search: bit p (power e = N - 1 - p) is bad when lambda(alpha^-e) = 0
+        std::array<size_t, T> positions;
+        size_t count = 0;
+
+        if (degree == 1)
+        {
+            // 1 + lambda_1 x has its root at x = lambda_1^-1, so e = log(lambda_1)
+            const size_t e = log[lambda[1]];
+
+            if (e < TOTAL_BIT_COUNT)
+                positions[count++] = TOTAL_BIT_COUNT - 1 - e;
+        } else if (degree == 2)
+        {
+            // x = (lambda_1 / lambda_2) y turns 1 + lambda_1 x + lambda_2 x^2 into
+            // y^2 + y = lambda_2 / lambda_1^2, solved by table. lambda_1 = 0 is a double root,
+            // which distinct bit errors never give
+            if (lambda[1] != 0)
+            {
+                const auto c = exp[(log[lambda[2]] + 2 * (n - log[lambda[1]])) % n];
+                const auto y = Field_t::solve_quadratic(c);
+
+                if (y != 0)
+                {
+                    const auto scale = log[lambda[1]] + n - log[lambda[2]];
+
+                    for (const auto root : { y, static_cast<uint16_t>(y ^ 1) })
+                    {
+                        // x = alpha^-e, so e = -log(x)
+                        const auto x_log = (scale + log[root]) % n;
+                        const size_t e = x_log == 0 ? 0 : n - x_log;
+
+                        if (e < TOTAL_BIT_COUNT)
+                            positions[count++] = TOTAL_BIT_COUNT - 1 - e;
+                    }
+                }
+            }
+        } else
+        {
+            // term i at power e is lambda_i * alpha^(-e * i): step its log down by i per power
+            std::array<size_t, T + 1> logs;
+
+            for (size_t i = 1; i <= degree; ++i)
+                logs[i] = lambda[i] != 0 ? log[lambda[i]] : n;
+
+            for (size_t e = 0; e < TOTAL_BIT_COUNT && count < degree; ++e)
+            {
+                uint16_t sum = 1;
+
+                for (size_t i = 1; i <= degree; ++i)
+                    if (logs[i] != n)
+                    {
+                        sum ^= exp[logs[i]];
+                        logs[i] = logs[i] >= i ? logs[i] - i : logs[i] + n - i;
+                    }
+
+                if (sum == 0)
+                    positions[count++] = TOTAL_BIT_COUNT - 1 - e;
+            }
+        }
+
+        // a root outside the shortened codeword: too many errors
+        if (count != degree)
+            return failed;
+
+        for (size_t i = 0; i < count; ++i)
+            if (positions[i] < DATA_BIT_COUNT)
+                flip_word_bit(data, positions[i]);
+
+        corrupt_bits = count;
+
+        return DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            encode_words(data + i * DATA_WORD_COUNT, encoded + i * STORED_WORD_COUNT);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            status[i] = decode_words(encoded + i * STORED_WORD_COUNT, data + i * DATA_WORD_COUNT);
+    }
+
+
+    StoredDataBits_t encode(const std::bitset<NumDataBits>& unencodedData) const override
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> data;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+
+        bitset_to_words(unencodedData, data.data());
+        encode_words(data.data(), encoded.data());
+
+        return words_to_bitset<TOTAL_BIT_COUNT>(encoded.data());
+    }
+
+
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        size_t corrupt_bits;
+        uint16_t syndrome;
+
+        bitset_to_words(storedData, encoded.data());
+
+        const auto status = decode_words(encoded.data(), decoded.data(), corrupt_bits, syndrome);
+
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+        result.success = (status & DECODE_UNCORRECTABLE) == 0;
+        result.error_detected = (status & DECODE_ERROR_DETECTED) != 0;
+
+        if (result.success)
+        {
+            result.num_corrupt_bits = corrupt_bits;
+            result.num_corrected_bits = corrupt_bits;
+        } else
+        {
+            // no pattern of T or fewer bits explains the syndrome
+            result.num_corrupt_bits = T + 1;
+            result.num_corrected_bits = 0;
+        }
+
+        return result;
+    }
+
+
+    // syndrome: the low 16 bits of the remainder syndrome
+    CompactDecodeResult<NumDataBits> decode_compact(const StoredDataBits_t& storedData) const override
+    {
+        CompactDecodeResult<NumDataBits> result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        size_t corrupt_bits;
+
+        bitset_to_words(storedData, encoded.data());
+
+        result.status = decode_words(encoded.data(), decoded.data(), corrupt_bits, result.syndrome);
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+
+        return result;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end BCHCode.h
+ *///////////////////////////////////////////////////////////////////////////*/
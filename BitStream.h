@@ -7,6 +7,8 @@
 #include <cstdint>
 #include <cassert>
 #include <algorithm>
+#include <memory>
+#include "PackedWords.h"
 
 
 /*
@@ -44,75 +46,80 @@ struct BitStream : public std::bitset<Size>
     // create a bitstream from a buffer of bytes, with given length in bits
     // (since there is no requirement that stored memory be in exact byte intervals
     // in this implementation, e.g. data could be 20 bits long)
+    // bits past length_bits in the last byte are ignored
     static BitStream<Size> from_buffer(const uint8_t* buf, size_t length_bits)
     {
         assert(length_bits <= Size);
-        BitStream<Size> bits;
-
-        // operate per byte
-        for (size_t bitIdx = 0; bitIdx < length_bits; bitIdx += 8)
-        {
-            // get byte we're working on
-            auto byteVal = *(buf + bitIdx / 8);
-
-            // 8 bits per byte (but don't go beyond length_bits total)
-            for (size_t bit = 0; bit < 8 && (bitIdx + bit < length_bits); ++bit) {
-                bits[bitIdx + bit] = (byteVal & 1) > 0;
-                byteVal >>= 1;
-            }
-        }
-
-        return bits;
+
+        return BitStream<Size>(bytes_to_bitset<Size>(buf, length_bits));
+    }
+
+
+    // create a bitstream from packed 64-bit words (see PackedWords.h), with given length in bits
+    static BitStream<Size> from_words(const uint64_t* words, size_t length_bits = Size)
+    {
+        assert(length_bits <= Size);
+
+        if (length_bits == Size)
+            return BitStream<Size>(words_to_bitset<Size>(words));
+
+        uint64_t masked[word_count(Size)] = {};
+
+        copy_word_bits(masked, 0, words, 0, length_bits);
+
+        return BitStream<Size>(words_to_bitset<Size>(masked));
     }
 
 
     // note: assumes buf is at least ceil(size / 8) bytes long
     void to_buffer(uint8_t* buf)
     {
-        for (size_t bitIdx = 0; bitIdx < Size; bitIdx += 8)
-        {
-            uint8_t byteVal = 0;
+        bitset_to_bytes<Size>(*this, buf, (Size + 7) / 8);
+    }
 
-            for (size_t bit = 0; bit < 8 && (bitIdx + bit < Size); ++bit)
-                byteVal |= (this->test(bitIdx + bit) ? 1 : 0) << bit;
 
-            *(buf + bitIdx / 8) = byteVal;
-        }
+    // note: assumes words is at least word_count(Size) words long
+    void to_words(uint64_t* words) const
+    {
+        bitset_to_words<Size>(*this, words);
     }
 
 
+    // no allocation: the value is unpacked straight into the returned T
     template <class T>
     T to() const
     {
-        auto result = to_many<T>(1);
+        T value;
+
+        to_many(&value, 1);
 
-        return result[0];
+        return value;
     }
 
 
+    // unpack into a caller provided buffer of (at least) count T's
     template <class T>
-    std::shared_ptr<T[]> to_many(size_t count) const
+    void to_many(T* buf, size_t count) const
     {
         static_assert(std::is_pod<T>::value, "Only primitive types allowed");
         assert(sizeof(T) * 8 * count <= Size);
 
-        auto buf = std::shared_ptr<T[]>(new T[count], std::default_delete<T[]>());
-        const auto pbuf = reinterpret_cast<uint8_t*>(buf.get());
+        const auto pbuf = reinterpret_cast<uint8_t*>(buf);
 
-        memset(buf.get(), 0, sizeof(T) * count);
+        memset(buf, 0, sizeof(T) * count);
 
-        for (size_t bitIdx = 0; bitIdx < Size; bitIdx += 8)
-        {
-            uint8_t byteVal = 0;
+        // don't overwrite data we're not meant to
+        // if within bit range specified by count and the actual size of each T
+        bitset_to_bytes<Size>(*this, pbuf, std::min((Size + 7) / 8, sizeof(T) * count));
+    }
 
-            for (size_t bit = 0; bit < 8 && (bitIdx + bit < Size); ++bit)
-                byteVal |= (this->test(bitIdx + bit) ? 1 : 0) << bit;
 
-            // don't overwrite data we're not meant to
-            // if within bit range specified by count and the actual size of each T
-            if (bitIdx / 8 < sizeof(T) * count)
-                *(pbuf + bitIdx / 8) = byteVal;
-        }
+    template <class T>
+    std::shared_ptr<T[]> to_many(size_t count) const
+    {
+        auto buf = std::shared_ptr<T[]>(new T[count], std::default_delete<T[]>());
+
+        to_many(buf.get(), count);
 
         return buf;
     }
@@ -120,15 +127,16 @@ struct BitStream : public std::bitset<Size>
 
     // convert from given bitset to bitstream of template Size
     // useful to avoid some repetition
-    template <class T>
-    static std::bitset<Size> convert_bitset_to_bitset(const T& bitset)
+    // (bits past Size are dropped, missing bits are zero)
+    template <size_t OtherSize>
+    static std::bitset<Size> convert_bitset_to_bitset(const std::bitset<OtherSize>& bitset)
     {
-        std::bitset<Size> bits;
+        constexpr auto common_bits = std::min(Size, OtherSize);
+        uint8_t bytes[(common_bits + 7) / 8];
 
-        for (size_t i = 0; i < std::min(Size, bitset.size()); ++i)
-            bits[i] = bitset[i];
+        bitset_to_bytes<OtherSize>(bitset, bytes, sizeof(bytes));
 
-        return bits;
+        return bytes_to_bitset<Size>(bytes, common_bits);
     }
 };
 
@@ -0,0 +1,375 @@
+/*-----------------------------------------------------------------------------
+ * BitslicedHammingCode.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <vector>
+#include <algorithm>
+#include "HammingCode.h"
+#include "CpuFeatures.h"
+
+
+// number of 64-bit words per bit slice, i.e. codewords per block / 64. Picks the widest
+// vector the compiler was allowed to use; on x86-64 at least AVX2's, which the batches
+// switch to at run time when the build doesn't target it
+#if defined(__AVX512F__)
+constexpr size_t BITSLICE_LANE_WORDS = 8;
+#elif ECC_X86_64
+constexpr size_t BITSLICE_LANE_WORDS = 4;
+#else
+constexpr size_t BITSLICE_LANE_WORDS = 1;
+#endif
+
+
+/*
+ * One bit position of 64 * LaneWords codewords: bit j of word g belongs to codeword g * 64 + j.
+ * Only needs the handful of bitwise operators the Hamming equations use
+ */
+template <size_t LaneWords>
+struct alignas(LaneWords * sizeof(uint64_t)) BitSlice
+{
+    uint64_t w[LaneWords];
+
+    static BitSlice zero()
+    {
+        BitSlice s;
+        std::fill(s.w, s.w + LaneWords, 0);
+        return s;
+    }
+
+    BitSlice operator^(const BitSlice& other) const
+    {
+        BitSlice s;
+        for (size_t g = 0; g < LaneWords; ++g) s.w[g] = w[g] ^ other.w[g];
+        return s;
+    }
+
+    BitSlice operator&(const BitSlice& other) const
+    {
+        BitSlice s;
+        for (size_t g = 0; g < LaneWords; ++g) s.w[g] = w[g] & other.w[g];
+        return s;
+    }
+
+    BitSlice operator|(const BitSlice& other) const
+    {
+        BitSlice s;
+        for (size_t g = 0; g < LaneWords; ++g) s.w[g] = w[g] | other.w[g];
+        return s;
+    }
+
+    BitSlice operator~() const
+    {
+        BitSlice s;
+        for (size_t g = 0; g < LaneWords; ++g) s.w[g] = ~w[g];
+        return s;
+    }
+
+    BitSlice& operator^=(const BitSlice& other) { return *this = *this ^ other; }
+    BitSlice& operator&=(const BitSlice& other) { return *this = *this & other; }
+    BitSlice& operator|=(const BitSlice& other) { return *this = *this | other; }
+
+    bool test(size_t lane) const
+    {
+        return ((w[lane / 64] >> (lane % 64)) & 1) != 0;
+    }
+};
+
+
+#if defined(__AVX2__)
+template <>
+inline BitSlice<4> BitSlice<4>::operator^(const BitSlice<4>& other) const
+{
+    BitSlice<4> s;
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s.w), _mm256_xor_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(w)), _mm256_load_si256(reinterpret_cast<const __m256i*>(other.w))));
+    return s;
+}
+
+template <>
+inline BitSlice<4> BitSlice<4>::operator&(const BitSlice<4>& other) const
+{
+    BitSlice<4> s;
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s.w), _mm256_and_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(w)), _mm256_load_si256(reinterpret_cast<const __m256i*>(other.w))));
+    return s;
+}
+
+template <>
+inline BitSlice<4> BitSlice<4>::operator|(const BitSlice<4>& other) const
+{
+    BitSlice<4> s;
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s.w), _mm256_or_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(w)), _mm256_load_si256(reinterpret_cast<const __m256i*>(other.w))));
+    return s;
+}
+#endif
+
+
+#if defined(__AVX512F__)
+template <>
+inline BitSlice<8> BitSlice<8>::operator^(const BitSlice<8>& other) const
+{
+    BitSlice<8> s;
+    _mm512_store_si512(s.w, _mm512_xor_si512(_mm512_load_si512(w), _mm512_load_si512(other.w)));
+    return s;
+}
+
+template <>
+inline BitSlice<8> BitSlice<8>::operator&(const BitSlice<8>& other) const
+{
+    BitSlice<8> s;
+    _mm512_store_si512(s.w, _mm512_and_si512(_mm512_load_si512(w), _mm512_load_si512(other.w)));
+    return s;
+}
+
+template <>
+inline BitSlice<8> BitSlice<8>::operator|(const BitSlice<8>& other) const
+{
+    BitSlice<8> s;
+    _mm512_store_si512(s.w, _mm512_or_si512(_mm512_load_si512(w), _mm512_load_si512(other.w)));
+    return s;
+}
+#endif
+
+
+/*
+ * Extended Hamming code, bitsliced: the batch paths transpose 64 * LaneWords codewords so that
+ * each bit position becomes one BitSlice, then evaluate the parity, syndrome and correction
+ * equations with plain XOR/AND over whole slices, i.e. for every codeword of the block at once.
+ * Pays off for small codewords (e.g. HammingCode<7>) where per-codeword overhead dominates.
+ *
+ * Single codeword encode()/decode() are inherited, and the batch results are bit for bit the
+ * same as HammingCode's, so it can be used anywhere HammingCode is
+ */
+template <size_t NumDataBits, size_t LaneWords = BITSLICE_LANE_WORDS>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class BitslicedHammingCode : public HammingCode<NumDataBits>
+{
+public:
+    typedef HammingCode<NumDataBits> Hamming_t;
+    typedef BitSlice<LaneWords> Slice_t;
+
+    static constexpr size_t BLOCK_SIZE = 64 * LaneWords; // codewords per block
+
+    using Hamming_t::CHECK_BIT_COUNT;
+    using Hamming_t::TOTAL_BIT_COUNT;
+    using Hamming_t::DATA_WORD_COUNT;
+    using Hamming_t::STORED_WORD_COUNT;
+
+private:
+    // packed entries (words_per_entry words each) -> one slice per bit. Entries past count read as zero
+    static void load_slices(const uint64_t* entries, size_t count, size_t words_per_entry, uint64_t last_word_mask, size_t num_bits, Slice_t* slices)
+    {
+        uint64_t rows[64];
+
+        for (size_t c = 0; c < words_per_entry; ++c)
+        {
+            const auto mask = c + 1 == words_per_entry ? last_word_mask : ~uint64_t(0);
+            const auto bits = std::min<size_t>(64, num_bits - c * 64);
+
+            for (size_t g = 0; g < LaneWords; ++g)
+            {
+                for (size_t j = 0; j < 64; ++j)
+                {
+                    const auto entry = g * 64 + j;
+                    rows[j] = entry < count ? entries[entry * words_per_entry + c] & mask : 0;
+                }
+
+                transpose64(rows);
+
+                for (size_t b = 0; b < bits; ++b)
+                    slices[c * 64 + b].w[g] = rows[b];
+            }
+        }
+    }
+
+
+    // one slice per bit -> packed entries; only the first count entries are written
+    static void store_slices(const Slice_t* slices, size_t num_bits, size_t words_per_entry, size_t count, uint64_t* entries)
+    {
+        uint64_t rows[64];
+
+        for (size_t c = 0; c < words_per_entry; ++c)
+        {
+            const auto bits = std::min<size_t>(64, num_bits - c * 64);
+
+            for (size_t g = 0; g < LaneWords && g * 64 < count; ++g)
+            {
+                for (size_t b = 0; b < 64; ++b)
+                    rows[b] = b < bits ? slices[c * 64 + b].w[g] : 0;
+
+                transpose64(rows);
+
+                for (size_t j = 0; j < 64 && g * 64 + j < count; ++j)
+                    entries[(g * 64 + j) * words_per_entry + c] = rows[j];
+            }
+        }
+    }
+
+
+    // XOR of every slice covered by check bit check_idx (includes the check bit itself)
+    static ECC_FORCE_INLINE Slice_t check_slice(const Slice_t* stored, size_t check_idx)
+    {
+        auto acc = Slice_t::zero();
+
+        for (size_t position = 0; position < TOTAL_BIT_COUNT; ++position)
+            if ((Hamming_t::PARITY_MASKS[check_idx][position / 64] >> (position % 64)) & 1)
+                acc ^= stored[position];
+
+        return acc;
+    }
+
+
+    static ECC_FORCE_INLINE void encode_block(const uint64_t* data, size_t count, uint64_t* encoded, Slice_t* data_slices, Slice_t* stored)
+    {
+        load_slices(data, count, DATA_WORD_COUNT, Hamming_t::LAST_DATA_WORD_MASK, NumDataBits, data_slices);
+
+        // extended Hamming code: extended data bit 0 is the parity of the data, bit d + 1 is data bit d
+        auto parity = Slice_t::zero();
+
+        for (size_t d = 0; d < NumDataBits; ++d)
+            parity ^= data_slices[d];
+
+        for (const auto& run : Hamming_t::DATA_RUNS)
+            for (size_t t = 0; t < run.length; ++t)
+            {
+                const auto e = run.data_offset + t;
+                stored[run.stored_offset + t] = e == 0 ? parity : data_slices[e - 1];
+            }
+
+        // check bit positions are clear while their parity is computed
+        for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+            stored[(size_t(1) << i) - 1] = Slice_t::zero();
+
+        for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+            stored[(size_t(1) << i) - 1] = check_slice(stored, i);
+
+        store_slices(stored, TOTAL_BIT_COUNT, STORED_WORD_COUNT, count, encoded);
+    }
+
+
+    static ECC_FORCE_INLINE void decode_block(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status, Slice_t* data_slices, Slice_t* stored)
+    {
+        load_slices(encoded, count, STORED_WORD_COUNT, Hamming_t::LAST_STORED_WORD_MASK, TOTAL_BIT_COUNT, stored);
+
+        Slice_t syndrome[CHECK_BIT_COUNT];
+        auto corrupt = Slice_t::zero();
+
+        for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+        {
+            syndrome[i] = check_slice(stored, i);
+            corrupt |= syndrome[i];
+        }
+
+        // a codeword's bit at (1-based) position p is flipped when its syndrome equals p.
+        // Syndromes past the end of the codeword never match, same as SYNDROME_TABLE
+        const auto flip_mask = [&syndrome](size_t position)
+        {
+            auto match = ~Slice_t::zero();
+
+            for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+                match &= ((position >> i) & 1) ? syndrome[i] : ~syndrome[i];
+
+            return match;
+        };
+
+        // gather corrected and as-stored extended data
+        auto extended_parity = Slice_t::zero();
+        auto data_parity = Slice_t::zero();
+
+        for (const auto& run : Hamming_t::DATA_RUNS)
+            for (size_t t = 0; t < run.length; ++t)
+            {
+                const auto e = run.data_offset + t;
+                const auto position = run.stored_offset + t;
+                const auto corrected = stored[position] ^ flip_mask(position + 1);
+
+                if (e == 0)
+                {
+                    extended_parity = corrected;
+                    continue;
+                }
+
+                data_slices[e - 1] = corrected;
+                data_parity ^= corrected;
+            }
+
+        // double error test: the extended parity bit must still match the data. If it doesn't after
+        // a correction attempt, the correction was meaningless and data is returned as stored
+        const auto de = extended_parity ^ data_parity;
+        const auto uncorrectable = corrupt & de;
+
+        for (const auto& run : Hamming_t::DATA_RUNS)
+            for (size_t t = 0; t < run.length; ++t)
+            {
+                const auto e = run.data_offset + t;
+
+                if (e != 0)
+                    data_slices[e - 1] ^= uncorrectable & (data_slices[e - 1] ^ stored[run.stored_offset + t]);
+            }
+
+        store_slices(data_slices, NumDataBits, DATA_WORD_COUNT, count, data);
+
+        for (size_t j = 0; j < count; ++j)
+        {
+            if (!corrupt.test(j))
+                status[j] = de.test(j) ? DECODE_UNCORRECTABLE : DECODE_CLEAN;
+            else status[j] = DECODE_ERROR_DETECTED | (de.test(j) ? DECODE_UNCORRECTABLE : DECODE_CORRECTED);
+        }
+    }
+
+    static ECC_FORCE_INLINE void encode_blocks(const uint64_t* data, size_t count, uint64_t* encoded)
+    {
+        std::vector<Slice_t> data_slices(NumDataBits), stored(TOTAL_BIT_COUNT);
+
+        for (size_t i = 0; i < count; i += BLOCK_SIZE)
+            encode_block(data + i * DATA_WORD_COUNT, std::min(BLOCK_SIZE, count - i), encoded + i * STORED_WORD_COUNT, data_slices.data(), stored.data());
+    }
+
+
+    static ECC_FORCE_INLINE void decode_blocks(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status)
+    {
+        std::vector<Slice_t> data_slices(NumDataBits), stored(TOTAL_BIT_COUNT);
+
+        for (size_t i = 0; i < count; i += BLOCK_SIZE)
+            decode_block(encoded + i * STORED_WORD_COUNT, std::min(BLOCK_SIZE, count - i), data + i * DATA_WORD_COUNT, status + i, data_slices.data(), stored.data());
+    }
+
+
+#if ECC_X86_64 && !defined(__AVX2__)
+    // the same blocks compiled for AVX2, where the slice operators become 256-bit instructions
+    static ECC_TARGET("avx2") void encode_blocks_avx2(const uint64_t* data, size_t count, uint64_t* encoded)
+    {
+        encode_blocks(data, count, encoded);
+    }
+
+
+    static ECC_TARGET("avx2") void decode_blocks_avx2(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status)
+    {
+        decode_blocks(encoded, count, data, status);
+    }
+#endif
+
+public:
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+#if ECC_X86_64 && !defined(__AVX2__)
+        if (LaneWords == 4 && cpu_has_avx2())
+            return encode_blocks_avx2(data, count, encoded);
+#endif
+
+        encode_blocks(data, count, encoded);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+#if ECC_X86_64 && !defined(__AVX2__)
+        if (LaneWords == 4 && cpu_has_avx2())
+            return decode_blocks_avx2(encoded, count, data, status);
+#endif
+
+        decode_blocks(encoded, count, data, status);
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end BitslicedHammingCode.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,74 @@
+/*-----------------------------------------------------------------------------
+ * BlockPipeline.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ThreadPool.h"
+
+
+/*
+ * Runs count blocks through three stages:
+ *
+ *   read(i)     on the calling thread, in order, as block i enters the window (e.g. starting
+ *               the I/O for its input)
+ *   process(i)  on the pool, any number at once, in any order
+ *   write(i)    on the calling thread, in order, once process(i) is done (e.g. flushing its
+ *               output, reporting on it)
+ *
+ * At most window blocks are past read and not yet through write, which bounds the memory and
+ * I/O in flight while keeping every worker busy: reading ahead overlaps processing, and a slow
+ * block only holds up the writes behind it, not the workers. Returns after write(count - 1)
+ */
+template <class Read, class Process, class Write>
+void run_block_pipeline(ThreadPool& pool, size_t count, size_t window, Read&& read, Process&& process, Write&& write)
+{
+    struct State
+    {
+        std::mutex mutex;
+        std::condition_variable processed;
+        std::vector<bool> done;     // per window slot
+    };
+
+    if (window == 0)
+        window = 1;
+
+    auto state = std::make_shared<State>();
+    auto* body = &process;
+
+    state->done.assign(window, false);
+
+    size_t next_read = 0;
+
+    for (size_t next_write = 0; next_write < count; ++next_write)
+    {
+        for (; next_read < count && next_read - next_write < window; ++next_read)
+        {
+            read(next_read);
+
+            pool.submit([state, body, i = next_read, window]
+            {
+                (*body)(i);
+
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done[i % window] = true;
+                state->processed.notify_all();
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+
+            state->processed.wait(lock, [&] { return state->done[next_write % window]; });
+            state->done[next_write % window] = false;
+        }
+
+        write(next_write);
+    }
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end BlockPipeline.h
+ *///////////////////////////////////////////////////////////////////////////*/
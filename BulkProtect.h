@@ -0,0 +1,126 @@
+/*-----------------------------------------------------------------------------
+ * BulkProtect.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "ChunkArray.h"
+#include "ThreadPool.h"
+
+
+/*
+ * Protecting / checking whole buffers with every core: protect() encodes a buffer into a
+ * ChunkArray and verify_and_repair() decodes all of it, rewriting corrected codewords. Works
+ * with any strategy; HammingCode and ParityBit are the ones with kernels fast enough to be
+ * bandwidth bound.
+ *
+ * The region is cut into blocks of ChunkArray::PARALLEL_BLOCK_CHUNKS, run through
+ * ThreadPool::parallel_for_stealing: every worker starts on the run of blocks that goes with its
+ * worker number, the run it zeroed if the region was constructed on the same pool (first touch
+ * NUMA placement), and only steals once it runs dry. Blocks it steals, or that get stolen from it
+ * while it is busy elsewhere, are worked on away from their node. Blocks never share a storage
+ * word, so no locking is needed.
+ *
+ * Results don't depend on scheduling: every block reports separately and the reports are
+ * merged in block order, so the offsets come out sorted.
+ *
+ * Don't read or write the region in other ways while one of these runs
+ */
+
+
+// what verify_and_repair found
+struct BulkReport
+{
+    uint64_t codewords;                     // codewords decoded
+    uint64_t corrected;                     // ...that had an error corrected (and rewritten, when repairing)
+    uint64_t uncorrectable;                 // ...that had an error that couldn't be corrected
+    std::vector<uint64_t> corrected_offsets;        // byte offsets of those codewords' data, ascending
+    std::vector<uint64_t> uncorrectable_offsets;
+
+    BulkReport() : codewords(0), corrected(0), uncorrectable(0)
+    {
+    }
+
+
+    void append(const BulkReport& other)
+    {
+        codewords += other.codewords;
+        corrected += other.corrected;
+        uncorrectable += other.uncorrectable;
+        corrected_offsets.insert(corrected_offsets.end(), other.corrected_offsets.begin(), other.corrected_offsets.end());
+        uncorrectable_offsets.insert(uncorrectable_offsets.end(), other.uncorrectable_offsets.begin(), other.uncorrectable_offsets.end());
+    }
+};
+
+
+// encodes length bytes of data (length <= region.size()) into the start of region. Chunks
+// past length keep their contents, except that a partly covered last chunk keeps only its bytes
+// beyond length (see ChunkArray::write)
+template <class Strategy>
+void protect(ThreadPool& pool, ChunkArray<Strategy>& region, const uint8_t* data, size_t length)
+{
+    typedef ChunkArray<Strategy> Region_t;
+
+    constexpr auto BLOCK_BYTES = Region_t::PARALLEL_BLOCK_CHUNKS * Region_t::DATA_BYTES_PER_CHUNK;
+
+    assert(length <= region.size());
+
+    pool.parallel_for_stealing((length + BLOCK_BYTES - 1) / BLOCK_BYTES, [&](size_t block)
+    {
+        const auto offset = block * BLOCK_BYTES;
+
+        region.write(offset, data + offset, std::min(BLOCK_BYTES, length - offset));
+    });
+}
+
+
+// decodes chunks [first, first + count) of region (one parallel block), adding them to report
+template <class Strategy>
+void verify_block(ChunkArray<Strategy>& region, size_t first, size_t count, bool repair, BulkReport& report)
+{
+    typedef ChunkArray<Strategy> Region_t;
+
+    const auto result = region.repair(first, count, repair, [&](size_t chunk, uint8_t status)
+    {
+        const uint64_t offset = chunk * Region_t::DATA_BYTES_PER_CHUNK;
+
+        if (status & DECODE_UNCORRECTABLE)
+            report.uncorrectable_offsets.push_back(offset);
+        else
+            report.corrected_offsets.push_back(offset);
+    });
+
+    report.codewords += result.chunks;
+    report.corrected += result.corrected;
+    report.uncorrectable += result.uncorrectable;
+}
+
+
+// decodes every codeword of region; with repair, corrected ones are written back
+template <class Strategy>
+BulkReport verify_and_repair(ThreadPool& pool, ChunkArray<Strategy>& region, bool repair = true)
+{
+    typedef ChunkArray<Strategy> Region_t;
+
+    const auto blocks = region.parallel_block_count();
+    std::vector<BulkReport> reports(blocks);
+    BulkReport result;
+
+    pool.parallel_for_stealing(blocks, [&](size_t block)
+    {
+        const auto first = block * Region_t::PARALLEL_BLOCK_CHUNKS;
+
+        verify_block(region, first, std::min(Region_t::PARALLEL_BLOCK_CHUNKS, region.chunk_count() - first), repair, reports[block]);
+    });
+
+    for (const auto& report : reports)
+        result.append(report);
+
+    return result;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end BulkProtect.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,411 @@
+/*-----------------------------------------------------------------------------
+ * ChipkillCode.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include "CorrectionStrategy.h"
+#include "Chunk.h"
+#include "GaloisField.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+
+/*
+ * Chipkill style single symbol correcting, double symbol detecting (SSC-DSD) code. A symbol is
+ * the SymbolBits bits one DRAM device contributes to a word, so a whole x4 or x8 device failing
+ * is a single symbol error and gets corrected however many of its bits are wrong. Two failing
+ * devices are always detected. That's where SEC-DED (HammingCode, HsiaoCode) gives up: it
+ * corrects single bits only, and reports (or miscorrects) anything wider.
+ *
+ *   ChipkillCode<4>   x4 devices: 32 data + 4 check symbols, 128 data bits in 144
+ *   ChipkillCode<8>   x8 devices: 32 data + 4 check symbols, 256 data bits in 288 (two
+ *                     channels in lockstep, as x8 chipkill is usually built)
+ *
+ * Linear over GF(2^SymbolBits) with 4 check symbols: symbol i of the codeword times column h_i
+ * of a 4 row parity check matrix H, summed, is the syndrome, which is zero for a codeword. The
+ * columns are chosen so that no three are dependent, which makes the minimum symbol distance 4.
+ * The check columns are the unit vectors (the code is systematic, check symbols follow the data
+ * bits). The data columns are the RS (Vandermonde) columns (1, a, a^2, a^3) as far as they go,
+ * which for GF(256) is all of them. GF(16) only has 15, as an RS code over it is limited to 17
+ * symbols, so the rest are picked greedily from GF(16)^4, keeping the 4 symbol redundancy.
+ *
+ * Decoding is table driven: the syndrome is one table lookup per stored byte, XORed. A single
+ * symbol error e at position i leaves the syndrome e * h_i, so scaling it to its first non-zero
+ * coordinate being 1 gives h_i (also kept scaled that way) and that coordinate is e. A small
+ * hash table maps the scaled columns back to positions; a syndrome not in it is an error in
+ * two or more symbols
+ */
+template <size_t SymbolBits, size_t DataSymbols = 32>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class ChipkillCode : public CorrectionStrategy<DataSymbols * SymbolBits, (DataSymbols + 4) * SymbolBits>
+{
+    static_assert(SymbolBits == 4 || SymbolBits == 8, "symbols are x4 or x8 devices");
+    static_assert(DataSymbols + 4 <= (size_t(1) << (2 * SymbolBits)) + 1, "more symbols than the field has room for");
+
+public:
+    typedef GF2m<SymbolBits> Field_t;
+
+    static constexpr size_t SYMBOL_BITS = SymbolBits;
+    static constexpr size_t DATA_SYMBOL_COUNT = DataSymbols;
+    static constexpr size_t CHECK_SYMBOL_COUNT = 4;
+    static constexpr size_t SYMBOL_COUNT = DATA_SYMBOL_COUNT + CHECK_SYMBOL_COUNT;
+
+    static constexpr size_t DATA_BIT_COUNT = DATA_SYMBOL_COUNT * SYMBOL_BITS;
+    static constexpr size_t CHECK_BIT_COUNT = CHECK_SYMBOL_COUNT * SYMBOL_BITS;
+    static constexpr size_t TOTAL_BIT_COUNT = SYMBOL_COUNT * SYMBOL_BITS;
+
+    typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
+    typedef DecodeResult<DATA_BIT_COUNT, TOTAL_BIT_COUNT> DecodeResult_t;
+    typedef Chunk<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Chunk_t;
+
+    typedef CorrectionStrategy<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+
+    static constexpr uint32_t SYMBOL_MASK = (uint32_t(1) << SYMBOL_BITS) - 1;
+    static constexpr size_t DATA_BYTE_COUNT = (DATA_BIT_COUNT + 7) / 8;
+    static constexpr size_t STORED_BYTE_COUNT = (TOTAL_BIT_COUNT + 7) / 8;
+    static constexpr size_t LOCATOR_SLOTS = 128;   // power of two, at least twice SYMBOL_COUNT
+
+    static_assert(LOCATOR_SLOTS >= 2 * SYMBOL_COUNT, "locator table too small");
+
+private:
+    // syndromes and columns pack the 4 coordinates SYMBOL_BITS apart, coordinate 0 lowest
+    struct Tables
+    {
+        std::array<uint32_t, SYMBOL_COUNT> columns;                     // H, scaled
+        std::vector<std::array<uint32_t, 256>> bytes;                   // syndrome of each value of each stored byte
+        std::array<uint32_t, LOCATOR_SLOTS> locator_keys;               // scaled column, 0 = empty
+        std::array<uint8_t, LOCATOR_SLOTS> locator_positions;
+    };
+
+
+    static uint32_t coordinate(uint32_t v, size_t j)
+    {
+        return (v >> (j * SYMBOL_BITS)) & SYMBOL_MASK;
+    }
+
+
+    // v times a field element
+    static uint32_t scale(uint32_t v, uint32_t factor)
+    {
+        uint32_t result = 0;
+
+        for (size_t j = 0; j < CHECK_SYMBOL_COUNT; ++j)
+            result |= static_cast<uint32_t>(Field_t::mul(static_cast<uint16_t>(coordinate(v, j)), static_cast<uint16_t>(factor))) << (j * SYMBOL_BITS);
+
+        return result;
+    }
+
+
+    // first non-zero coordinate of v (v != 0)
+    static uint32_t leading(uint32_t v)
+    {
+        size_t j = 0;
+
+        while (coordinate(v, j) == 0)
+            ++j;
+
+        return coordinate(v, j);
+    }
+
+
+    // v scaled so that its first non-zero coordinate is 1, i.e. one representative per line
+    static uint32_t normalize(uint32_t v)
+    {
+        const auto lead = leading(v);
+
+        return lead == 1 ? v : scale(v, Field_t::div(1, static_cast<uint16_t>(lead)));
+    }
+
+
+    static size_t locator_slot(uint32_t key)
+    {
+        return (key * 0x9E3779B1u) >> 25;   // top 7 bits, for 128 slots
+    }
+
+
+    // the unit vectors, then RS columns (1, a, a^2, a^3): any three of these are independent. If
+    // that's not enough (GF(16)), a greedy pick from the rest: a candidate is taken unless it lies
+    // on a line through two columns taken before. Those lines' points are kept in covered
+    static std::array<uint32_t, SYMBOL_COUNT> make_columns()
+    {
+        std::array<uint32_t, SYMBOL_COUNT> columns;
+        std::vector<uint32_t> taken;
+        std::unordered_set<uint32_t> covered;
+
+        for (size_t j = 0; j < CHECK_SYMBOL_COUNT; ++j)
+            taken.push_back(uint32_t(1) << (j * SYMBOL_BITS));
+
+        for (size_t i = 0; i < Field_t::ORDER && taken.size() < SYMBOL_COUNT; ++i)
+        {
+            const uint32_t a = Field_t::exp(i);
+            const uint32_t a2 = Field_t::mul(a, a);
+
+            taken.push_back(1 | a << SYMBOL_BITS | a2 << (2 * SYMBOL_BITS) | uint32_t(Field_t::mul(a2, a)) << (3 * SYMBOL_BITS));
+        }
+
+        const auto cover = [&](uint32_t column, size_t count)
+        {
+            for (size_t k = 0; k < count; ++k)
+                for (size_t a = 1; a <= Field_t::ORDER; ++a)
+                    covered.insert(normalize(taken[k] ^ scale(column, static_cast<uint32_t>(a))));
+
+            covered.insert(column);
+        };
+
+        if (taken.size() < SYMBOL_COUNT)
+            for (size_t i = 0; i < taken.size(); ++i)
+                cover(taken[i], i);
+
+        for (uint64_t v = 1; taken.size() < SYMBOL_COUNT && v >> CHECK_BIT_COUNT == 0; ++v)
+        {
+            const auto candidate = static_cast<uint32_t>(v);
+
+            if (leading(candidate) == 1 && covered.count(candidate) == 0)
+            {
+                cover(candidate, taken.size());
+                taken.push_back(candidate);
+            }
+        }
+
+        assert(taken.size() == SYMBOL_COUNT);
+
+        // data columns first, then the unit vectors of the check symbols
+        std::copy(taken.begin() + CHECK_SYMBOL_COUNT, taken.end(), columns.begin());
+        std::copy(taken.begin(), taken.begin() + CHECK_SYMBOL_COUNT, columns.begin() + DATA_SYMBOL_COUNT);
+
+        return columns;
+    }
+
+
+    static const Tables& tables()
+    {
+        static const Tables t = []
+        {
+            Tables tables;
+
+            tables.columns = make_columns();
+            tables.bytes.resize(STORED_BYTE_COUNT);
+
+            for (size_t k = 0; k < STORED_BYTE_COUNT; ++k)
+            {
+                uint32_t bit_syndromes[8] = {};
+
+                // stored bit b is bit b % SYMBOL_BITS of symbol b / SYMBOL_BITS
+                for (size_t v = 0; v < 8 && 8 * k + v < TOTAL_BIT_COUNT; ++v)
+                {
+                    const auto b = 8 * k + v;
+
+                    bit_syndromes[v] = scale(tables.columns[b / SYMBOL_BITS], uint32_t(1) << (b % SYMBOL_BITS));
+                }
+
+                auto& table = tables.bytes[k];
+
+                table[0] = 0;
+
+                // x is x without its lowest set bit, plus that bit
+                for (size_t x = 1; x < 256; ++x)
+                    table[x] = table[x & (x - 1)] ^ bit_syndromes[popcount64((x & (0 - x)) - 1)];
+            }
+
+            tables.locator_keys.fill(0);
+
+            for (size_t i = 0; i < SYMBOL_COUNT; ++i)
+            {
+                auto slot = locator_slot(tables.columns[i]);
+
+                while (tables.locator_keys[slot] != 0)
+                    slot = (slot + 1) % LOCATOR_SLOTS;
+
+                tables.locator_keys[slot] = tables.columns[i];
+                tables.locator_positions[slot] = static_cast<uint8_t>(i);
+            }
+
+            return tables;
+        }();
+
+        return t;
+    }
+
+
+    // XOR of the byte tables over the first num_bytes bytes of words
+    static uint32_t syndrome_of(const Tables& t, const uint64_t* words, size_t num_bytes)
+    {
+        uint32_t syndrome = 0;
+
+        for (size_t k = 0; k < num_bytes; ++k)
+            syndrome ^= t.bytes[k][(words[k / 8] >> (8 * (k % 8))) & 0xFF];
+
+        return syndrome;
+    }
+
+
+public:
+    // the parity check matrix column of symbol i, scaled as described above
+    static uint32_t column(size_t i)
+    {
+        return tables().columns[i];
+    }
+
+
+    static uint32_t compute_syndrome_words(const uint64_t* encoded)
+    {
+        return syndrome_of(tables(), encoded, STORED_BYTE_COUNT);
+    }
+
+
+    // DATA_BIT_COUNT is a multiple of 8, so the data bytes hold no check bits
+    static void encode_words(const uint64_t* data, uint64_t* encoded)
+    {
+        std::copy(data, data + DATA_WORD_COUNT, encoded);
+        encoded[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        if (STORED_WORD_COUNT > DATA_WORD_COUNT)
+            encoded[STORED_WORD_COUNT - 1] = 0;
+
+        write_word_bits(encoded, DATA_BIT_COUNT, CHECK_BIT_COUNT, syndrome_of(tables(), encoded, DATA_BYTE_COUNT));
+    }
+
+
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data)
+    {
+        uint32_t syndrome;
+        uint32_t error;
+
+        return decode_words(encoded, data, syndrome, error);
+    }
+
+
+    // also hands back the syndrome and the error pattern of the corrected symbol (0 if none)
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data, uint32_t& syndrome, uint32_t& error)
+    {
+        const auto& t = tables();
+
+        syndrome = syndrome_of(t, encoded, STORED_BYTE_COUNT);
+        error = 0;
+
+        std::copy(encoded, encoded + DATA_WORD_COUNT, data);
+        data[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        if (syndrome == 0)
+            return DECODE_CLEAN;
+
+        // key = syndrome / lead, straight from the log tables
+        const auto* exp = Field_t::exp_table();
+        const auto* log = Field_t::log_table();
+        const auto lead = leading(syndrome);
+        const auto shift = Field_t::ORDER - log[lead];
+        uint32_t key = 0;
+
+        for (size_t j = 0; j < CHECK_SYMBOL_COUNT; ++j)
+        {
+            const auto c = coordinate(syndrome, j);
+
+            if (c != 0)
+                key |= uint32_t(exp[log[c] + shift]) << (j * SYMBOL_BITS);
+        }
+
+        for (auto slot = locator_slot(key); t.locator_keys[slot] != 0; slot = (slot + 1) % LOCATOR_SLOTS)
+        {
+            if (t.locator_keys[slot] != key)
+                continue;
+
+            const size_t position = t.locator_positions[slot];
+
+            error = lead;
+
+            // a symbol never straddles a word: SYMBOL_BITS divides 64
+            if (position < DATA_SYMBOL_COUNT)
+                data[position * SYMBOL_BITS / WORD_BITS] ^= uint64_t(lead) << (position * SYMBOL_BITS % WORD_BITS);
+
+            return DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+        }
+
+        return DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            encode_words(data + i * DATA_WORD_COUNT, encoded + i * STORED_WORD_COUNT);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            status[i] = decode_words(encoded + i * STORED_WORD_COUNT, data + i * DATA_WORD_COUNT);
+    }
+
+
+    StoredDataBits_t encode(const std::bitset<DATA_BIT_COUNT>& unencodedData) const override
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> data;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+
+        bitset_to_words(unencodedData, data.data());
+        encode_words(data.data(), encoded.data());
+
+        return words_to_bitset<TOTAL_BIT_COUNT>(encoded.data());
+    }
+
+
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        uint32_t syndrome;
+        uint32_t error;
+
+        bitset_to_words(storedData, encoded.data());
+
+        const auto status = decode_words(encoded.data(), decoded.data(), syndrome, error);
+
+        result.decoded_bits = words_to_bitset<DATA_BIT_COUNT>(decoded.data());
+        result.success = (status & DECODE_UNCORRECTABLE) == 0;
+        result.error_detected = (status & DECODE_ERROR_DETECTED) != 0;
+
+        if (result.success)
+        {
+            result.num_corrupt_bits = popcount64(error);
+            result.num_corrected_bits = popcount64(error);
+        } else
+        {
+            // two or more bad symbols, so at least two bad bits
+            result.num_corrupt_bits = 2;
+            result.num_corrected_bits = 0;
+        }
+
+        return result;
+    }
+
+
+    // syndrome: its low 16 bits (all of it for x4 symbols)
+    CompactDecodeResult<DATA_BIT_COUNT> decode_compact(const StoredDataBits_t& storedData) const override
+    {
+        CompactDecodeResult<DATA_BIT_COUNT> result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        uint32_t syndrome;
+        uint32_t error;
+
+        bitset_to_words(storedData, encoded.data());
+
+        result.status = decode_words(encoded.data(), decoded.data(), syndrome, error);
+        result.syndrome = static_cast<uint16_t>(syndrome);
+        result.decoded_bits = words_to_bitset<DATA_BIT_COUNT>(decoded.data());
+
+        return result;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end ChipkillCode.h
+ *///////////////////////////////////////////////////////////////////////////*/
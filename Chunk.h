@@ -4,9 +4,14 @@
 #pragma once
 #include <bitset>
 #include <cassert>
+#include <memory>
 #include "BitStream.h"
 #include "CorrectionStrategy.h"
 
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+#include "EccTelemetry.h"
+#endif
+
 
 /*
  * Represents a chunk of memory
@@ -28,6 +33,9 @@ private:
     StoredBits m_stored;
     DataBits m_original; // uncorrupted original data
     StrategyPtr m_strategy;
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+    TelemetrySource* m_telemetry;   // the source of the strategy's concrete type
+#endif
 
 
     // erase this chunk
@@ -43,6 +51,9 @@ public:
     explicit Chunk(StrategyPtr strategy) : m_strategy(strategy)
     {
         assert(strategy.get() != nullptr);
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        m_telemetry = &TelemetryRegistry::instance().source(typeid(*strategy));
+#endif
         clear_contents();
     }
 
@@ -53,8 +64,44 @@ public:
     {
         m_stored = m_strategy->encode(bs);
         m_original = bs;
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        m_telemetry->count_encode();
+#endif
+    }
+
+    // partial write: sets data bits [bit_offset, bit_offset + length) (length <= 64) to the low
+    // bits of new_bits. Only the changed bits and the check bits they feed are touched (for
+    // strategies that support it, see CorrectionStrategy::update), so an error already stored
+    // in the chunk stays there. Returns the strategy's DecodeStatus; if that is an error it
+    // couldn't repair (decode_unrepaired), nothing was written
+    uint8_t update(size_t bit_offset, uint64_t new_bits, size_t length)
+    {
+        assert(length <= WORD_BITS && bit_offset + length <= NumDataBits);
+
+        const auto old_bits = read_bitset_bits(m_original, bit_offset, length);
+        uint8_t status = DECODE_CLEAN;
+
+        // a write of every data bit keeps nothing of the old codeword: encode the new one, as store() does
+        if (length == NumDataBits)
+        {
+            flip_bitset_bits(m_original, 0, length, old_bits ^ new_bits);
+            m_stored = m_strategy->encode(m_original);
+        }
+        else
+        {
+            status = m_strategy->update(m_stored, bit_offset, old_bits, new_bits, length);
+
+            if (!decode_unrepaired(status))
+                flip_bitset_bits(m_original, bit_offset, length, old_bits ^ new_bits);
+        }
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        m_telemetry->count_encode();
+#endif
+
+        return status;
     }
 
+
     DecodeResult<NumDataBits, NumEncodedBits> retrieve() const
     {
         auto result = m_strategy->decode(m_stored);
@@ -66,7 +113,27 @@ public:
 
         result.correct = result.original_bits == result.decoded_bits;
 
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        m_telemetry->count_decode(result.status(), result.correct);
+#endif
+
+        return result;
+    }
+
+
+    // hot path retrieval: decoded data and status only, without the diagnostic copies
+    // of the stored and original bits that retrieve() fills in
+    CompactDecodeResult<NumDataBits> retrieve_compact() const
+    {
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        auto result = m_strategy->decode_compact(m_stored);
+
+        m_telemetry->count_decode(result.status, m_original == result.decoded_bits);
+
         return result;
+#else
+        return m_strategy->decode_compact(m_stored);
+#endif
     }
 
 
@@ -0,0 +1,466 @@
+/*-----------------------------------------------------------------------------
+ * ChunkArray.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <algorithm>
+#include "PackedWords.h"
+#include "CorrectionStrategy.h"
+#include "ThreadPool.h"
+
+#if ECC_TELEMETRY
+#include "EccTelemetry.h"
+#endif
+
+
+/*
+ * A protected memory region: many consecutive chunks (codewords) of one Strategy, e.g.
+ * ChunkArray<HammingCode<64>>. Unlike an array of Chunk there is no per-chunk strategy pointer
+ * or original copy: codewords are bit-packed back to back (NUM_ENCODED_BITS each) into a single
+ * cache-line-aligned buffer, so HammingCode<64> costs 9 bytes per 8 bytes of data.
+ *
+ * Data is addressed in bytes. read() decodes the codewords a byte range touches, write() does a
+ * read-modify-write of codewords it only partially covers and a plain encode of the rest.
+ * Optionally a golden (uncorrupted) copy of the data is kept out of line, to tell corrected
+ * data from miscorrected data when evaluating a strategy
+ */
+template <class Strategy>
+class ChunkArray
+{
+public:
+    static constexpr size_t NumDataBits = Strategy::NUM_DATA_BITS;
+    static constexpr size_t NumEncodedBits = Strategy::NUM_ENCODED_BITS;
+    static constexpr size_t DATA_WORD_COUNT = Strategy::DATA_WORD_COUNT;
+    static constexpr size_t STORED_WORD_COUNT = Strategy::STORED_WORD_COUNT;
+
+    static constexpr size_t DATA_BYTES_PER_CHUNK = NumDataBits / 8;
+    static constexpr size_t CACHE_LINE_BYTES = 64;
+
+    // chunks handed to the strategy per batch call; bounded in words, as the block buffers live on the stack
+    static constexpr size_t BLOCK_CHUNKS = STORED_WORD_COUNT >= 2048 ? 1 : 2048 / STORED_WORD_COUNT;
+
+    // unit of work when the region is processed on a ThreadPool (see BulkProtect.h): about 64 KiB
+    // of data, so a block's codewords stay in L2 while it is worked on, and a multiple of 64
+    // chunks, so blocks start on storage word boundaries and never share a word
+    static constexpr size_t PARALLEL_BLOCK_CHUNKS = std::max<size_t>(64, 65536 / DATA_BYTES_PER_CHUNK / 64 * 64);
+
+    static_assert(NumDataBits % 8 == 0, "ChunkArray addresses data in bytes, so chunks must hold whole bytes");
+
+
+    // what decoding the touched chunks found
+    struct AccessResult
+    {
+        size_t chunks;          // chunks decoded
+        size_t corrected;       // ...that had an error corrected
+        size_t uncorrectable;   // ...that had an error that couldn't be corrected
+        uint8_t status;         // all their DecodeStatus flags OR'ed together
+
+        AccessResult() : chunks(0), corrected(0), uncorrectable(0), status(DECODE_CLEAN)
+        {
+        }
+
+        void add(uint8_t chunk_status)
+        {
+            ++chunks;
+            status |= chunk_status;
+
+            if (chunk_status & DECODE_CORRECTED) ++corrected;
+            if (chunk_status & DECODE_UNCORRECTABLE) ++uncorrectable;
+        }
+    };
+
+
+private:
+    struct AlignedDelete
+    {
+        void operator()(uint64_t* p) const
+        {
+            ::operator delete[](p, std::align_val_t(CACHE_LINE_BYTES));
+        }
+    };
+
+    Strategy m_strategy;
+    size_t m_chunk_count;
+    size_t m_storage_words;
+    std::unique_ptr<uint64_t[], AlignedDelete> m_storage;   // bit-packed codewords
+    std::unique_ptr<uint8_t[]> m_golden;                    // optional uncorrupted copy of the data
+
+
+    // zeroes storage (and the golden copy) and encodes zero data into every chunk, as blocks of
+    // PARALLEL_BLOCK_CHUNKS. Given a pool the blocks are spread over it the way the bulk
+    // operations spread them, each worker starting on the blocks of its worker number, so on a
+    // NUMA machine each page is first touched, and so placed, on the node of the worker that
+    // starts on it in those too (unless it was stolen, here or there)
+    void initialize(ThreadPool* pool)
+    {
+        // not every strategy encodes zero data as an all zero codeword
+        uint64_t zero_data[DATA_WORD_COUNT] = {};
+        uint64_t zero_encoded[STORED_WORD_COUNT];
+
+        m_strategy.Strategy::encode_batch(zero_data, 1, zero_encoded);
+
+        const auto blocks = parallel_block_count();
+        const auto init_block = [&](size_t block)
+        {
+            const auto first = block * PARALLEL_BLOCK_CHUNKS;
+            const auto count = std::min(PARALLEL_BLOCK_CHUNKS, m_chunk_count - first);
+
+            // the last block also takes the padding up to the end of the storage
+            const auto word_lo = first * NumEncodedBits / WORD_BITS;
+            const auto word_hi = block + 1 == blocks ? m_storage_words : (first + count) * NumEncodedBits / WORD_BITS;
+
+            memset(m_storage.get() + word_lo, 0, (word_hi - word_lo) * sizeof(uint64_t));
+
+            if (m_golden)
+                memset(m_golden.get() + first * DATA_BYTES_PER_CHUNK, 0, count * DATA_BYTES_PER_CHUNK);
+
+            for (size_t i = first; i < first + count; ++i)
+                copy_word_bits(m_storage.get(), i * NumEncodedBits, zero_encoded, 0, NumEncodedBits);
+        };
+
+        if (pool != nullptr)
+            pool->parallel_for_stealing(blocks, init_block);
+        else
+            for (size_t block = 0; block < blocks; ++block)
+                init_block(block);
+    }
+
+
+    // decodes chunks [first, first + count) (count <= BLOCK_CHUNKS) into data words
+    void decode_block(size_t first, size_t count, uint64_t* data, uint8_t* status) const
+    {
+        uint64_t encoded[BLOCK_CHUNKS * STORED_WORD_COUNT];
+
+        load_chunks(first, count, encoded);
+#if ECC_TELEMETRY
+        const auto sample = TelemetrySample::begin(count);
+#endif
+        m_strategy.Strategy::decode_batch(encoded, count, data, status);
+#if ECC_TELEMETRY
+        record_decodes(first, count, data, status, sample);
+#endif
+    }
+
+
+public:
+    // num_bytes is rounded up to whole chunks. Every chunk starts out holding zeroed data. Given
+    // a pool, the zeroing is done on it (for big regions on NUMA machines, see initialize)
+    explicit ChunkArray(size_t num_bytes, bool keep_golden_copy = false, const Strategy& strategy = Strategy(), ThreadPool* pool = nullptr)
+        : m_strategy(strategy),
+          m_chunk_count((num_bytes + DATA_BYTES_PER_CHUNK - 1) / DATA_BYTES_PER_CHUNK)
+    {
+        // round storage up to whole cache lines, so the last line is never shared with anything else
+        const auto line_words = CACHE_LINE_BYTES / sizeof(uint64_t);
+
+        m_storage_words = (word_count(m_chunk_count * NumEncodedBits) + line_words - 1) / line_words * line_words;
+        m_storage.reset(static_cast<uint64_t*>(::operator new[](m_storage_words * sizeof(uint64_t), std::align_val_t(CACHE_LINE_BYTES))));
+
+        if (keep_golden_copy)
+            m_golden.reset(new uint8_t[size()]);
+
+        initialize(pool);
+    }
+
+
+    // size of the protected data, in bytes
+    size_t size() const
+    {
+        return m_chunk_count * DATA_BYTES_PER_CHUNK;
+    }
+
+    size_t chunk_count() const
+    {
+        return m_chunk_count;
+    }
+
+    // blocks of PARALLEL_BLOCK_CHUNKS chunks (the last one may be short)
+    size_t parallel_block_count() const
+    {
+        return (m_chunk_count + PARALLEL_BLOCK_CHUNKS - 1) / PARALLEL_BLOCK_CHUNKS;
+    }
+
+    // bytes actually used to hold the codewords
+    size_t stored_bytes() const
+    {
+        return m_storage_words * sizeof(uint64_t);
+    }
+
+    const Strategy& strategy() const
+    {
+        return m_strategy;
+    }
+
+
+    bool has_golden_copy() const
+    {
+        return m_golden != nullptr;
+    }
+
+    // the data as it was last written, or nullptr without a golden copy
+    const uint8_t* golden() const
+    {
+        return m_golden.get();
+    }
+
+
+    // copies len bytes starting at offset into buf, correcting what the strategy can.
+    // Corrections are not written back (that is what store_chunks, or a scrubber, is for)
+    AccessResult read(size_t offset, size_t len, uint8_t* buf) const
+    {
+        assert(offset + len <= size());
+
+        AccessResult result;
+
+        if (len == 0)
+            return result;
+
+        uint64_t data[BLOCK_CHUNKS * DATA_WORD_COUNT];
+        uint8_t status[BLOCK_CHUNKS];
+        uint8_t bytes[DATA_BYTES_PER_CHUNK];
+
+        const auto first = offset / DATA_BYTES_PER_CHUNK;
+        const auto last = (offset + len - 1) / DATA_BYTES_PER_CHUNK;
+
+        for (size_t block = first; block <= last; block += BLOCK_CHUNKS)
+        {
+            const auto count = std::min(BLOCK_CHUNKS, last + 1 - block);
+
+            decode_block(block, count, data, status);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                // part of this chunk that lies within [offset, offset + len)
+                const auto chunk_offset = (block + i) * DATA_BYTES_PER_CHUNK;
+                const auto lo = std::max(offset, chunk_offset);
+                const auto hi = std::min(offset + len, chunk_offset + DATA_BYTES_PER_CHUNK);
+
+                words_to_bytes(data + i * DATA_WORD_COUNT, NumDataBits, bytes);
+                memcpy(buf + (lo - offset), bytes + (lo - chunk_offset), hi - lo);
+
+                result.add(status[i]);
+            }
+        }
+
+        return result;
+    }
+
+
+    // stores len bytes from buf starting at offset. Chunks only partially covered are decoded first
+    // and their remaining bytes kept; the result describes those decodes. A partially covered chunk
+    // that turns out uncorrectable is left as it is, error and all, rather than re-encoded into a
+    // valid codeword around garbage: its part of buf is not written (result.uncorrectable says so)
+    AccessResult write(size_t offset, const uint8_t* buf, size_t len)
+    {
+        assert(offset + len <= size());
+
+        AccessResult result;
+
+        if (len == 0)
+            return result;
+
+        uint64_t data[BLOCK_CHUNKS * DATA_WORD_COUNT];
+        uint64_t encoded[BLOCK_CHUNKS * STORED_WORD_COUNT];
+        uint8_t bytes[DATA_BYTES_PER_CHUNK];
+        bool skip[BLOCK_CHUNKS];
+
+        const auto first = offset / DATA_BYTES_PER_CHUNK;
+        const auto last = (offset + len - 1) / DATA_BYTES_PER_CHUNK;
+
+        for (size_t block = first; block <= last; block += BLOCK_CHUNKS)
+        {
+            const auto count = std::min(BLOCK_CHUNKS, last + 1 - block);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto chunk_offset = (block + i) * DATA_BYTES_PER_CHUNK;
+                const auto lo = std::max(offset, chunk_offset);
+                const auto hi = std::min(offset + len, chunk_offset + DATA_BYTES_PER_CHUNK);
+                const auto words = data + i * DATA_WORD_COUNT;
+
+                skip[i] = false;
+
+                if (hi - lo == DATA_BYTES_PER_CHUNK)
+                {
+                    bytes_to_words(buf + (lo - offset), NumDataBits, words);
+                } else
+                {
+                    // read-modify-write: keep the bytes of this chunk that aren't being written
+                    uint8_t status;
+
+                    decode_block(block + i, 1, words, &status);
+                    result.add(status);
+
+                    skip[i] = (status & DECODE_UNCORRECTABLE) != 0;
+
+                    words_to_bytes(words, NumDataBits, bytes);
+                    memcpy(bytes + (lo - chunk_offset), buf + (lo - offset), hi - lo);
+                    bytes_to_words(bytes, NumDataBits, words);
+                }
+
+                if (m_golden && !skip[i])
+                    memcpy(m_golden.get() + lo, buf + (lo - offset), hi - lo);
+            }
+
+#if ECC_TELEMETRY
+            const auto sample = TelemetrySample::begin(count);
+#endif
+            m_strategy.Strategy::encode_batch(data, count, encoded);
+#if ECC_TELEMETRY
+            telemetry_of<Strategy>().record_encode(count, sample);
+#endif
+
+            // runs of chunks to store, around the skipped ones
+            for (size_t i = 0; i < count;)
+            {
+                if (skip[i])
+                {
+                    ++i;
+                    continue;
+                }
+
+                auto end = i + 1;
+
+                while (end < count && !skip[end])
+                    ++end;
+
+                store_chunks(block + i, end - i, encoded + i * STORED_WORD_COUNT);
+                i = end;
+            }
+        }
+
+        return result;
+    }
+
+
+    // raw access to codewords [first, first + count), unpacked to / packed from STORED_WORD_COUNT
+    // words each. For things that work on codewords directly, like scrubbing or fault injection
+    void load_chunks(size_t first, size_t count, uint64_t* encoded) const
+    {
+        assert(first + count <= m_chunk_count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto out = encoded + i * STORED_WORD_COUNT;
+
+            out[STORED_WORD_COUNT - 1] = 0;
+            copy_word_bits(out, 0, m_storage.get(), (first + i) * NumEncodedBits, NumEncodedBits);
+        }
+    }
+
+    void store_chunks(size_t first, size_t count, const uint64_t* encoded)
+    {
+        assert(first + count <= m_chunk_count);
+
+        for (size_t i = 0; i < count; ++i)
+            copy_word_bits(m_storage.get(), (first + i) * NumEncodedBits, encoded + i * STORED_WORD_COUNT, 0, NumEncodedBits);
+    }
+
+
+    // decodes chunks [first, first + count) and, with write_back, stores the corrected ones again
+    // (see rewrite_corrected). on_chunk(chunk, status) is called, in chunk order, for every chunk
+    // counted as corrected or uncorrectable. The loop behind scrubbing and bulk verification
+    template <class OnChunk>
+    AccessResult repair(size_t first, size_t count, bool write_back, OnChunk&& on_chunk)
+    {
+        assert(first + count <= m_chunk_count);
+
+        AccessResult result;
+        uint64_t data[BLOCK_CHUNKS * DATA_WORD_COUNT];
+        uint8_t status[BLOCK_CHUNKS];
+
+        for (size_t block = first; block < first + count; block += BLOCK_CHUNKS)
+        {
+            const auto n = std::min(BLOCK_CHUNKS, first + count - block);
+
+            decode_block(block, n, data, status);
+
+            if (write_back)
+                rewrite_corrected(m_strategy, data, status, n, m_storage.get(), block);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                ++result.chunks;
+                result.status |= status[i];
+
+                if (status[i] & DECODE_UNCORRECTABLE)
+                    ++result.uncorrectable;
+                else if (status[i] & DECODE_CORRECTED)
+                    ++result.corrected;
+                else
+                    continue;
+
+                on_chunk(block + i, status[i]);
+            }
+        }
+
+        return result;
+    }
+
+
+    // re-encodes the corrected ones among count decoded chunks (data words and status as from
+    // decode_batch) and stores them as chunks [first, first + count) of storage, packed the way
+    // a ChunkArray packs them. Uncorrectable chunks are left alone: rewriting would just make the
+    // garbage look valid. Also used for EccContainer blocks, which are packed the same way
+    static void rewrite_corrected(const Strategy& strategy, const uint64_t* data, const uint8_t* status, size_t count, uint64_t* storage, size_t first)
+    {
+        uint64_t encoded[STORED_WORD_COUNT];
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if ((status[i] & (DECODE_CORRECTED | DECODE_UNCORRECTABLE)) != DECODE_CORRECTED)
+                continue;
+
+            strategy.Strategy::encode_batch(data + i * DATA_WORD_COUNT, 1, encoded);
+            copy_word_bits(storage, (first + i) * NumEncodedBits, encoded, 0, NumEncodedBits);
+        }
+    }
+
+
+    // whether decoded data words of chunk are what was last written; needs the golden copy
+    bool matches_golden(size_t chunk, const uint64_t* data) const
+    {
+        assert(m_golden && chunk < m_chunk_count);
+
+        uint8_t bytes[DATA_BYTES_PER_CHUNK];
+
+        words_to_bytes(data, NumDataBits, bytes);
+        return memcmp(bytes, m_golden.get() + chunk * DATA_BYTES_PER_CHUNK, DATA_BYTES_PER_CHUNK) == 0;
+    }
+
+
+#if ECC_TELEMETRY
+    // reports decoding chunks [first, first + count) to the strategy's telemetry; with a golden
+    // copy the decoded data is checked against it, to catch miscorrections
+    void record_decodes(size_t first, size_t count, const uint64_t* data, const uint8_t* status, const TelemetrySample& sample) const
+    {
+        if (!m_golden)
+        {
+            telemetry_of<Strategy>().record_decode(status, count, sample);
+            return;
+        }
+
+        uint64_t counts[OUTCOME_COUNT] = {};
+
+        for (size_t i = 0; i < count; ++i)
+            ++counts[classify_outcome(matches_golden(first + i, data + i * DATA_WORD_COUNT), status[i])];
+
+        telemetry_of<Strategy>().record_decode(counts, count, sample);
+    }
+#endif
+
+
+    // flips one stored bit; bit_idx counts over all codewords (chunk bit_idx / NumEncodedBits)
+    void corrupt(size_t bit_idx)
+    {
+        assert(bit_idx < m_chunk_count * NumEncodedBits);
+
+        flip_word_bit(m_storage.get(), bit_idx);
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end ChunkArray.h
+ *///////////////////////////////////////////////////////////////////////////*/
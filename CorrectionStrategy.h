@@ -3,7 +3,9 @@
  *---------------------------------------------------------------------------*/
 #pragma once
 #include <bitset>
+#include <cassert>
 #include "DecodeResult.h"
+#include "PackedWords.h"
 
 
 template <size_t NumDataBits, size_t NumEncodedBits>
@@ -13,7 +15,18 @@ struct CorrectionStrategy
     typedef std::bitset<NumDataBits> DataBits;
     typedef std::bitset<NumEncodedBits> StoredBits;
 
-    typedef DecodeResult<NumDataBits, NumEncodedBits> DecodeResult;
+    typedef ::DecodeResult<NumDataBits, NumEncodedBits> DecodeResult;
+
+    static constexpr size_t NUM_DATA_BITS = NumDataBits;
+    static constexpr size_t NUM_ENCODED_BITS = NumEncodedBits;
+
+    // packed sizes (in 64-bit words) of one data word / one codeword for the batch API
+    static constexpr size_t DATA_WORD_COUNT = word_count(NumDataBits);
+    static constexpr size_t STORED_WORD_COUNT = word_count(NumEncodedBits);
+
+    // valid bits of the last word of a packed data word / codeword
+    static constexpr uint64_t LAST_DATA_WORD_MASK = low_bits_mask(NumDataBits - (DATA_WORD_COUNT - 1) * WORD_BITS);
+    static constexpr uint64_t LAST_STORED_WORD_MASK = low_bits_mask(NumEncodedBits - (STORED_WORD_COUNT - 1) * WORD_BITS);
 
 
     // data = data to generate check bit data from
@@ -22,6 +35,87 @@ struct CorrectionStrategy
     // storedData = data stored in memory. Might be corrupt. Was generated using encode()
     virtual DecodeResult decode(StoredBits storedData) const = 0;
 
+    // same decode, lean result (see CompactDecodeResult). The default derives it from decode();
+    // strategies override it to skip filling the diagnostic fields
+    virtual CompactDecodeResult<NumDataBits> decode_compact(const StoredBits& storedData) const
+    {
+        const auto result = decode(storedData);
+        CompactDecodeResult<NumDataBits> compact;
+
+        compact.decoded_bits = result.decoded_bits;
+        compact.status = result.status();
+
+        return compact;
+    }
+
+
+    // batch variants over contiguous packed buffers (see PackedWords.h). data holds count words of
+    // DATA_WORD_COUNT uint64_t each, encoded holds count codewords of STORED_WORD_COUNT each. Unused
+    // high bits of the last word of each entry are ignored on input and written as zero.
+    // The defaults go through encode()/decode() one codeword at a time; strategies override them
+    // with kernels that work on the packed words directly
+    virtual void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto bits = words_to_bitset<NumDataBits>(data + i * DATA_WORD_COUNT);
+
+            bitset_to_words(encode(bits), encoded + i * STORED_WORD_COUNT);
+        }
+    }
+
+    // status receives one DecodeStatus byte per codeword
+    virtual void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto result = decode(words_to_bitset<NumEncodedBits>(encoded + i * STORED_WORD_COUNT));
+
+            bitset_to_words(result.decoded_bits, data + i * DATA_WORD_COUNT);
+            status[i] = result.status();
+        }
+    }
+
+
+    // changes data bits [bit_offset, bit_offset + length) (length <= 64) of the codeword stored
+    // from old_bits to new_bits, bit i of each being data bit bit_offset + i, and returns the
+    // DecodeStatus of the codeword it found.
+    //
+    // The default decodes, patches the data and re-encodes, so it also corrects errors elsewhere
+    // in the codeword. An error it can't correct (see decode_unrepaired) leaves stored as it was,
+    // as re-encoding would make it look valid. Linear codes override it to flip just the changed
+    // bits and the check bits they feed, in time that depends on length rather than the codeword
+    // size; they don't decode, so return DECODE_CLEAN and leave any error where it was
+    virtual uint8_t update(StoredBits& stored, size_t bit_offset, uint64_t, uint64_t new_bits, size_t length) const
+    {
+        assert(length <= WORD_BITS && bit_offset + length <= NumDataBits);
+
+        const auto result = decode_compact(stored);
+
+        if (decode_unrepaired(result.status))
+            return result.status;
+
+        auto data = result.decoded_bits;
+
+        for (size_t i = 0; i < length; ++i)
+            data[bit_offset + i] = ((new_bits >> i) & 1) != 0;
+
+        stored = encode(data);
+
+        return result.status;
+    }
+
+protected:
+    // update() for linear codes, where the codeword of data ^ delta is the codeword of data ^ the
+    // codeword of delta: one encode whatever the length, so the overrides switch to it for long
+    // writes. Like flipping the bits one at a time it leaves an error in stored where it was
+    void update_by_encode(StoredBits& stored, size_t bit_offset, uint64_t delta, size_t length) const
+    {
+        DataBits bits;
+
+        flip_bitset_bits(bits, bit_offset, length, delta);
+        stored ^= encode(bits);
+    }
 };
 
 /*/////////////////////////////////////////////////////////////////////////////
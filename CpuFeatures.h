@@ -0,0 +1,137 @@
+/*-----------------------------------------------------------------------------
+ * CpuFeatures.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+
+/*
+ * The SIMD instruction sets of the CPU we're running on, for kernels that are compiled for more
+ * than the build's baseline and picked at run time (GaloisField::region, Crc::update and the
+ * BitslicedHammingCode batches). That keeps a default build portable: it runs on any x86-64 and
+ * still uses AVX2 / SSSE3 / SSE4.2 / PCLMULQDQ where they're there. When the build itself
+ * targets an instruction set (-march=native, -mavx2, ...) the check is constant true.
+ *
+ * ECC_TARGET(isa) compiles one function for isa whatever the build flags (GCC, Clang; MSVC
+ * compiles any intrinsic anyway). Such a function may only be called once the matching
+ * cpu_has_*() returned true. ECC_FORCE_INLINE is for code shared by differently targeted
+ * callers: it is compiled into each of them, for that caller's instruction set
+ */
+#if defined(__x86_64__) || defined(_M_X64)
+#define ECC_X86_64 1
+#else
+#define ECC_X86_64 0
+#endif
+
+#if ECC_X86_64 && (defined(__GNUC__) || defined(__clang__))
+#define ECC_TARGET(isa) __attribute__((target(isa)))
+#else
+#define ECC_TARGET(isa)
+#endif
+
+#if defined(_MSC_VER)
+#define ECC_FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+#define ECC_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define ECC_FORCE_INLINE inline
+#endif
+
+#if ECC_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+
+struct CpuFeatures
+{
+    bool ssse3;
+    bool sse42;
+    bool pclmul;
+    bool avx2;
+};
+
+
+inline CpuFeatures detect_cpu_features()
+{
+    CpuFeatures features = { false, false, false, false };
+
+#if ECC_X86_64 && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+
+    features.ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    features.sse42 = __builtin_cpu_supports("sse4.2") != 0;
+    features.pclmul = __builtin_cpu_supports("pclmul") != 0;
+    features.avx2 = __builtin_cpu_supports("avx2") != 0;
+#elif ECC_X86_64 && defined(_MSC_VER)
+    int regs[4];
+
+    __cpuid(regs, 0);
+    const auto max_leaf = regs[0];
+
+    __cpuid(regs, 1);
+    features.ssse3 = (regs[2] >> 9) & 1;
+    features.sse42 = (regs[2] >> 20) & 1;
+    features.pclmul = (regs[2] >> 1) & 1;
+
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+    const bool os_saves_ymm = ((regs[2] >> 27) & 1) && (_xgetbv(0) & 6) == 6;
+
+    if (max_leaf >= 7)
+    {
+        __cpuidex(regs, 7, 0);
+        features.avx2 = os_saves_ymm && ((regs[1] >> 5) & 1);
+    }
+#endif
+
+    return features;
+}
+
+
+inline const CpuFeatures& cpu_features()
+{
+    static const auto features = detect_cpu_features();
+
+    return features;
+}
+
+
+inline bool cpu_has_ssse3()
+{
+#if defined(__SSSE3__)
+    return true;
+#else
+    return cpu_features().ssse3;
+#endif
+}
+
+inline bool cpu_has_sse42()
+{
+#if defined(__SSE4_2__)
+    return true;
+#else
+    return cpu_features().sse42;
+#endif
+}
+
+inline bool cpu_has_pclmul()
+{
+#if defined(__PCLMUL__)
+    return true;
+#else
+    return cpu_features().pclmul;
+#endif
+}
+
+inline bool cpu_has_avx2()
+{
+#if defined(__AVX2__)
+    return true;
+#else
+    return cpu_features().avx2;
+#endif
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end CpuFeatures.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,467 @@
+/*-----------------------------------------------------------------------------
+ * CrcCheck.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include "CorrectionStrategy.h"
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+#include "CpuFeatures.h"
+
+
+// reverses the bit order of the low width bits of value
+constexpr uint64_t reflect_bits(uint64_t value, size_t width)
+{
+    uint64_t reflected = 0;
+
+    for (size_t i = 0; i < width; ++i)
+        if (value & (uint64_t(1) << i))
+            reflected |= uint64_t(1) << (width - 1 - i);
+
+    return reflected;
+}
+
+
+// x^power mod P(x) for a width bit CRC polynomial in normal form (the x^width term implied)
+constexpr uint64_t crc_x_pow_mod(size_t power, uint64_t poly, size_t width)
+{
+    const uint64_t top = uint64_t(1) << (width - 1);
+    const uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    uint64_t value = 1;
+
+    for (size_t i = 0; i < power; ++i)
+    {
+        const bool carry = (value & top) != 0;
+
+        value = (value << 1) & mask;
+
+        if (carry)
+            value ^= poly;
+    }
+
+    return value;
+}
+
+
+// CRC-32C (Castagnoli; iSCSI, ext4, SSE4.2's crc32 instruction)
+struct Crc32cParams
+{
+    typedef uint32_t Value_t;
+
+    static constexpr size_t WIDTH = 32;
+    static constexpr uint64_t POLY = 0x1EDC6F41;
+    static constexpr Value_t INIT = 0xFFFFFFFF;
+    static constexpr Value_t XOR_OUT = 0xFFFFFFFF;
+    static constexpr bool HARDWARE = true;      // what the crc32 instruction computes
+};
+
+
+// CRC-64/XZ (ECMA-182 polynomial; xz, 7-Zip)
+struct Crc64Params
+{
+    typedef uint64_t Value_t;
+
+    static constexpr size_t WIDTH = 64;
+    static constexpr uint64_t POLY = 0x42F0E1EBA9EA3693;
+    static constexpr Value_t INIT = 0xFFFFFFFFFFFFFFFF;
+    static constexpr Value_t XOR_OUT = 0xFFFFFFFFFFFFFFFF;
+    static constexpr bool HARDWARE = false;
+};
+
+
+// slicing-by-8 tables of a reflected CRC: [0] is the usual byte table, [k][b] is byte b followed
+// by k zero bytes
+template <class Params>
+constexpr std::array<std::array<typename Params::Value_t, 256>, 8> make_crc_tables()
+{
+    typedef typename Params::Value_t Value_t;
+
+    const auto poly = static_cast<Value_t>(reflect_bits(Params::POLY, Params::WIDTH));
+    std::array<std::array<Value_t, 256>, 8> tables{};
+
+    for (size_t b = 0; b < 256; ++b)
+    {
+        auto crc = static_cast<Value_t>(b);
+
+        for (size_t bit = 0; bit < 8; ++bit)
+            crc = (crc & 1) ? static_cast<Value_t>((crc >> 1) ^ poly) : static_cast<Value_t>(crc >> 1);
+
+        tables[0][b] = crc;
+    }
+
+    for (size_t k = 1; k < 8; ++k)
+        for (size_t b = 0; b < 256; ++b)
+            tables[k][b] = static_cast<Value_t>((tables[k - 1][b] >> 8) ^ tables[0][tables[k - 1][b] & 0xFF]);
+
+    return tables;
+}
+
+
+/*
+ * Reflected (LSB first) CRC over bytes, as a streaming checksum:
+ *
+ *     Crc32c crc;
+ *     crc.update(first, n1);
+ *     crc.update(second, n2);
+ *     crc.value();            // == Crc32c::compute(first and second back to back)
+ *
+ * update() picks the fastest kernel the build allows:
+ *  - PCLMULQDQ folding (buffers of FOLD_MIN_BYTES and up): four 16 byte lanes are carried along
+ *    and each is folded 64 bytes ahead with two carry-less multiplies by constants x^k mod P,
+ *    so the loop runs at memory speed. The lanes are then folded into one, and that last 16
+ *    bytes and the tail go through the scalar kernels.
+ *  - SSE4.2 crc32 instruction, 8 bytes at a time, for CRC-32C.
+ *  - slicing by 8: eight table lookups per 8 bytes, no dependency between them.
+ *
+ * The state is the raw register (before XOR_OUT); update(state, ...) forms work on that directly
+ */
+template <class Params>
+class Crc
+{
+public:
+    typedef typename Params::Value_t Value_t;
+
+    static constexpr size_t WIDTH = Params::WIDTH;
+    static constexpr uint64_t POLY = Params::POLY;
+    static constexpr Value_t INIT = Params::INIT;
+    static constexpr Value_t XOR_OUT = Params::XOR_OUT;
+    // below this the crc32 instruction beats folding's fixed cost; tables never do
+    static constexpr size_t FOLD_MIN_BYTES = Params::HARDWARE ? 256 : 64;
+
+    static constexpr auto TABLES = make_crc_tables<Params>();
+
+private:
+    Value_t m_state;
+
+
+    static uint64_t load_le64(const uint8_t* p)
+    {
+        uint64_t value = 0;
+
+        for (size_t i = 0; i < 8; ++i)
+            value |= static_cast<uint64_t>(p[i]) << (8 * i);
+
+        return value;
+    }
+
+
+    static Value_t update_byte(Value_t state, uint8_t byte)
+    {
+        return static_cast<Value_t>((static_cast<uint64_t>(state) >> 8) ^ TABLES[0][(state ^ byte) & 0xFF]);
+    }
+
+public:
+    Crc() : m_state(INIT)
+    {
+    }
+
+
+    void reset()
+    {
+        m_state = INIT;
+    }
+
+
+    void update(const void* data, size_t length)
+    {
+        m_state = update(m_state, static_cast<const uint8_t*>(data), length);
+    }
+
+
+    Value_t value() const
+    {
+        return static_cast<Value_t>(m_state ^ XOR_OUT);
+    }
+
+
+    // one shot
+    static Value_t compute(const void* data, size_t length)
+    {
+        return static_cast<Value_t>(update(INIT, static_cast<const uint8_t*>(data), length) ^ XOR_OUT);
+    }
+
+
+    static Value_t update(Value_t state, const uint8_t* data, size_t length)
+    {
+#if ECC_X86_64
+        if (length >= FOLD_MIN_BYTES && cpu_has_pclmul())
+            return update_folded(state, data, length);
+#endif
+
+        return update_scalar(state, data, length);
+    }
+
+
+    // best kernel without carry-less multiply: the crc32 instruction where it applies, else tables
+    static Value_t update_scalar(Value_t state, const uint8_t* data, size_t length)
+    {
+#if ECC_X86_64
+        if constexpr (Params::HARDWARE)
+        {
+            if (cpu_has_sse42())
+                return update_instruction(state, data, length);
+        }
+#endif
+
+        return update_slicing(state, data, length);
+    }
+
+
+    static Value_t update_slicing(Value_t state, const uint8_t* data, size_t length)
+    {
+        for (; length >= 8; data += 8, length -= 8)
+        {
+            // the register lines up with the first WIDTH / 8 bytes; the rest is data alone
+            const auto v = static_cast<uint64_t>(state) ^ load_le64(data);
+
+            state = static_cast<Value_t>(TABLES[7][v & 0xFF] ^ TABLES[6][(v >> 8) & 0xFF] ^
+                                         TABLES[5][(v >> 16) & 0xFF] ^ TABLES[4][(v >> 24) & 0xFF] ^
+                                         TABLES[3][(v >> 32) & 0xFF] ^ TABLES[2][(v >> 40) & 0xFF] ^
+                                         TABLES[1][(v >> 48) & 0xFF] ^ TABLES[0][v >> 56]);
+        }
+
+        for (; length > 0; ++data, --length)
+            state = update_byte(state, *data);
+
+        return state;
+    }
+
+
+#if ECC_X86_64
+    static ECC_TARGET("sse4.2") Value_t update_instruction(Value_t state, const uint8_t* data, size_t length)
+    {
+        uint64_t crc = state;
+
+        for (; length >= 8; data += 8, length -= 8)
+            crc = _mm_crc32_u64(crc, load_le64(data));
+
+        for (; length > 0; ++data, --length)
+            crc = _mm_crc32_u8(static_cast<uint32_t>(crc), *data);
+
+        return static_cast<Value_t>(crc);
+    }
+
+
+    /*
+     * In LSB first order a 16 byte block is a 128 bit polynomial X = H x^64 + L, H the low 8
+     * bytes. Moving it d bits further down the message, X x^d = H x^(64 + d) + L x^d, is mod P
+     * the same as H (x^(64 + d) mod P) + L (x^d mod P): two 64 x 64 bit carry-less products that
+     * fit in 128 bits again and are XORed into the block d bits ahead. On bit reflected operands
+     * PCLMULQDQ returns the product times x, hence the constants are x^(k - 1) mod P
+     */
+    static constexpr uint64_t fold_constant(size_t power)
+    {
+        return reflect_bits(crc_x_pow_mod(power - 1, POLY, WIDTH), 64);
+    }
+
+
+    static ECC_TARGET("pclmul") __m128i fold(__m128i block, __m128i constants)
+    {
+        return _mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x00), _mm_clmulepi64_si128(block, constants, 0x11));
+    }
+
+
+    // length >= 64
+    static ECC_TARGET("pclmul") Value_t update_folded(Value_t state, const uint8_t* data, size_t length)
+    {
+        // lane 0 (H) times x^(64 + d), lane 1 (L) times x^d; d = 512 across the four lanes, 128 to the next block
+        constexpr uint64_t K_576 = fold_constant(576);
+        constexpr uint64_t K_512 = fold_constant(512);
+        constexpr uint64_t K_192 = fold_constant(192);
+        constexpr uint64_t K_128 = fold_constant(128);
+
+        const auto by_4 = _mm_set_epi64x(static_cast<long long>(K_512), static_cast<long long>(K_576));
+        const auto by_1 = _mm_set_epi64x(static_cast<long long>(K_128), static_cast<long long>(K_192));
+
+        const auto* in = reinterpret_cast<const __m128i*>(data);
+
+        // the starting register is XORed into the first WIDTH bits of the message
+        auto x0 = _mm_xor_si128(_mm_loadu_si128(in), _mm_cvtsi64_si128(static_cast<long long>(state)));
+        auto x1 = _mm_loadu_si128(in + 1);
+        auto x2 = _mm_loadu_si128(in + 2);
+        auto x3 = _mm_loadu_si128(in + 3);
+
+        for (data += 64, length -= 64; length >= 64; data += 64, length -= 64)
+        {
+            in = reinterpret_cast<const __m128i*>(data);
+
+            x0 = _mm_xor_si128(fold(x0, by_4), _mm_loadu_si128(in));
+            x1 = _mm_xor_si128(fold(x1, by_4), _mm_loadu_si128(in + 1));
+            x2 = _mm_xor_si128(fold(x2, by_4), _mm_loadu_si128(in + 2));
+            x3 = _mm_xor_si128(fold(x3, by_4), _mm_loadu_si128(in + 3));
+        }
+
+        auto x = _mm_xor_si128(fold(x0, by_1), x1);
+
+        x = _mm_xor_si128(fold(x, by_1), x2);
+        x = _mm_xor_si128(fold(x, by_1), x3);
+
+        for (; length >= 16; data += 16, length -= 16)
+            x = _mm_xor_si128(fold(x, by_1), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+
+        // what is left is x followed by the tail, with a zero register
+        alignas(16) uint8_t last[16];
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(last), x);
+
+        return update_scalar(update_scalar(0, last, 16), data, length);
+    }
+#endif
+};
+
+
+typedef Crc<Crc32cParams> Crc32c;
+typedef Crc<Crc64Params> Crc64;
+
+
+/*
+ * Detect-only strategy: the data followed by its CRC. Unlike ParityBit it catches every error of
+ * up to a few bits (the exact count depends on polynomial and length, see error_patterns in
+ * the demo), every odd number of errors for CRC-32C and CRC-64, and any burst of up to WIDTH
+ * bits. Nothing is ever corrected; a mismatch reports DECODE_UNCORRECTABLE.
+ *
+ * The CRC is taken over the data bytes as BitStream / words_to_bytes lay them out (first bit at
+ * the LSB of the first byte), so it matches Crc_t::compute over the same buffer
+ */
+template <size_t NumDataBits, class Crc_t>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class CrcCheck : public CorrectionStrategy<NumDataBits, NumDataBits + Crc_t::WIDTH>
+{
+public:
+    static constexpr size_t DATA_BIT_COUNT = NumDataBits;
+    static constexpr size_t CHECK_BIT_COUNT = Crc_t::WIDTH;
+    static constexpr size_t TOTAL_BIT_COUNT = DATA_BIT_COUNT + CHECK_BIT_COUNT;
+    static constexpr size_t DATA_BYTE_COUNT = (NumDataBits + 7) / 8;
+
+    typedef typename Crc_t::Value_t Value_t;
+    typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
+    typedef DecodeResult<NumDataBits, TOTAL_BIT_COUNT> DecodeResult_t;
+
+    typedef CorrectionStrategy<NumDataBits, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+    using Strategy_t::LAST_STORED_WORD_MASK;
+
+    // CRC of the first DATA_BIT_COUNT bits of words. Whole bytes on a little endian host are the
+    // words' own memory; otherwise they are copied out first
+    static Value_t compute_words(const uint64_t* words)
+    {
+        if (NumDataBits % 8 == 0 && host_is_little_endian())
+            return Crc_t::compute(words, DATA_BYTE_COUNT);
+
+        std::array<uint8_t, DATA_BYTE_COUNT> bytes;
+
+        words_to_bytes(words, NumDataBits, bytes.data());
+
+        return Crc_t::compute(bytes.data(), DATA_BYTE_COUNT);
+    }
+
+
+    // packed word kernels: encoded holds STORED_WORD_COUNT words, data DATA_WORD_COUNT words
+    static void encode_words(const uint64_t* data, uint64_t* encoded)
+    {
+        std::fill(encoded, encoded + STORED_WORD_COUNT, 0);
+        std::copy(data, data + DATA_WORD_COUNT, encoded);
+        encoded[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        write_word_bits(encoded, DATA_BIT_COUNT, CHECK_BIT_COUNT, compute_words(encoded));
+    }
+
+
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data)
+    {
+        Value_t difference;
+
+        return decode_words(encoded, data, difference);
+    }
+
+
+    // as above, also hands back computed ^ stored CRC
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data, Value_t& difference)
+    {
+        std::copy(encoded, encoded + DATA_WORD_COUNT, data);
+        data[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        difference = static_cast<Value_t>(compute_words(data) ^ read_word_bits(encoded, DATA_BIT_COUNT, CHECK_BIT_COUNT));
+
+        return difference != 0 ? DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE : DECODE_CLEAN;
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            encode_words(data + i * DATA_WORD_COUNT, encoded + i * STORED_WORD_COUNT);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            status[i] = decode_words(encoded + i * STORED_WORD_COUNT, data + i * DATA_WORD_COUNT);
+    }
+
+
+    StoredDataBits_t encode(const std::bitset<NumDataBits>& unencodedData) const override
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> data;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+
+        bitset_to_words(unencodedData, data.data());
+        encode_words(data.data(), encoded.data());
+
+        return words_to_bitset<TOTAL_BIT_COUNT>(encoded.data());
+    }
+
+
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+
+        bitset_to_words(storedData, encoded.data());
+
+        const auto status = decode_words(encoded.data(), decoded.data());
+
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+        result.stored_bits = storedData;
+        result.success = status == DECODE_CLEAN;
+        result.error_detected = !result.success;
+        result.num_corrupt_bits = result.success ? 0 : 1;
+        result.num_corrected_bits = 0;
+
+        return result;
+    }
+
+
+    // syndrome: the low 16 bits of computed ^ stored CRC
+    CompactDecodeResult<NumDataBits> decode_compact(const StoredDataBits_t& storedData) const override
+    {
+        CompactDecodeResult<NumDataBits> result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        Value_t difference;
+
+        bitset_to_words(storedData, encoded.data());
+
+        result.status = decode_words(encoded.data(), decoded.data(), difference);
+        result.syndrome = static_cast<uint16_t>(difference);
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+
+        return result;
+    }
+};
+
+
+template <size_t NumDataBits>
+using Crc32cCheck = CrcCheck<NumDataBits, Crc32c>;
+
+template <size_t NumDataBits>
+using Crc64Check = CrcCheck<NumDataBits, Crc64>;
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end CrcCheck.h
+ *///////////////////////////////////////////////////////////////////////////*/
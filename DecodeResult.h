@@ -3,6 +3,49 @@
  *---------------------------------------------------------------------------*/
 #pragma once
 #include <bitset>
+#include <cstdint>
+
+
+// compact per-codeword outcome, one byte each, as written by the batch decoders
+enum DecodeStatus : uint8_t
+{
+    DECODE_CLEAN = 0,                       // no error seen
+    DECODE_ERROR_DETECTED = 1 << 0,         // strategy saw corruption
+    DECODE_CORRECTED = 1 << 1,              // ...and repaired it
+    DECODE_UNCORRECTABLE = 1 << 2           // ...but could not repair it; data is as stored
+};
+
+
+// what a decode amounted to, judged against the data that was actually stored. Used when
+// evaluating strategies (fault injection, error pattern analysis)
+enum DecodeOutcome
+{
+    OUTCOME_CLEAN,          // data intact, nothing reported
+    OUTCOME_CORRECTED,      // data intact, error reported (and corrected)
+    OUTCOME_DETECTED,       // reported uncorrectable
+    OUTCOME_MISCORRECTED,   // data wrong, but reported as corrected
+    OUTCOME_UNDETECTED,     // data wrong, nothing reported
+    OUTCOME_COUNT
+};
+
+
+inline DecodeOutcome classify_outcome(bool data_intact, uint8_t status)
+{
+    if (status & DECODE_UNCORRECTABLE)
+        return OUTCOME_DETECTED;
+
+    if (data_intact)
+        return status == DECODE_CLEAN ? OUTCOME_CLEAN : OUTCOME_CORRECTED;
+
+    return status == DECODE_CLEAN ? OUTCOME_UNDETECTED : OUTCOME_MISCORRECTED;
+}
+
+
+// an error was seen and not repaired: the decoded data is as stored, not as it was written
+inline bool decode_unrepaired(uint8_t status)
+{
+    return (status & DECODE_UNCORRECTABLE) != 0 || (status & (DECODE_ERROR_DETECTED | DECODE_CORRECTED)) == DECODE_ERROR_DETECTED;
+}
 
 
 template <size_t NumDataBits, size_t NumEncodedBits>
@@ -22,6 +65,39 @@ struct DecodeResult
     DecodeResult() : success(false), error_detected(false), correct(false), num_corrupt_bits(0), num_corrected_bits(0)
     {
     }
+
+
+    uint8_t status() const
+    {
+        uint8_t flags = DECODE_CLEAN;
+
+        if (error_detected) flags |= DECODE_ERROR_DETECTED;
+        if (num_corrected_bits > 0) flags |= DECODE_CORRECTED;
+        if (!success) flags |= DECODE_UNCORRECTABLE;
+
+        return flags;
+    }
+};
+
+
+// lean result for hot paths: the decoded data plus a status byte (DecodeStatus flags) and the
+// syndrome the strategy computed (0 when clean; its meaning is strategy specific). DecodeResult
+// also carries the stored and original bits, which is handy for diagnosis but roughly triples
+// the bytes moved per decode, so use that one as the opt-in debug variant
+template <size_t NumDataBits>
+struct CompactDecodeResult
+{
+    std::bitset<NumDataBits> decoded_bits;
+    uint16_t syndrome;
+    uint8_t status;
+
+    CompactDecodeResult() : syndrome(0), status(DECODE_CLEAN)
+    {
+    }
+
+    bool success() const { return (status & DECODE_UNCORRECTABLE) == 0; }
+    bool error_detected() const { return (status & DECODE_ERROR_DETECTED) != 0; }
+    bool corrected() const { return (status & DECODE_CORRECTED) != 0; }
 };
 
 
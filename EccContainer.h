@@ -0,0 +1,405 @@
+/*-----------------------------------------------------------------------------
+ * EccContainer.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "PackedWords.h"
+#include "DecodeResult.h"
+#include "Chunk.h"
+#include "ChunkArray.h"
+#include "HammingCode.h"
+#include "HsiaoCode.h"
+#include "BCHCode.h"
+#include "ReedSolomon.h"
+#include "CrcCheck.h"
+#include "EccTelemetry.h"
+
+
+/*
+ * On-disk container for data protected by one of the codes: a header page, then the blocks.
+ *
+ *   [0, 4096)         ContainerHeader (little endian fields), the rest of the page zero
+ *   block i           at BODY_OFFSET + i * block_stored_bytes: the codewords of data bytes
+ *                     [i * block_data_bytes, (i + 1) * block_data_bytes), bit-packed back to back
+ *                     (stored_bits each) into 64 bit little endian words, zero padded to a page
+ *
+ * Blocks are independent and page aligned, so they can be encoded / decoded in parallel straight
+ * from and into mapped files. The last block's data is zero padded to whole codewords;
+ * original_size says where the real data ends
+ */
+enum ContainerCode : uint32_t
+{
+    CONTAINER_HAMMING_64 = 1,       // HammingCode<64>
+    CONTAINER_HSIAO_64 = 2,         // HsiaoCode<64>
+    CONTAINER_BCH_512_4 = 3,        // BCHCode<512, 4>
+    CONTAINER_BCH_32768_8 = 4,      // BCHCode<32768, 8>
+    CONTAINER_RS_255_223 = 5,       // ReedSolomon<255, 223>
+    CONTAINER_CRC32C_32768 = 6      // Crc32cCheck<32768>, detection only
+};
+
+
+struct ContainerCodeInfo
+{
+    ContainerCode code;
+    const char* name;
+    const char* description;
+};
+
+
+constexpr ContainerCodeInfo CONTAINER_CODES[] = {
+    { CONTAINER_HAMMING_64, "hamming64", "SEC-DED Hamming, 64 data bits (+8)" },
+    { CONTAINER_HSIAO_64, "hsiao64", "SEC-DED Hsiao, 64 data bits (+8)" },
+    { CONTAINER_BCH_512_4, "bch512t4", "BCH, 4 bad bits per 512 (+40)" },
+    { CONTAINER_BCH_32768_8, "bch4kt8", "BCH, 8 bad bits per 4 KiB (+128)" },
+    { CONTAINER_RS_255_223, "rs255", "Reed-Solomon (255, 223), 16 bad bytes per 223" },
+    { CONTAINER_CRC32C_32768, "crc32c4k", "CRC-32C per 4 KiB, detection only (+32)" },
+};
+
+
+inline const ContainerCodeInfo* find_container_code(const std::string& name)
+{
+    for (const auto& info : CONTAINER_CODES)
+        if (name == info.name)
+            return &info;
+
+    return nullptr;
+}
+
+
+inline const ContainerCodeInfo* find_container_code(uint32_t code)
+{
+    for (const auto& info : CONTAINER_CODES)
+        if (code == info.code)
+            return &info;
+
+    return nullptr;
+}
+
+
+template <class Strategy>
+struct StrategyTag
+{
+    typedef Strategy type;
+};
+
+
+// calls fn(StrategyTag<Strategy>()) with the strategy of code; false if there is no such code
+template <class Fn>
+bool with_container_code(uint32_t code, Fn&& fn)
+{
+    switch (code)
+    {
+    case CONTAINER_HAMMING_64: fn(StrategyTag<HammingCode<64>>()); return true;
+    case CONTAINER_HSIAO_64: fn(StrategyTag<HsiaoCode<64>>()); return true;
+    case CONTAINER_BCH_512_4: fn(StrategyTag<BCHCode<512, 4>>()); return true;
+    case CONTAINER_BCH_32768_8: fn(StrategyTag<BCHCode<32768, 8>>()); return true;
+    case CONTAINER_RS_255_223: fn(StrategyTag<ReedSolomon<255, 223>>()); return true;
+    case CONTAINER_CRC32C_32768: fn(StrategyTag<Crc32cCheck<32768>>()); return true;
+    default: return false;
+    }
+}
+
+
+struct ContainerHeader
+{
+    static constexpr char MAGIC[8] = { 'E', 'C', 'C', 'B', 'L', 'O', 'C', 'K' };
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t BODY_OFFSET = 4096;
+    static constexpr size_t BLOCK_ALIGNMENT = 4096;
+    static constexpr size_t SERIALIZED_SIZE = 64;
+
+    uint32_t code;
+    uint32_t data_bits;             // per codeword
+    uint32_t stored_bits;           // per codeword
+    uint64_t original_size;         // bytes of data
+    uint64_t block_data_bytes;
+    uint64_t block_stored_bytes;
+    uint64_t block_count;
+
+    ContainerHeader() : code(0), data_bits(0), stored_bits(0), original_size(0), block_data_bytes(0), block_stored_bytes(0), block_count(0)
+    {
+    }
+
+
+    // whole codewords per block, about block_bytes of data each (at least one codeword, and no
+    // more than original_size needs)
+    static ContainerHeader make(uint32_t code, size_t data_bits, size_t stored_bits, uint64_t original_size, size_t block_bytes)
+    {
+        ContainerHeader header;
+        const auto codeword_bytes = data_bits / 8;
+        const auto needed = original_size / codeword_bytes + (original_size % codeword_bytes != 0);
+        const auto codewords = static_cast<size_t>(std::max<uint64_t>(1, std::min<uint64_t>(block_bytes / codeword_bytes, needed)));
+
+        header.code = code;
+        header.data_bits = static_cast<uint32_t>(data_bits);
+        header.stored_bits = static_cast<uint32_t>(stored_bits);
+        header.original_size = original_size;
+        header.block_data_bytes = codewords * codeword_bytes;
+        header.block_stored_bytes = (word_count(codewords * stored_bits) * sizeof(uint64_t) + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+        header.block_count = original_size / header.block_data_bytes + (original_size % header.block_data_bytes != 0);
+
+        return header;
+    }
+
+
+    size_t codewords_per_block() const
+    {
+        return static_cast<size_t>(block_data_bytes / (data_bits / 8));
+    }
+
+
+    uint64_t container_size() const
+    {
+        return BODY_OFFSET + block_count * block_stored_bytes;
+    }
+
+
+    uint64_t block_offset(uint64_t block) const
+    {
+        return BODY_OFFSET + block * block_stored_bytes;
+    }
+
+
+    // data bytes of block (the last one may be short)
+    size_t block_length(uint64_t block) const
+    {
+        return static_cast<size_t>(std::min(block_data_bytes, original_size - block * block_data_bytes));
+    }
+
+
+    // magic, version, code, data_bits, stored_bits, original_size, block_data_bytes,
+    // block_stored_bytes, block_count, then the CRC-32C of all that
+    void serialize(uint8_t* out) const
+    {
+        uint8_t* p = out;
+
+        memset(out, 0, SERIALIZED_SIZE);
+        memcpy(p, MAGIC, sizeof(MAGIC));
+        p += sizeof(MAGIC);
+
+        p = put(p, VERSION, 4);
+        p = put(p, code, 4);
+        p = put(p, data_bits, 4);
+        p = put(p, stored_bits, 4);
+        p = put(p, original_size, 8);
+        p = put(p, block_data_bytes, 8);
+        p = put(p, block_stored_bytes, 8);
+        p = put(p, block_count, 8);
+
+        put(p, Crc32c::compute(out, static_cast<size_t>(p - out)), 4);
+    }
+
+
+    // false (with the reason in error) if in isn't a header this version can read, or its layout
+    // isn't the one make() gives for its code and size, or doesn't fit in length bytes
+    static bool parse(const uint8_t* in, size_t length, ContainerHeader& header, std::string& error)
+    {
+        const uint8_t* p = in;
+
+        if (length < BODY_OFFSET || memcmp(p, MAGIC, sizeof(MAGIC)) != 0)
+        {
+            error = "not an ecc container";
+            return false;
+        }
+
+        p += sizeof(MAGIC);
+
+        const auto version = get(p, 4);
+
+        header.code = static_cast<uint32_t>(get(p, 4));
+        header.data_bits = static_cast<uint32_t>(get(p, 4));
+        header.stored_bits = static_cast<uint32_t>(get(p, 4));
+        header.original_size = get(p, 8);
+        header.block_data_bytes = get(p, 8);
+        header.block_stored_bytes = get(p, 8);
+        header.block_count = get(p, 8);
+
+        const auto crc = static_cast<uint32_t>(get(p, 4));
+
+        size_t data_bits = 0;
+        size_t stored_bits = 0;
+
+        with_container_code(header.code, [&](auto tag)
+        {
+            data_bits = decltype(tag)::type::NUM_DATA_BITS;
+            stored_bits = decltype(tag)::type::NUM_ENCODED_BITS;
+        });
+
+        if (crc != Crc32c::compute(in, static_cast<size_t>(p - in) - 4))
+            error = "container header is corrupt";
+        else if (version != VERSION)
+            error = "unsupported container version " + std::to_string(version);
+        else if (find_container_code(header.code) == nullptr)
+            error = "unknown code " + std::to_string(header.code);
+        else if (header.data_bits != data_bits || header.stored_bits != stored_bits)
+            error = "codeword size doesn't match the code";
+        else if (header.original_size > length - BODY_OFFSET)
+            error = "container is truncated";       // every code stores at least as many bits as it protects
+        else if (!header.has_layout(make(header.code, data_bits, stored_bits, header.original_size, static_cast<size_t>(header.block_data_bytes))))
+            error = "inconsistent block layout";
+        else if (header.block_count > (UINT64_MAX - BODY_OFFSET) / header.block_stored_bytes || length < header.container_size())
+            error = "container is truncated";
+        else
+            return true;
+
+        return false;
+    }
+
+private:
+    bool has_layout(const ContainerHeader& other) const
+    {
+        return block_data_bytes == other.block_data_bytes && block_stored_bytes == other.block_stored_bytes && block_count == other.block_count;
+    }
+
+
+    static uint8_t* put(uint8_t* p, uint64_t value, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; ++i)
+            *p++ = static_cast<uint8_t>(value >> (8 * i));
+
+        return p;
+    }
+
+
+    static uint64_t get(const uint8_t*& p, size_t bytes)
+    {
+        uint64_t value = 0;
+
+        for (size_t i = 0; i < bytes; ++i)
+            value |= static_cast<uint64_t>(*p++) << (8 * i);
+
+        return value;
+    }
+};
+
+
+// what decoding a block found
+struct BlockReport
+{
+    size_t codewords;
+    size_t corrected;           // codewords with an error corrected
+    size_t uncorrectable;       // codewords with an error that couldn't be
+
+    BlockReport() : codewords(0), corrected(0), uncorrectable(0)
+    {
+    }
+};
+
+
+/*
+ * Encodes / decodes one container block of Strategy codewords. Codewords go through the batch
+ * API BATCH at a time; the stored side is read and written with copy_word_bits, as codewords
+ * need not fill whole words
+ */
+template <class Strategy>
+class ContainerBlockCodec
+{
+public:
+    static constexpr size_t DATA_BITS = Strategy::NUM_DATA_BITS;
+    static constexpr size_t STORED_BITS = Strategy::NUM_ENCODED_BITS;
+    static constexpr size_t DATA_BYTES = DATA_BITS / 8;
+    static constexpr size_t DATA_WORD_COUNT = Strategy::DATA_WORD_COUNT;
+    static constexpr size_t STORED_WORD_COUNT = Strategy::STORED_WORD_COUNT;
+
+    // codewords per batch call; bounded in words, as the batch buffers live on the stack
+    static constexpr size_t BATCH = STORED_WORD_COUNT >= 2048 ? 1 : 2048 / STORED_WORD_COUNT;
+
+    static_assert(DATA_BITS % 8 == 0, "containers hold whole bytes per codeword");
+
+private:
+    Strategy m_strategy;
+
+public:
+    // data: the block's length bytes; the block's codewords past them encode zeros.
+    // stored: the block (codewords * STORED_BITS bits, word aligned)
+    void encode_block(const uint8_t* data, size_t length, size_t codewords, uint64_t* stored) const
+    {
+        uint64_t words[BATCH * DATA_WORD_COUNT];
+        uint64_t encoded[BATCH * STORED_WORD_COUNT];
+
+        for (size_t first = 0; first < codewords; first += BATCH)
+        {
+            const auto n = std::min(BATCH, codewords - first);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const auto offset = (first + i) * DATA_BYTES;
+                const auto bytes = offset < length ? std::min(DATA_BYTES, length - offset) : 0;
+
+                std::fill(words + i * DATA_WORD_COUNT, words + (i + 1) * DATA_WORD_COUNT, 0);
+
+                if (bytes > 0)
+                    bytes_to_words(data + offset, bytes * 8, words + i * DATA_WORD_COUNT);
+            }
+
+#if ECC_TELEMETRY
+            const auto sample = TelemetrySample::begin(n);
+#endif
+            m_strategy.Strategy::encode_batch(words, n, encoded);
+#if ECC_TELEMETRY
+            telemetry_of<Strategy>().record_encode(n, sample);
+#endif
+
+            for (size_t i = 0; i < n; ++i)
+                copy_word_bits(stored, (first + i) * STORED_BITS, encoded + i * STORED_WORD_COUNT, 0, STORED_BITS);
+        }
+    }
+
+
+    // decodes the block into data (length bytes; may be null, to only check). With repair,
+    // corrected codewords are re-encoded and written back to stored
+    BlockReport decode_block(uint64_t* stored, size_t codewords, uint8_t* data, size_t length, bool repair) const
+    {
+        BlockReport report;
+        uint64_t encoded[BATCH * STORED_WORD_COUNT];
+        uint64_t words[BATCH * DATA_WORD_COUNT];
+        uint8_t status[BATCH];
+        uint8_t bytes[DATA_BYTES];
+
+        for (size_t first = 0; first < codewords; first += BATCH)
+        {
+            const auto n = std::min(BATCH, codewords - first);
+
+            for (size_t i = 0; i < n; ++i)
+                copy_word_bits(encoded + i * STORED_WORD_COUNT, 0, stored, (first + i) * STORED_BITS, STORED_BITS);
+
+#if ECC_TELEMETRY
+            const auto sample = TelemetrySample::begin(n);
+#endif
+            m_strategy.Strategy::decode_batch(encoded, n, words, status);
+#if ECC_TELEMETRY
+            telemetry_of<Strategy>().record_decode(status, n, sample);
+#endif
+
+            if (repair)
+                ChunkArray<Strategy>::rewrite_corrected(m_strategy, words, status, n, stored, first);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                const auto offset = (first + i) * DATA_BYTES;
+
+                ++report.codewords;
+
+                if (status[i] & DECODE_UNCORRECTABLE)
+                    ++report.uncorrectable;
+                else if (status[i] & DECODE_CORRECTED)
+                    ++report.corrected;
+
+                if (data != nullptr && offset < length)
+                {
+                    words_to_bytes(words + i * DATA_WORD_COUNT, DATA_BITS, bytes);
+                    memcpy(data + offset, bytes, std::min(DATA_BYTES, length - offset));
+                }
+            }
+        }
+
+        return report;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end EccContainer.h
+ *///////////////////////////////////////////////////////////////////////////*/
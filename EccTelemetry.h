@@ -0,0 +1,967 @@
+/*-----------------------------------------------------------------------------
+ * EccTelemetry.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+#include "DecodeResult.h"
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+
+// the hooks in Chunk, StaticChunk, ChunkArray (which Scrubber and BulkProtect go through) and the
+// container codec are compiled in with -DECC_TELEMETRY=1 (cmake -DECC_TELEMETRY=ON); without it
+// they are preprocessed away. The rest of this header (sources, registry, histograms,
+// exporters) is always compiled, so code can include it unconditionally; only what counts
+// directly into a source then shows up
+#ifndef ECC_TELEMETRY
+#define ECC_TELEMETRY 0
+#endif
+
+// Chunk and StaticChunk only count with -DECC_TELEMETRY_CHUNKS=1 as well (see CMakeLists.txt)
+#ifndef ECC_TELEMETRY_CHUNKS
+#define ECC_TELEMETRY_CHUNKS 0
+#endif
+
+// the rare side of a counting hot path, kept out of line so the caller's loop doesn't pay for it
+#if defined(_MSC_VER)
+#define ECC_TELEMETRY_COLD __declspec(noinline)
+#elif defined(__GNUC__) || defined(__clang__)
+#define ECC_TELEMETRY_COLD __attribute__((noinline, cold))
+#else
+#define ECC_TELEMETRY_COLD
+#endif
+
+
+/*
+ * Latency histogram, HDR style: log-linear buckets with SUB_BUCKETS buckets per power of two,
+ * so any value is known to within 1 / SUB_BUCKETS (6.25%) from 1 ps up to ~1 s. Values are in
+ * picoseconds per codeword, as a batch call's time is spread over the codewords it handled.
+ *
+ * This is the snapshot form; the live histograms are in TelemetrySource's thread slots
+ */
+struct LatencyHistogram
+{
+    static constexpr size_t SUB_BUCKETS = 16;
+    static constexpr size_t MAX_EXPONENT = 36;      // 2^(36 + 4) ps ~ 1.1 s; longer is clamped
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT + 2) * SUB_BUCKETS;
+
+    std::vector<uint64_t> buckets;
+    uint64_t count;
+    uint64_t sum_ps;
+    uint64_t max_ps;
+
+    LatencyHistogram() : buckets(BUCKET_COUNT, 0), count(0), sum_ps(0), max_ps(0)
+    {
+    }
+
+
+    static size_t bucket_of(uint64_t ps)
+    {
+        if (ps < SUB_BUCKETS)
+            return static_cast<size_t>(ps);
+
+        // ps >> e lands in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+        size_t e = 0;
+
+        while ((ps >> e) >= 2 * SUB_BUCKETS && e < MAX_EXPONENT)
+            ++e;
+
+        const auto top = std::min<uint64_t>(ps >> e, 2 * SUB_BUCKETS - 1);
+
+        return (e + 1) * SUB_BUCKETS + static_cast<size_t>(top - SUB_BUCKETS);
+    }
+
+    // smallest value of a bucket
+    static uint64_t bucket_low(size_t bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+            return bucket;
+
+        return (SUB_BUCKETS + bucket % SUB_BUCKETS) << (bucket / SUB_BUCKETS - 1);
+    }
+
+    // one past the largest value of a bucket
+    static uint64_t bucket_high(size_t bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+            return bucket + 1;
+
+        return (SUB_BUCKETS + bucket % SUB_BUCKETS + 1) << (bucket / SUB_BUCKETS - 1);
+    }
+
+
+    // values at or below ps; exact when ps + 1 is a bucket boundary (e.g. a power of two minus one)
+    uint64_t count_at_most(uint64_t ps) const
+    {
+        uint64_t n = 0;
+
+        for (size_t b = 0; b < BUCKET_COUNT && bucket_high(b) <= ps + 1; ++b)
+            n += buckets[b];
+
+        return n;
+    }
+
+    // the value below which fraction q of the samples lie (the top of its bucket, capped at the max)
+    uint64_t percentile(double q) const
+    {
+        if (count == 0)
+            return 0;
+
+        const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(count) + 0.5));
+        uint64_t seen = 0;
+
+        for (size_t b = 0; b < BUCKET_COUNT; ++b)
+        {
+            seen += buckets[b];
+
+            if (seen >= rank)
+                return std::min(bucket_high(b) - 1, max_ps);
+        }
+
+        return max_ps;
+    }
+
+    double mean() const
+    {
+        return count == 0 ? 0.0 : static_cast<double>(sum_ps) / static_cast<double>(count);
+    }
+};
+
+
+// what one strategy type has seen, summed over threads
+struct StrategyTelemetry
+{
+    std::string name;
+    uint64_t outcomes[OUTCOME_COUNT];   // decoded words by DecodeOutcome
+    uint64_t encoded;                   // encoded words
+    LatencyHistogram encode_latency;
+    LatencyHistogram decode_latency;
+
+    StrategyTelemetry() : outcomes(), encoded(0)
+    {
+    }
+
+    uint64_t decoded() const
+    {
+        uint64_t n = 0;
+
+        for (auto count : outcomes)
+            n += count;
+
+        return n;
+    }
+};
+
+
+inline const char* outcome_label(DecodeOutcome outcome)
+{
+    static const char* labels[OUTCOME_COUNT] = { "clean", "corrected", "uncorrectable", "miscorrected", "undetected" };
+
+    return labels[outcome];
+}
+
+
+/*
+ * Decides whether a batch call gets timed: about one per SAMPLE_PERIOD codewords per thread
+ * (across all strategies; a call counts all its codewords), so small batches read the clock
+ * rarely and large ones nearly always. The gaps are jittered, or a loop alternating between
+ * calls (encode, decode, encode, ...) would only ever have the same one sampled. Single
+ * codeword calls (Chunk, StaticChunk) aren't timed at all, see TelemetrySource::count_encode
+ */
+class TelemetrySample
+{
+public:
+    static constexpr int64_t SAMPLE_PERIOD = 1024;
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+    bool m_sampled;
+
+    explicit TelemetrySample(bool sampled) : m_sampled(sampled)
+    {
+        if (sampled)
+            m_start = std::chrono::steady_clock::now();
+    }
+
+public:
+    static TelemetrySample begin(size_t codewords = 1)
+    {
+        static thread_local int64_t countdown = 0;
+        static thread_local uint32_t jitter = 0;
+
+        countdown -= static_cast<int64_t>(codewords);
+
+        if (countdown > 0)
+            return TelemetrySample(false);
+
+        // a thread's first call only seeds the generator (from where its thread locals live)
+        const auto sampled = jitter != 0;
+
+        if (!sampled)
+            jitter = static_cast<uint32_t>((reinterpret_cast<uintptr_t>(&jitter) * 0x9e3779b97f4a7c15ull) >> 32) | 1;
+
+        // xorshift32; the next gap is uniform in [SAMPLE_PERIOD / 2, 3 * SAMPLE_PERIOD / 2)
+        jitter ^= jitter << 13;
+        jitter ^= jitter >> 17;
+        jitter ^= jitter << 5;
+        countdown = SAMPLE_PERIOD / 2 + static_cast<int64_t>(jitter % SAMPLE_PERIOD);
+
+        return TelemetrySample(sampled);
+    }
+
+
+    bool sampled() const
+    {
+        return m_sampled;
+    }
+
+    uint64_t elapsed_ns() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    }
+
+};
+
+
+class TelemetrySource;
+
+template <class Strategy>
+TelemetrySource& telemetry_of();
+
+
+/*
+ * Counters and sampled latencies for one strategy type (every HammingCode<64> in the process
+ * reports to the same source, whether through Chunk, ChunkArray or anything else).
+ *
+ * Each thread gets its own cache line aligned slot, allocated on its first report, so the hot
+ * path is a thread local lookup and plain (single writer) increments; nothing is shared between
+ * cores until a snapshot reads the slots. A thread's number (its slot in every source) goes back
+ * to a free list when it exits, and the next new thread carries on counting in that slot, so
+ * only threads past MAX_THREAD_SLOTS alive at the same time share the overflow slot, updated
+ * atomically.
+ *
+ * Single codeword calls (Chunk, StaticChunk; only with ECC_TELEMETRY_CHUNKS) don't even touch
+ * the slot each time: they count in a plain thread local batch that is added to the slot every BATCH_EVENTS events, when the thread
+ * exits, and when it takes a snapshot itself. Another thread's snapshot thus misses up to
+ * BATCH_EVENTS - 1 of each running thread's latest single codeword counts per source.
+ *
+ * Decodes are counted by DecodeOutcome. Words only count as miscorrected / undetected where the
+ * caller knows the original data (Chunk, or a ChunkArray with a golden copy); elsewhere data is
+ * taken to be intact, so those show up as corrected / clean
+ */
+class TelemetrySource
+{
+public:
+    static constexpr size_t MAX_THREAD_SLOTS = 64;
+    static constexpr size_t CACHE_LINE_BYTES = 64;
+    static constexpr uint64_t BATCH_EVENTS = 256;         // a power of two
+
+private:
+    struct Histogram
+    {
+        std::atomic<uint64_t> buckets[LatencyHistogram::BUCKET_COUNT];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_ps;
+        std::atomic<uint64_t> max_ps;
+
+        Histogram() : count(0), sum_ps(0), max_ps(0)
+        {
+            for (auto& bucket : buckets)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    struct alignas(CACHE_LINE_BYTES) ThreadSlot
+    {
+        std::atomic<uint64_t> outcomes[OUTCOME_COUNT];
+        std::atomic<uint64_t> encoded;
+        Histogram encode_latency;
+        Histogram decode_latency;
+        bool shared;
+
+        explicit ThreadSlot(bool shared_slot) : encoded(0), shared(shared_slot)
+        {
+            for (auto& count : outcomes)
+                count.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    // decodes are batched by DecodeStatus and whether the data was intact, and only turned into
+    // a DecodeOutcome when flushed; encodes follow them
+    static constexpr size_t DECODE_KEYS = 16;
+    static constexpr size_t ENCODE_KEY = DECODE_KEYS;
+    static constexpr size_t BATCH_KEYS = DECODE_KEYS + 1;
+    static constexpr size_t CLEAN_KEY = 1;     // decode_key(DECODE_CLEAN, true), by far the most common
+
+    // a thread's single codeword counts for one source: running totals, of which the slot has
+    // what was flushed. Zero initialized thread locals, so neither constructed nor destroyed per
+    // thread
+    struct Batch
+    {
+        TelemetrySource* source;
+        uint64_t counts[BATCH_KEYS];
+        uint64_t flushed[BATCH_KEYS];
+        bool linked;                            // in the thread's list, flushed when it exits
+        Batch* next;
+    };
+
+    std::string m_name;
+    std::atomic<ThreadSlot*> m_slots[MAX_THREAD_SLOTS + 1];   // the last one is the overflow slot
+    std::unique_ptr<ThreadSlot> m_overflow;
+    std::mutex m_slot_mutex;                                // only taken to allocate a slot
+    std::vector<std::unique_ptr<ThreadSlot>> m_owned;
+
+
+    // thread numbers not in use. Never destroyed, as threads may still exit after static destruction
+    struct ThreadNumbers
+    {
+        std::mutex mutex;
+        std::vector<size_t> free;
+        size_t next = 0;
+
+        static ThreadNumbers& instance()
+        {
+            static auto* numbers = new ThreadNumbers();
+
+            return *numbers;
+        }
+    };
+
+
+    // this thread's slot index; MAX_THREAD_SLOTS for threads past them
+    static size_t thread_number()
+    {
+        static thread_local size_t number = SIZE_MAX;   // constant initialized, so no guard per access
+
+        if (number == SIZE_MAX)
+            number = take_thread_number();
+
+        return number;
+    }
+
+
+    // a thread's first report. The mutex also orders the last writes of a number's previous
+    // thread before the first ones of the next
+    static size_t take_thread_number()
+    {
+        struct Release
+        {
+            size_t number;
+
+            ~Release()
+            {
+                auto& numbers = ThreadNumbers::instance();
+                std::lock_guard<std::mutex> lock(numbers.mutex);
+
+                numbers.free.push_back(number);
+            }
+        };
+
+        auto& numbers = ThreadNumbers::instance();
+        size_t number = MAX_THREAD_SLOTS;
+
+        {
+            std::lock_guard<std::mutex> lock(numbers.mutex);
+
+            if (!numbers.free.empty())
+            {
+                number = numbers.free.back();
+                numbers.free.pop_back();
+            }
+            else if (numbers.next < MAX_THREAD_SLOTS)
+                number = numbers.next++;
+        }
+
+        // handed back when the thread exits (the overflow slot isn't anyone's)
+        if (number != MAX_THREAD_SLOTS)
+        {
+            static thread_local Release release{ number };
+        }
+
+        return number;
+    }
+
+
+    // first report of a thread: kept out of the hot path, which is just the lookup in slot()
+    ThreadSlot& allocate_slot(size_t number)
+    {
+        std::lock_guard<std::mutex> lock(m_slot_mutex);
+
+        m_owned.emplace_back(new ThreadSlot(false));
+        m_slots[number].store(m_owned.back().get(), std::memory_order_release);
+
+        return *m_owned.back();
+    }
+
+
+    ThreadSlot& slot()
+    {
+        const auto number = thread_number();
+        auto* slot = m_slots[number].load(std::memory_order_acquire);
+
+        return slot != nullptr ? *slot : allocate_slot(number);
+    }
+
+
+    // the thread's batches: one per StaticChunk strategy type, and one for Chunk's, whatever
+    // source it last counted for
+    static Batch*& thread_batches()
+    {
+        static thread_local Batch* head = nullptr;
+
+        return head;
+    }
+
+
+    static Batch& chunk_batch()
+    {
+        static thread_local Batch batch = {};
+
+        return batch;
+    }
+
+
+    template <class Strategy>
+    static Batch& batch_of()
+    {
+        static thread_local Batch batch = {};
+
+        return batch;
+    }
+
+
+    static size_t decode_key(uint8_t status, bool intact)
+    {
+        return static_cast<size_t>(status & 7) << 1 | static_cast<size_t>(intact);
+    }
+
+
+    static void flush(Batch& batch)
+    {
+        auto& s = batch.source->slot();
+
+        for (size_t key = 0; key < BATCH_KEYS; ++key)
+        {
+            const auto n = batch.counts[key] - batch.flushed[key];
+
+            if (n == 0)
+                continue;
+
+            batch.flushed[key] = batch.counts[key];
+
+            if (key == ENCODE_KEY)
+                add(s.encoded, n, s.shared);
+            else
+                add(s.outcomes[classify_outcome((key & 1) != 0, static_cast<uint8_t>(key >> 1))], n, s.shared);
+        }
+    }
+
+
+    static void flush_thread()
+    {
+        for (auto* batch = thread_batches(); batch != nullptr; batch = batch->next)
+            if (batch->source != nullptr)
+                flush(*batch);
+    }
+
+
+    // a key's first event, and every BATCH_EVENTS after that
+    ECC_TELEMETRY_COLD static void batch_full(Batch& batch, TelemetrySource& source)
+    {
+        struct ExitFlush
+        {
+            ~ExitFlush()
+            {
+                flush_thread();
+            }
+        };
+
+        batch.source = &source;
+
+        if (!batch.linked)
+        {
+            // the slot first: thread locals are destroyed in reverse order, so the thread's
+            // number is only handed on after the exit flush has written to it
+            source.slot();
+
+            static thread_local ExitFlush exit_flush;
+
+            batch.linked = true;
+            batch.next = thread_batches();
+            thread_batches() = &batch;
+        }
+
+        flush(batch);
+    }
+
+
+    // Chunk's batch was counting for another source
+    ECC_TELEMETRY_COLD void switch_chunk_batch(Batch& batch)
+    {
+        if (batch.source != nullptr)
+            flush(batch);
+
+        batch.source = this;
+    }
+
+
+    // one increment and test per event
+    static bool counted_full(Batch& batch, size_t key)
+    {
+        return (++batch.counts[key] & (BATCH_EVENTS - 1)) == 1;
+    }
+
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t n, bool shared)
+    {
+        // the owning thread is the only writer, so no read-modify-write is needed
+        if (shared)
+            counter.fetch_add(n, std::memory_order_relaxed);
+        else
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+
+    static void record_latency(Histogram& histogram, uint64_t ps, bool shared)
+    {
+        add(histogram.buckets[LatencyHistogram::bucket_of(ps)], 1, shared);
+        add(histogram.count, 1, shared);
+        add(histogram.sum_ps, ps, shared);
+
+        auto max = histogram.max_ps.load(std::memory_order_relaxed);
+
+        while (ps > max && !histogram.max_ps.compare_exchange_weak(max, ps, std::memory_order_relaxed))
+        {
+        }
+    }
+
+
+    static void read(const Histogram& live, LatencyHistogram& out)
+    {
+        for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; ++b)
+            out.buckets[b] += live.buckets[b].load(std::memory_order_relaxed);
+
+        out.count += live.count.load(std::memory_order_relaxed);
+        out.sum_ps += live.sum_ps.load(std::memory_order_relaxed);
+        out.max_ps = std::max(out.max_ps, live.max_ps.load(std::memory_order_relaxed));
+    }
+
+
+public:
+    explicit TelemetrySource(const std::string& name) : m_name(name), m_overflow(new ThreadSlot(true))
+    {
+        for (auto& slot : m_slots)
+            slot.store(nullptr, std::memory_order_relaxed);
+
+        m_slots[MAX_THREAD_SLOTS].store(m_overflow.get(), std::memory_order_relaxed);
+    }
+
+    // sources outlive the threads that report to them; this only forgets the calling thread's
+    // batch (a short lived source of its own, say)
+    ~TelemetrySource()
+    {
+        for (auto* batch = thread_batches(); batch != nullptr; batch = batch->next)
+        {
+            if (batch->source == this)
+            {
+                batch->source = nullptr;
+                std::copy(std::begin(batch->counts), std::end(batch->counts), batch->flushed);
+            }
+        }
+    }
+
+    TelemetrySource(const TelemetrySource&) = delete;
+    TelemetrySource& operator=(const TelemetrySource&) = delete;
+
+
+    const std::string& name() const
+    {
+        return m_name;
+    }
+
+
+    // single codeword calls only count, in the thread's batch: even deciding whether to time
+    // them would cost a few percent of a call as short as a 64 bit Hsiao decode. A thread
+    // switching between sources flushes on every switch
+    void count_encode()
+    {
+        auto& batch = chunk_batch();
+
+        if (batch.source != this)
+            switch_chunk_batch(batch);
+
+        if (counted_full(batch, ENCODE_KEY))
+            batch_full(batch, *this);
+    }
+
+
+    // intact: the decoded data is what was written (see classify_outcome)
+    void count_decode(uint8_t status, bool intact)
+    {
+        auto& batch = chunk_batch();
+
+        if (batch.source != this)
+            switch_chunk_batch(batch);
+
+        if (counted_full(batch, status == DECODE_CLEAN && intact ? CLEAN_KEY : decode_key(status, intact)))
+            batch_full(batch, *this);
+    }
+
+
+    // the same, for a strategy type known at compile time (StaticChunk), with a batch per type
+    template <class Strategy>
+    static void count_encode_of()
+    {
+        auto& batch = batch_of<Strategy>();
+
+        if (counted_full(batch, ENCODE_KEY))
+            batch_full(batch, telemetry_of<Strategy>());
+    }
+
+
+    template <class Strategy>
+    static void count_decode_of(uint8_t status, bool intact)
+    {
+        auto& batch = batch_of<Strategy>();
+
+        if (counted_full(batch, status == DECODE_CLEAN && intact ? CLEAN_KEY : decode_key(status, intact)))
+            batch_full(batch, telemetry_of<Strategy>());
+    }
+
+
+    void record_encode(size_t count, const TelemetrySample& sample)
+    {
+        auto& s = slot();
+
+        add(s.encoded, count, s.shared);
+
+        if (sample.sampled())
+            record_latency(s.encode_latency, sample.elapsed_ns() * 1000 / std::max<size_t>(count, 1), s.shared);
+    }
+
+
+    // count words, outcome_counts of them with each DecodeOutcome
+    void record_decode(const uint64_t* outcome_counts, size_t count, const TelemetrySample& sample)
+    {
+        auto& s = slot();
+
+        for (size_t o = 0; o < OUTCOME_COUNT; ++o)
+            if (outcome_counts[o] != 0)
+                add(s.outcomes[o], outcome_counts[o], s.shared);
+
+        if (sample.sampled())
+            record_latency(s.decode_latency, sample.elapsed_ns() * 1000 / std::max<size_t>(count, 1), s.shared);
+    }
+
+    // a batch decode's statuses, with the data taken to be intact
+    void record_decode(const uint8_t* status, size_t count, const TelemetrySample& sample)
+    {
+        uint64_t counts[OUTCOME_COUNT] = {};
+
+        for (size_t i = 0; i < count; ++i)
+            ++counts[classify_outcome(true, status[i])];
+
+        record_decode(counts, count, sample);
+    }
+
+
+    // per-thread slots allocated so far (the overflow slot not counted)
+    size_t thread_slot_count() const
+    {
+        size_t n = 0;
+
+        for (size_t number = 0; number < MAX_THREAD_SLOTS; ++number)
+            n += m_slots[number].load(std::memory_order_acquire) != nullptr;
+
+        return n;
+    }
+
+
+    // sums the slots, after flushing the calling thread's batches. Concurrent reports may or
+    // may not be included, and other threads' batches aren't
+    StrategyTelemetry snapshot() const
+    {
+        StrategyTelemetry result;
+
+        flush_thread();
+
+        result.name = m_name;
+
+        for (const auto& slot : m_slots)
+        {
+            const auto* s = slot.load(std::memory_order_acquire);
+
+            if (s == nullptr)
+                continue;
+
+            for (size_t o = 0; o < OUTCOME_COUNT; ++o)
+                result.outcomes[o] += s->outcomes[o].load(std::memory_order_relaxed);
+
+            result.encoded += s->encoded.load(std::memory_order_relaxed);
+            read(s->encode_latency, result.encode_latency);
+            read(s->decode_latency, result.decode_latency);
+        }
+
+        return result;
+    }
+};
+
+
+// everything a snapshot of all sources looks like, plus the two export formats
+struct TelemetrySnapshot
+{
+    std::vector<StrategyTelemetry> strategies;
+
+
+    // Prometheus text exposition format. Histogram buckets are every power of 4 picoseconds
+    // from 256 ps to ~69 ms, which fall on bucket boundaries, so the cumulative counts are exact
+    std::string to_prometheus() const
+    {
+        std::ostringstream out;
+
+        out << "# HELP ecc_decoded_words_total Codewords decoded, by outcome (miscorrected / undetected need the original data).\n"
+            << "# TYPE ecc_decoded_words_total counter\n";
+
+        for (const auto& s : strategies)
+            for (size_t o = 0; o < OUTCOME_COUNT; ++o)
+                out << "ecc_decoded_words_total{strategy=\"" << escape(s.name) << "\",outcome=\"" << outcome_label(static_cast<DecodeOutcome>(o))
+                    << "\"} " << s.outcomes[o] << "\n";
+
+        out << "# HELP ecc_encoded_words_total Codewords encoded.\n"
+            << "# TYPE ecc_encoded_words_total counter\n";
+
+        for (const auto& s : strategies)
+            out << "ecc_encoded_words_total{strategy=\"" << escape(s.name) << "\"} " << s.encoded << "\n";
+
+        write_histogram(out, "ecc_encode_latency_seconds", "Sampled encode time per codeword.", &StrategyTelemetry::encode_latency);
+        write_histogram(out, "ecc_decode_latency_seconds", "Sampled decode time per codeword.", &StrategyTelemetry::decode_latency);
+
+        return out.str();
+    }
+
+
+    std::string to_json() const
+    {
+        std::ostringstream out;
+
+        out << "{\n  \"strategies\": [";
+
+        for (size_t i = 0; i < strategies.size(); ++i)
+        {
+            const auto& s = strategies[i];
+
+            out << (i == 0 ? "\n" : ",\n")
+                << "    { \"strategy\": \"" << escape(s.name) << "\", \"encoded\": " << s.encoded << ", \"decoded\": {";
+
+            for (size_t o = 0; o < OUTCOME_COUNT; ++o)
+                out << (o == 0 ? " " : ", ") << "\"" << outcome_label(static_cast<DecodeOutcome>(o)) << "\": " << s.outcomes[o];
+
+            out << " },\n      \"encode_latency_ns\": ";
+            write_latency_json(out, s.encode_latency);
+            out << ",\n      \"decode_latency_ns\": ";
+            write_latency_json(out, s.decode_latency);
+            out << " }";
+        }
+
+        out << "\n  ]\n}\n";
+
+        return out.str();
+    }
+
+
+private:
+    static std::string escape(const std::string& text)
+    {
+        std::string result;
+
+        for (auto c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+
+            if (c == '\n')
+                result += "\\n";
+            else
+                result += c;
+        }
+
+        return result;
+    }
+
+
+    static std::string seconds(uint64_t ps)
+    {
+        char buf[32];
+
+        snprintf(buf, sizeof(buf), "%.6g", static_cast<double>(ps) * 1e-12);
+        return buf;
+    }
+
+
+    void write_histogram(std::ostringstream& out, const char* metric, const char* help, LatencyHistogram StrategyTelemetry::* member) const
+    {
+        out << "# HELP " << metric << " " << help << "\n"
+            << "# TYPE " << metric << " histogram\n";
+
+        for (const auto& s : strategies)
+        {
+            const auto& histogram = s.*member;
+            const auto label = "strategy=\"" + escape(s.name) + "\"";
+
+            for (uint64_t bound = 256; bound <= (uint64_t(1) << 36); bound <<= 2)
+                out << metric << "_bucket{" << label << ",le=\"" << seconds(bound) << "\"} " << histogram.count_at_most(bound - 1) << "\n";
+
+            out << metric << "_bucket{" << label << ",le=\"+Inf\"} " << histogram.count << "\n"
+                << metric << "_sum{" << label << "} " << seconds(histogram.sum_ps) << "\n"
+                << metric << "_count{" << label << "} " << histogram.count << "\n";
+        }
+    }
+
+
+    static void write_latency_json(std::ostringstream& out, const LatencyHistogram& histogram)
+    {
+        char buf[160];
+
+        snprintf(buf, sizeof(buf), "{ \"samples\": %llu, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f }",
+                 static_cast<unsigned long long>(histogram.count), histogram.mean() / 1000.0,
+                 static_cast<double>(histogram.percentile(0.5)) / 1000.0, static_cast<double>(histogram.percentile(0.9)) / 1000.0,
+                 static_cast<double>(histogram.percentile(0.99)) / 1000.0, static_cast<double>(histogram.percentile(0.999)) / 1000.0,
+                 static_cast<double>(histogram.max_ps) / 1000.0);
+        out << buf;
+    }
+};
+
+
+/*
+ * One TelemetrySource per strategy type, created on first use and kept for the life of the
+ * process, so references to them stay valid
+ */
+class TelemetryRegistry
+{
+    std::mutex m_mutex;
+    std::map<std::type_index, std::unique_ptr<TelemetrySource>> m_sources;
+
+
+    // readable type name: demangled where the ABI allows, without integer literal suffixes
+    // ("HammingCode<64ul>" -> "HammingCode<64>") or MSVC's "class " prefixes
+    static std::string type_name(const std::type_info& type)
+    {
+        std::string name = type.name();
+
+#if defined(__GNUG__)
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+
+        if (status == 0 && demangled != nullptr)
+            name = demangled;
+
+        free(demangled);
+#endif
+
+        std::string result;
+
+        for (size_t i = 0; i < name.size(); ++i)
+        {
+            if (name.compare(i, 6, "class ") == 0)
+                i += 6;
+            else if (name.compare(i, 7, "struct ") == 0)
+                i += 7;
+
+            if (i >= name.size())
+                break;
+
+            result += name[i];
+
+            if (!isdigit(static_cast<unsigned char>(name[i])))
+                continue;
+
+            // a suffix ends the literal; digits followed by letters are part of an identifier
+            auto end = i + 1;
+
+            while (end < name.size() && strchr("uUlL", name[end]) != nullptr)
+                ++end;
+
+            if (end > i + 1 && (end == name.size() || !(isalnum(static_cast<unsigned char>(name[end])) || name[end] == '_')))
+                i = end - 1;
+        }
+
+        return result;
+    }
+
+
+public:
+    static TelemetryRegistry& instance()
+    {
+        static TelemetryRegistry registry;
+
+        return registry;
+    }
+
+
+    TelemetrySource& source(const std::type_info& type)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& source = m_sources[std::type_index(type)];
+
+        if (!source)
+            source.reset(new TelemetrySource(type_name(type)));
+
+        return *source;
+    }
+
+
+    // sources in name order
+    TelemetrySnapshot snapshot()
+    {
+        TelemetrySnapshot result;
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (const auto& source : m_sources)
+            result.strategies.push_back(source.second->snapshot());
+
+        std::sort(result.strategies.begin(), result.strategies.end(), [](const StrategyTelemetry& a, const StrategyTelemetry& b)
+        {
+            return a.name < b.name;
+        });
+
+        return result;
+    }
+};
+
+
+// the source for a strategy type known at compile time
+template <class Strategy>
+TelemetrySource& telemetry_of()
+{
+    static TelemetrySource& source = TelemetryRegistry::instance().source(typeid(Strategy));
+
+    return source;
+}
+
+
+// what every strategy has reported so far; empty when telemetry is compiled out
+inline TelemetrySnapshot telemetry_snapshot()
+{
+    return TelemetryRegistry::instance().snapshot();
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end EccTelemetry.h
+ *///////////////////////////////////////////////////////////////////////////*/
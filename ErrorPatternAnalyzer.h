@@ -0,0 +1,335 @@
+/*-----------------------------------------------------------------------------
+ * ErrorPatternAnalyzer.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "PackedWords.h"
+#include "DecodeResult.h"
+#include "FaultInjection.h"
+#include "ThreadPool.h"
+
+
+// outcome counts over every error pattern of one weight
+struct ErrorWeightRow
+{
+    size_t weight;
+    uint64_t patterns;
+    uint64_t outcomes[OUTCOME_COUNT];   // indexed by DecodeOutcome
+};
+
+
+struct ErrorPatternReport
+{
+    std::vector<ErrorWeightRow> rows;       // error weight 1..max_weight
+
+    // codeword weight distribution A_0..A_n (n = encoded bits), when there are few enough
+    // data words to encode all of them; empty otherwise
+    std::vector<uint64_t> codeword_weights;
+    size_t minimum_distance;                // 0 when codeword_weights is empty
+
+    uint64_t data_words_checked;            // data words every pattern was decoded with
+    uint64_t linearity_violations;          // (pattern, data word) pairs that decoded differently than with zero data
+};
+
+
+/*
+ * Exact outcome tables for small codes: every error pattern of weight 1..max_weight is applied
+ * and decoded, and the outcome classified (see DecodeOutcome).
+ *
+ * The codes here are linear and decode from the syndrome, which depends on the error pattern
+ * alone, so the outcome of a pattern is the same whatever data it hits. Each pattern is
+ * therefore decoded against the all zero data word only, and patterns are enumerated as
+ * position sets i < j < l rather than ordered tuples: C(72, 3) = 59640 decodes cover every
+ * 3 bit error of a 64 bit SEC-DED code over all 2^64 data words. That assumption is checked
+ * rather than trusted: every pattern is also decoded against every other data word when there
+ * are at most 2^EXHAUSTIVE_DATA_BITS of them, else against SAMPLED_DATA_WORDS random ones, and
+ * any difference is counted as a linearity violation.
+ *
+ * Work is split per (weight, lowest error bit) and spread over a ThreadPool
+ */
+template <class Strategy>
+class ErrorPatternAnalyzer
+{
+public:
+    static constexpr size_t NumDataBits = Strategy::NUM_DATA_BITS;
+    static constexpr size_t NumEncodedBits = Strategy::NUM_ENCODED_BITS;
+
+    static constexpr size_t MAX_WEIGHT = 3;
+    static constexpr size_t EXHAUSTIVE_DATA_BITS = 12;
+    static constexpr size_t SAMPLED_DATA_WORDS = 4;
+    static constexpr size_t WEIGHT_DISTRIBUTION_DATA_BITS = 20;
+    static constexpr size_t BATCH = 256;
+
+
+private:
+    static constexpr size_t DW = Strategy::DATA_WORD_COUNT;
+    static constexpr size_t SW = Strategy::STORED_WORD_COUNT;
+
+    ThreadPool& m_pool;
+    Strategy m_strategy;
+
+
+    // data words the patterns are decoded against, the zero word first, plus their codewords
+    void make_data_words(std::vector<uint64_t>& data, std::vector<uint64_t>& encoded) const
+    {
+        size_t count;
+
+        if constexpr (NumDataBits <= EXHAUSTIVE_DATA_BITS)
+        {
+            count = size_t(1) << NumDataBits;
+            data.assign(count * DW, 0);
+
+            for (size_t d = 0; d < count; ++d)
+                data[d * DW] = d;
+        } else
+        {
+            Xoshiro256 rng(NumDataBits);
+
+            count = 1 + SAMPLED_DATA_WORDS;
+            data.assign(count * DW, 0);
+
+            for (size_t i = DW; i < count * DW; ++i)
+                data[i] = rng.next();
+
+            for (size_t d = 0; d < count; ++d)
+                data[d * DW + DW - 1] &= Strategy::LAST_DATA_WORD_MASK;
+        }
+
+        encoded.resize(count * SW);
+        m_strategy.Strategy::encode_batch(data.data(), count, encoded.data());
+    }
+
+
+    // patterns of the given weight whose lowest bit is first, as positions
+    static void make_patterns(size_t weight, size_t first, std::vector<size_t>& patterns)
+    {
+        patterns.clear();
+
+        if (weight == 1)
+        {
+            patterns.push_back(first);
+            return;
+        }
+
+        for (size_t j = first + 1; j < NumEncodedBits; ++j)
+        {
+            if (weight == 2)
+            {
+                patterns.push_back(first);
+                patterns.push_back(j);
+                continue;
+            }
+
+            for (size_t l = j + 1; l < NumEncodedBits; ++l)
+            {
+                patterns.push_back(first);
+                patterns.push_back(j);
+                patterns.push_back(l);
+            }
+        }
+    }
+
+
+    // decodes patterns (weight positions each) against every data word; counts outcomes for the
+    // zero data word and differences from it for the rest
+    void analyze_patterns(size_t weight, const std::vector<size_t>& patterns,
+                          const std::vector<uint64_t>& data, const std::vector<uint64_t>& data_encoded,
+                          uint64_t* outcomes, uint64_t& violations) const
+    {
+        const auto num_patterns = patterns.size() / weight;
+        const auto num_data = data.size() / DW;
+
+        uint64_t encoded[BATCH * SW];
+        uint64_t decoded[BATCH * DW];
+        uint64_t zero_decoded[BATCH * DW];
+        uint8_t status[BATCH];
+        uint8_t zero_status[BATCH];
+
+        for (size_t first = 0; first < num_patterns; first += BATCH)
+        {
+            const auto count = std::min(BATCH, num_patterns - first);
+
+            for (size_t d = 0; d < num_data; ++d)
+            {
+                for (size_t b = 0; b < count; ++b)
+                {
+                    std::copy(&data_encoded[d * SW], &data_encoded[d * SW] + SW, encoded + b * SW);
+
+                    for (size_t e = 0; e < weight; ++e)
+                        flip_word_bit(encoded + b * SW, patterns[(first + b) * weight + e]);
+                }
+
+                const auto out = d == 0 ? zero_decoded : decoded;
+                const auto out_status = d == 0 ? zero_status : status;
+
+                m_strategy.Strategy::decode_batch(encoded, count, out, out_status);
+
+                for (size_t b = 0; b < count; ++b)
+                {
+                    if (d == 0)
+                    {
+                        bool intact = true;
+
+                        for (size_t w = 0; w < DW; ++w)
+                            intact = intact && zero_decoded[b * DW + w] == 0;
+
+                        ++outcomes[classify_outcome(intact, zero_status[b])];
+                        continue;
+                    }
+
+                    // a linear decode comes out as data ^ (what it made of the zero word)
+                    bool same = status[b] == zero_status[b];
+
+                    for (size_t w = 0; w < DW; ++w)
+                        same = same && (decoded[b * DW + w] ^ data[d * DW + w]) == zero_decoded[b * DW + w];
+
+                    if (!same)
+                        ++violations;
+                }
+            }
+        }
+    }
+
+
+    // A_w over all 2^NumDataBits codewords
+    std::vector<uint64_t> codeword_weights() const
+    {
+        constexpr size_t BLOCK = 4096;
+
+        const auto num_words = uint64_t(1) << NumDataBits;
+        const auto blocks = static_cast<size_t>((num_words + BLOCK - 1) / BLOCK);
+
+        std::unique_ptr<std::atomic<uint64_t>[]> totals(new std::atomic<uint64_t>[NumEncodedBits + 1]);
+
+        for (size_t w = 0; w <= NumEncodedBits; ++w)
+            totals[w].store(0);
+
+        m_pool.parallel_for(blocks, [&](size_t block)
+        {
+            uint64_t data[BATCH * DW] = {};
+            uint64_t encoded[BATCH * SW];
+            uint64_t counts[NumEncodedBits + 1] = {};
+
+            const auto end = std::min<uint64_t>(num_words, (block + 1) * uint64_t(BLOCK));
+
+            for (auto d = block * uint64_t(BLOCK); d < end; d += BATCH)
+            {
+                const auto count = static_cast<size_t>(std::min<uint64_t>(BATCH, end - d));
+
+                for (size_t b = 0; b < count; ++b)
+                    data[b * DW] = d + b;
+
+                m_strategy.Strategy::encode_batch(data, count, encoded);
+
+                for (size_t b = 0; b < count; ++b)
+                {
+                    size_t weight = 0;
+
+                    for (size_t w = 0; w < SW; ++w)
+                        weight += popcount64(encoded[b * SW + w]);
+
+                    ++counts[weight];
+                }
+            }
+
+            for (size_t w = 0; w <= NumEncodedBits; ++w)
+                if (counts[w] != 0)
+                    totals[w].fetch_add(counts[w], std::memory_order_relaxed);
+        });
+
+        std::vector<uint64_t> weights(NumEncodedBits + 1);
+
+        for (size_t w = 0; w <= NumEncodedBits; ++w)
+            weights[w] = totals[w].load();
+
+        return weights;
+    }
+
+
+public:
+    explicit ErrorPatternAnalyzer(ThreadPool& pool, const Strategy& strategy = Strategy())
+        : m_pool(pool), m_strategy(strategy)
+    {
+    }
+
+
+    ErrorPatternReport analyze(size_t max_weight = MAX_WEIGHT) const
+    {
+        ErrorPatternReport report = {};
+
+        max_weight = std::min({ max_weight, MAX_WEIGHT, NumEncodedBits });
+
+        std::vector<uint64_t> data;
+        std::vector<uint64_t> data_encoded;
+
+        make_data_words(data, data_encoded);
+
+        std::unique_ptr<std::atomic<uint64_t>[]> totals(new std::atomic<uint64_t>[max_weight * OUTCOME_COUNT]);
+        std::atomic<uint64_t> violations(0);
+
+        for (size_t i = 0; i < max_weight * OUTCOME_COUNT; ++i)
+            totals[i].store(0);
+
+        // one task per (weight, lowest error bit); low first bits carry the most patterns, and
+        // parallel_for hands tasks out dynamically, so that evens out
+        m_pool.parallel_for(max_weight * NumEncodedBits, [&](size_t task)
+        {
+            const auto weight = task / NumEncodedBits + 1;
+            const auto first = task % NumEncodedBits;
+
+            std::vector<size_t> patterns;
+            uint64_t outcomes[OUTCOME_COUNT] = {};
+            uint64_t task_violations = 0;
+
+            make_patterns(weight, first, patterns);
+            analyze_patterns(weight, patterns, data, data_encoded, outcomes, task_violations);
+
+            for (size_t o = 0; o < OUTCOME_COUNT; ++o)
+                totals[(weight - 1) * OUTCOME_COUNT + o].fetch_add(outcomes[o], std::memory_order_relaxed);
+
+            violations.fetch_add(task_violations, std::memory_order_relaxed);
+        });
+
+        for (size_t w = 1; w <= max_weight; ++w)
+        {
+            ErrorWeightRow row = {};
+
+            row.weight = w;
+
+            for (size_t o = 0; o < OUTCOME_COUNT; ++o)
+            {
+                row.outcomes[o] = totals[(w - 1) * OUTCOME_COUNT + o].load();
+                row.patterns += row.outcomes[o];
+            }
+
+            report.rows.push_back(row);
+        }
+
+        report.data_words_checked = data.size() / DW;
+        report.linearity_violations = violations.load();
+
+        if constexpr (NumDataBits <= WEIGHT_DISTRIBUTION_DATA_BITS)
+        {
+            report.codeword_weights = codeword_weights();
+
+            for (size_t w = 1; w <= NumEncodedBits; ++w)
+            {
+                if (report.codeword_weights[w] != 0)
+                {
+                    report.minimum_distance = w;
+                    break;
+                }
+            }
+        }
+
+        return report;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end ErrorPatternAnalyzer.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,455 @@
+/*-----------------------------------------------------------------------------
+ * FaultInjection.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "PackedWords.h"
+#include "DecodeResult.h"
+#include "ThreadPool.h"
+
+
+/*
+ * xoshiro256** (Blackman & Vigna), seeded through splitmix64. Small and fast enough to draw
+ * a few numbers per trial without showing up next to the encode/decode
+ */
+class Xoshiro256
+{
+    uint64_t m_s[4];
+
+
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+
+public:
+    static uint64_t splitmix64(uint64_t& x)
+    {
+        auto z = (x += 0x9E3779B97F4A7C15ull);
+
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+        return z ^ (z >> 31);
+    }
+
+
+    explicit Xoshiro256(uint64_t seed)
+    {
+        for (auto& s : m_s)
+            s = splitmix64(seed);
+    }
+
+
+    uint64_t next()
+    {
+        const auto result = rotl(m_s[1] * 5, 7) * 9;
+        const auto t = m_s[1] << 17;
+
+        m_s[2] ^= m_s[0];
+        m_s[3] ^= m_s[1];
+        m_s[1] ^= m_s[2];
+        m_s[0] ^= m_s[3];
+        m_s[2] ^= t;
+        m_s[3] = rotl(m_s[3], 45);
+
+        return result;
+    }
+
+
+    // uniform in [0, n), n < 2^32 (multiply-shift; the bias is far below anything measurable here)
+    size_t below(size_t n)
+    {
+        return static_cast<size_t>(((next() >> 32) * n) >> 32);
+    }
+};
+
+
+// picks k distinct values in [0, n) into out (k <= n, k small)
+inline void pick_distinct(Xoshiro256& rng, size_t n, size_t k, size_t* out)
+{
+    for (size_t i = 0; i < k; ++i)
+    {
+        size_t v;
+
+        do
+        {
+            v = rng.below(n);
+        } while (std::find(out, out + i, v) != out + i);
+
+        out[i] = v;
+    }
+}
+
+
+/*
+ * Error models. Each has per site probability p of an event, so a codeword of num_bits bits
+ * sees K ~ Binomial(sites(num_bits), p) events, and inject() applies exactly k events to a
+ * codeword. Conditioning on K lets the injector sample rare multi-event cases directly rather
+ * than waiting for them to come up at their natural rate
+ */
+
+// every bit flips independently with probability p
+struct BitFlipModel
+{
+    double p;
+
+    explicit BitFlipModel(double p) : p(p)
+    {
+    }
+
+    static const char* name()
+    {
+        return "bit flip";
+    }
+
+    size_t sites(size_t num_bits) const
+    {
+        return num_bits;
+    }
+
+    void inject(uint64_t* codeword, size_t num_bits, size_t k, Xoshiro256& rng) const
+    {
+        size_t positions[64];
+
+        pick_distinct(rng, num_bits, k, positions);
+
+        for (size_t i = 0; i < k; ++i)
+            flip_word_bit(codeword, positions[i]);
+    }
+};
+
+
+// a burst starts at each bit with probability p. It flips its first and last bit, and each
+// bit in between with probability 1/2
+struct BurstModel
+{
+    double p;
+    size_t length;
+
+    BurstModel(double p, size_t length) : p(p), length(length)
+    {
+    }
+
+    static const char* name()
+    {
+        return "burst";
+    }
+
+    size_t sites(size_t num_bits) const
+    {
+        return length >= num_bits ? 1 : num_bits - length + 1;
+    }
+
+    void inject(uint64_t* codeword, size_t num_bits, size_t k, Xoshiro256& rng) const
+    {
+        const auto len = std::min(length, num_bits);
+        size_t starts[64];
+
+        pick_distinct(rng, sites(num_bits), k, starts);
+
+        for (size_t i = 0; i < k; ++i)
+        {
+            flip_word_bit(codeword, starts[i]);
+
+            if (len > 1)
+                flip_word_bit(codeword, starts[i] + len - 1);
+
+            for (size_t j = 1; j + 1 < len; ++j)
+                if (rng.next() >> 63)
+                    flip_word_bit(codeword, starts[i] + j);
+        }
+    }
+};
+
+
+// each aligned symbol of symbol_bits bits (one DRAM device's share of the codeword) fails with
+// probability p. A failed device reads back garbage: its bits get a random non-zero error pattern
+struct DeviceFailureModel
+{
+    double p;
+    size_t symbol_bits;
+
+    DeviceFailureModel(double p, size_t symbol_bits) : p(p), symbol_bits(symbol_bits)
+    {
+    }
+
+    static const char* name()
+    {
+        return "device";
+    }
+
+    size_t sites(size_t num_bits) const
+    {
+        return num_bits / symbol_bits;
+    }
+
+    void inject(uint64_t* codeword, size_t num_bits, size_t k, Xoshiro256& rng) const
+    {
+        const auto pattern_mask = low_bits_mask(symbol_bits);
+        size_t symbols[64];
+
+        pick_distinct(rng, sites(num_bits), k, symbols);
+
+        for (size_t i = 0; i < k; ++i)
+        {
+            uint64_t pattern;
+
+            do
+            {
+                pattern = rng.next() & pattern_mask;
+            } while (pattern == 0);
+
+            for (size_t b = 0; b < symbol_bits; ++b)
+                if ((pattern >> b) & 1)
+                    flip_word_bit(codeword, symbols[i] * symbol_bits + b);
+        }
+    }
+};
+
+
+// each bit is stuck at value with probability p. Only shows up as an error where the stored
+// bit differs, so unlike the other models the outcome depends on the data
+struct StuckAtModel
+{
+    double p;
+    bool value;
+
+    StuckAtModel(double p, bool value) : p(p), value(value)
+    {
+    }
+
+    static const char* name()
+    {
+        return "stuck-at";
+    }
+
+    size_t sites(size_t num_bits) const
+    {
+        return num_bits;
+    }
+
+    void inject(uint64_t* codeword, size_t num_bits, size_t k, Xoshiro256& rng) const
+    {
+        size_t positions[64];
+
+        pick_distinct(rng, num_bits, k, positions);
+
+        for (size_t i = 0; i < k; ++i)
+            assign_word_bit(codeword, positions[i], value);
+    }
+};
+
+
+// trials run with exactly `events` events per codeword
+struct FaultInjectionStratum
+{
+    size_t events;
+    double probability;     // P(K = events) under the model
+    uint64_t trials;
+    uint64_t clean;         // data intact, nothing reported (e.g. stuck at the stored value)
+    uint64_t corrected;     // data intact, error reported and corrected
+    uint64_t detected;      // reported uncorrectable
+    uint64_t miscorrected;  // data wrong, but reported as corrected
+    uint64_t undetected;    // data wrong, nothing reported
+};
+
+
+/*
+ * Per codeword rates, combined over strata: rate = sum over k of P(K = k) * (fraction of the
+ * trials with k events that ended that way). Residual = miscorrected + undetected, i.e.
+ * silently wrong data
+ */
+struct FaultInjectionResult
+{
+    uint64_t trials;
+    double corrected_rate;
+    double detected_rate;
+    double miscorrection_rate;
+    double undetected_rate;
+    double residual_rate;
+    double residual_std_error;
+    double detected_std_error;
+    double unsampled_probability;   // P(K > max_events): outcomes not covered by the rates above
+    std::vector<FaultInjectionStratum> strata;
+};
+
+
+// P(X = k) for X ~ Binomial(n, p)
+inline double binomial_probability(size_t n, size_t k, double p)
+{
+    if (k > n)
+        return 0.0;
+
+    if (p <= 0.0)
+        return k == 0 ? 1.0 : 0.0;
+
+    if (p >= 1.0)
+        return k == n ? 1.0 : 0.0;
+
+    return std::exp(std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0)
+        + k * std::log(p) + (n - k) * std::log1p(-p));
+}
+
+
+/*
+ * Monte Carlo fault injection for one Strategy. For every event count k = 1..max_events it
+ * encodes random data, applies k events of the error model and classifies the decode, then
+ * weighs each k by its probability under the model. Rates far below 1 / trials (down to 1e-12
+ * and beyond) come out of modest trial counts that way, since only the conditional failure
+ * rates have to be sampled.
+ *
+ * Trials run in blocks of BATCH codewords through the strategy's batch kernels, spread over a
+ * ThreadPool with work stealing. Every block seeds its own generator from (seed, k, block), so
+ * results depend on the seed only, not on the thread count or scheduling. Counts are summed
+ * per block and added to shared atomics once per block
+ */
+template <class Strategy>
+class FaultInjector
+{
+public:
+    static constexpr size_t NumDataBits = Strategy::NUM_DATA_BITS;
+    static constexpr size_t NumEncodedBits = Strategy::NUM_ENCODED_BITS;
+    static constexpr size_t BATCH = 256;
+
+
+private:
+    ThreadPool& m_pool;
+    uint64_t m_seed;
+    Strategy m_strategy;
+
+
+    static bool data_intact(const uint64_t* original, const uint64_t* decoded)
+    {
+        uint64_t diff = 0;
+
+        for (size_t i = 0; i < Strategy::DATA_WORD_COUNT; ++i)
+            diff |= (original[i] ^ decoded[i]) & (i + 1 == Strategy::DATA_WORD_COUNT ? Strategy::LAST_DATA_WORD_MASK : ~uint64_t(0));
+
+        return diff == 0;
+    }
+
+
+    template <class ErrorModel>
+    void run_block(const ErrorModel& model, size_t events, uint64_t block, size_t count, std::atomic<uint64_t>* totals) const
+    {
+        constexpr auto DW = Strategy::DATA_WORD_COUNT;
+        constexpr auto SW = Strategy::STORED_WORD_COUNT;
+
+        // zeroed so every word read is visibly initialized: only count * DW of them are filled
+        uint64_t data[BATCH * DW] = {};
+        uint64_t encoded[BATCH * SW];
+        uint64_t decoded[BATCH * DW];
+        uint8_t status[BATCH];
+        uint64_t counts[OUTCOME_COUNT] = {};
+
+        auto seed = m_seed ^ (static_cast<uint64_t>(events) << 56);
+        Xoshiro256 rng(Xoshiro256::splitmix64(seed) ^ block);
+
+        for (size_t i = 0; i < count * DW; ++i)
+            data[i] = rng.next();
+
+        for (size_t i = 0; i < count; ++i)
+            data[i * DW + DW - 1] &= Strategy::LAST_DATA_WORD_MASK;
+
+        m_strategy.Strategy::encode_batch(data, count, encoded);
+
+        for (size_t i = 0; i < count; ++i)
+            model.inject(encoded + i * SW, NumEncodedBits, events, rng);
+
+        m_strategy.Strategy::decode_batch(encoded, count, decoded, status);
+
+        for (size_t i = 0; i < count; ++i)
+            ++counts[classify_outcome(data_intact(data + i * DW, decoded + i * DW), status[i])];
+
+        for (size_t i = 0; i < OUTCOME_COUNT; ++i)
+            if (counts[i] != 0)
+                totals[i].fetch_add(counts[i], std::memory_order_relaxed);
+    }
+
+
+public:
+    explicit FaultInjector(ThreadPool& pool, uint64_t seed = 440, const Strategy& strategy = Strategy())
+        : m_pool(pool), m_seed(seed), m_strategy(strategy)
+    {
+    }
+
+
+    template <class ErrorModel>
+    FaultInjectionResult run(const ErrorModel& model, uint64_t trials_per_stratum, size_t max_events = 4) const
+    {
+        FaultInjectionResult result = {};
+        const auto sites = model.sites(NumEncodedBits);
+
+        // inject() works on at most 64 events
+        max_events = std::min<size_t>({ max_events, sites, 64 });
+
+        double residual_variance = 0.0;
+        double detected_variance = 0.0;
+
+        for (size_t k = 1; k <= max_events; ++k)
+        {
+            const auto probability = binomial_probability(sites, k, model.p);
+            std::atomic<uint64_t> totals[OUTCOME_COUNT];
+
+            for (auto& t : totals)
+                t.store(0);
+
+            const auto blocks = (trials_per_stratum + BATCH - 1) / BATCH;
+
+            m_pool.parallel_for_stealing(static_cast<size_t>(blocks), [&](size_t block)
+            {
+                const auto count = std::min<uint64_t>(BATCH, trials_per_stratum - block * BATCH);
+
+                run_block(model, k, block, static_cast<size_t>(count), totals);
+            });
+
+            FaultInjectionStratum stratum;
+
+            stratum.events = k;
+            stratum.probability = probability;
+            stratum.trials = trials_per_stratum;
+            stratum.clean = totals[OUTCOME_CLEAN];
+            stratum.corrected = totals[OUTCOME_CORRECTED];
+            stratum.detected = totals[OUTCOME_DETECTED];
+            stratum.miscorrected = totals[OUTCOME_MISCORRECTED];
+            stratum.undetected = totals[OUTCOME_UNDETECTED];
+            result.strata.push_back(stratum);
+
+            if (trials_per_stratum == 0)
+                continue;
+
+            const auto n = static_cast<double>(trials_per_stratum);
+            const auto residual = (stratum.miscorrected + stratum.undetected) / n;
+            const auto detected = stratum.detected / n;
+
+            result.trials += trials_per_stratum;
+            result.corrected_rate += probability * stratum.corrected / n;
+            result.detected_rate += probability * detected;
+            result.miscorrection_rate += probability * stratum.miscorrected / n;
+            result.undetected_rate += probability * stratum.undetected / n;
+
+            residual_variance += probability * probability * residual * (1.0 - residual) / n;
+            detected_variance += probability * probability * detected * (1.0 - detected) / n;
+        }
+
+        result.residual_rate = result.miscorrection_rate + result.undetected_rate;
+        result.residual_std_error = std::sqrt(residual_variance);
+        result.detected_std_error = std::sqrt(detected_variance);
+
+        // summed term by term; 1 - P(K <= max_events) would cancel to nothing at small p
+        for (auto k = max_events + 1; k <= sites; ++k)
+            result.unsampled_probability += binomial_probability(sites, k, model.p);
+
+        return result;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end FaultInjection.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,374 @@
+/*-----------------------------------------------------------------------------
+ * GaloisField.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CpuFeatures.h"
+
+
+// carry-less multiply modulo poly, bit by bit. Only used to build tables at compile time
+constexpr uint8_t gf256_mul_slow(uint8_t a, uint8_t b, uint16_t poly)
+{
+    uint16_t x = a;
+    uint8_t product = 0;
+
+    for (; b != 0; b >>= 1)
+    {
+        if (b & 1)
+            product ^= static_cast<uint8_t>(x);
+
+        x <<= 1;
+
+        if (x & 0x100)
+            x ^= poly;
+    }
+
+    return product;
+}
+
+
+// alpha^i for i in [0, 510): doubled, so the sum of two logs indexes it without a modulo
+constexpr std::array<uint8_t, 510> make_gf256_exp(uint16_t poly)
+{
+    std::array<uint8_t, 510> table{};
+    uint8_t x = 1;
+
+    for (size_t i = 0; i < 255; ++i)
+    {
+        table[i] = x;
+        table[i + 255] = x;
+        x = gf256_mul_slow(x, 2, poly);
+    }
+
+    return table;
+}
+
+
+// log_alpha(x) for x != 0; entry 0 is unused
+constexpr std::array<uint8_t, 256> make_gf256_log(uint16_t poly)
+{
+    const auto exp = make_gf256_exp(poly);
+    std::array<uint8_t, 256> table{};
+
+    for (size_t i = 0; i < 255; ++i)
+        table[exp[i]] = static_cast<uint8_t>(i);
+
+    return table;
+}
+
+
+/*
+ * GF(2^8) with the primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D) and alpha = 2, the
+ * field most Reed-Solomon codes (CD, DVD, RAID-6, ...) use. Addition is XOR; single products go
+ * through log/antilog tables, repeated products by one constant through a row of a full product
+ * table.
+ *
+ * Buffers are multiplied by a constant with split nibble tables: c * x = lo[x & 15] ^ hi[x >> 4],
+ * two 16 entry tables per constant. Those fit a byte shuffle register, so with SSSE3 / AVX2 one
+ * shuffle pair multiplies 16 / 32 bytes at once. Without them the same tables are looked up a
+ * byte at a time
+ */
+class GF256
+{
+public:
+    static constexpr uint16_t PRIMITIVE_POLY = 0x11D;
+    static constexpr size_t ORDER = 255;               // multiplicative group
+
+    static constexpr auto EXP = make_gf256_exp(PRIMITIVE_POLY);
+    static constexpr auto LOG = make_gf256_log(PRIMITIVE_POLY);
+
+
+    struct NibbleTable
+    {
+        alignas(16) uint8_t lo[16];     // c * x for x = 0..15
+        alignas(16) uint8_t hi[16];     // c * (x << 4) for x = 0..15
+    };
+
+
+    static uint8_t mul(uint8_t a, uint8_t b)
+    {
+        return a == 0 || b == 0 ? 0 : EXP[LOG[a] + LOG[b]];
+    }
+
+
+    // b != 0
+    static uint8_t div(uint8_t a, uint8_t b)
+    {
+        return a == 0 ? 0 : EXP[LOG[a] + ORDER - LOG[b]];
+    }
+
+
+    // a != 0
+    static uint8_t inv(uint8_t a)
+    {
+        return EXP[ORDER - LOG[a]];
+    }
+
+
+    // alpha^power, for any power
+    static uint8_t exp(size_t power)
+    {
+        return EXP[power % ORDER];
+    }
+
+
+    static uint8_t pow(uint8_t a, size_t n)
+    {
+        if (n == 0)
+            return 1;
+
+        return a == 0 ? 0 : EXP[(LOG[a] * n) % ORDER];
+    }
+
+
+    // c * x for every x: row c of the full 64 KiB product table, built on first use. For scalar
+    // loops that multiply by the same c many times, one lookup per product
+    static const uint8_t* mul_row(uint8_t c)
+    {
+        static const std::unique_ptr<uint8_t[]> table = []
+        {
+            std::unique_ptr<uint8_t[]> t(new uint8_t[256 * 256]);
+
+            for (size_t a = 0; a < 256; ++a)
+                for (size_t b = 0; b < 256; ++b)
+                    t[a * 256 + b] = mul(static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+
+            return t;
+        }();
+
+        return &table[c * size_t(256)];
+    }
+
+
+    static NibbleTable nibble_table(uint8_t c)
+    {
+        NibbleTable table;
+
+        for (uint8_t x = 0; x < 16; ++x)
+        {
+            table.lo[x] = mul(c, x);
+            table.hi[x] = mul(c, static_cast<uint8_t>(x << 4));
+        }
+
+        return table;
+    }
+
+
+    // dst[i] = c * src[i] (dst may be src)
+    static void mul_region(uint8_t c, const uint8_t* src, uint8_t* dst, size_t length)
+    {
+        region<false>(nibble_table(c), src, nullptr, dst, length);
+    }
+
+
+    // dst[i] ^= c * src[i]
+    static void mul_add_region(uint8_t c, const uint8_t* src, uint8_t* dst, size_t length)
+    {
+        if (c != 0)
+            region<true>(nibble_table(c), src, dst, dst, length);
+    }
+
+
+    // the kernel: dst[i] = c * src[i], ^ add[i] if Add. Takes the table, so callers that use the
+    // same constants over and over can build them once. dst may be src or add
+    template <bool Add>
+    static void region(const NibbleTable& table, const uint8_t* src, const uint8_t* add, uint8_t* dst, size_t length)
+    {
+        size_t i = 0;
+
+#if ECC_X86_64
+        if (cpu_has_avx2())
+            i = region_avx2<Add>(table, src, add, dst, length);
+
+        if (cpu_has_ssse3())
+            i = region_ssse3<Add>(table, src, add, dst, i, length);
+#endif
+
+        for (; i < length; ++i)
+        {
+            const auto product = static_cast<uint8_t>(table.lo[src[i] & 15] ^ table.hi[src[i] >> 4]);
+
+            dst[i] = Add ? static_cast<uint8_t>(product ^ add[i]) : product;
+        }
+    }
+
+
+#if ECC_X86_64
+    // region() 32 bytes at a time, as far as that goes; returns where it stopped
+    template <bool Add>
+    static ECC_TARGET("avx2") size_t region_avx2(const NibbleTable& table, const uint8_t* src, const uint8_t* add, uint8_t* dst, size_t length)
+    {
+        const auto lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table.lo)));
+        const auto hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table.hi)));
+        const auto nibble = _mm256_set1_epi8(0x0F);
+        size_t i = 0;
+
+        for (; i + 32 <= length; i += 32)
+        {
+            const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            auto product = _mm256_xor_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(x, nibble)),
+                                            _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(x, 4), nibble)));
+
+            if constexpr (Add)
+                product = _mm256_xor_si256(product, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(add + i)));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), product);
+        }
+
+        return i;
+    }
+
+
+    // region() 16 bytes at a time from i on
+    template <bool Add>
+    static ECC_TARGET("ssse3") size_t region_ssse3(const NibbleTable& table, const uint8_t* src, const uint8_t* add, uint8_t* dst, size_t i, size_t length)
+    {
+        const auto lo = _mm_load_si128(reinterpret_cast<const __m128i*>(table.lo));
+        const auto hi = _mm_load_si128(reinterpret_cast<const __m128i*>(table.hi));
+        const auto nibble = _mm_set1_epi8(0x0F);
+
+        for (; i + 16 <= length; i += 16)
+        {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            auto product = _mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(x, nibble)),
+                                         _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(x, 4), nibble)));
+
+            if constexpr (Add)
+                product = _mm_xor_si128(product, _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i)));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), product);
+        }
+
+        return i;
+    }
+#endif
+};
+
+
+// a primitive polynomial of degree m, for m = 2..16 (bit i = coefficient of x^i)
+constexpr uint32_t gf2m_primitive_poly(unsigned m)
+{
+    constexpr uint32_t polys[17] = {
+        0, 0, 0x7, 0xB, 0x13, 0x25, 0x43, 0x89, 0x11D,
+        0x211, 0x409, 0x805, 0x1053, 0x201B, 0x4443, 0x8003, 0x1100B
+    };
+
+    return m < 17 ? polys[m] : 0;
+}
+
+
+/*
+ * GF(2^M) for M = 2..16, the symbol fields of binary BCH codes, alpha = x. Like GF256 but the
+ * tables (up to 2^16 entries) are built on first use rather than at compile time. Loops that
+ * multiply a lot should fetch exp_table() / log_table() once and index them directly
+ */
+template <unsigned M>
+class GF2m
+{
+    static_assert(M >= 2 && M <= 16, "GF(2^M) is implemented for M = 2..16");
+
+    struct Tables
+    {
+        std::vector<uint16_t> exp;      // alpha^i for i in [0, 2 * ORDER), doubled like GF256::EXP
+        std::vector<uint16_t> log;      // entry 0 unused
+        std::vector<uint16_t> quadratic;    // a root y of y^2 + y = c at [c], 0 if there is none
+    };
+
+
+    static const Tables& tables()
+    {
+        static const Tables t = []
+        {
+            Tables tables;
+            uint32_t x = 1;
+
+            tables.exp.resize(2 * ORDER);
+            tables.log.resize(ORDER + 1);
+            tables.quadratic.resize(ORDER + 1);
+
+            for (size_t i = 0; i < ORDER; ++i)
+            {
+                tables.exp[i] = static_cast<uint16_t>(x);
+                tables.exp[i + ORDER] = static_cast<uint16_t>(x);
+                tables.log[x] = static_cast<uint16_t>(i);
+
+                x <<= 1;
+
+                if (x & (uint32_t(1) << M))
+                    x ^= PRIMITIVE_POLY;
+            }
+
+            // y and y + 1 give the same c; only c = 0 has the root 0 (and 1, which is kept)
+            for (size_t y = 1; y <= ORDER; ++y)
+            {
+                const auto c = y ^ tables.exp[2 * tables.log[y]];
+
+                tables.quadratic[c] = static_cast<uint16_t>(y);
+            }
+
+            return tables;
+        }();
+
+        return t;
+    }
+
+
+public:
+    static constexpr uint32_t PRIMITIVE_POLY = gf2m_primitive_poly(M);
+    static constexpr size_t ORDER = (size_t(1) << M) - 1;
+
+
+    static const uint16_t* exp_table()
+    {
+        return tables().exp.data();
+    }
+
+
+    static const uint16_t* log_table()
+    {
+        return tables().log.data();
+    }
+
+
+    static uint16_t mul(uint16_t a, uint16_t b)
+    {
+        return a == 0 || b == 0 ? 0 : exp_table()[log_table()[a] + log_table()[b]];
+    }
+
+
+    // b != 0
+    static uint16_t div(uint16_t a, uint16_t b)
+    {
+        return a == 0 ? 0 : exp_table()[log_table()[a] + ORDER - log_table()[b]];
+    }
+
+
+    // alpha^power, for any power
+    static uint16_t exp(size_t power)
+    {
+        return exp_table()[power % ORDER];
+    }
+
+
+    // a != 0
+    static size_t log(uint16_t a)
+    {
+        return log_table()[a];
+    }
+
+
+    // a root y of y^2 + y = c (the other is y + 1), or 0 when there is none. c != 0
+    static uint16_t solve_quadratic(uint16_t c)
+    {
+        return tables().quadratic[c];
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end GaloisField.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -3,7 +3,9 @@
  *---------------------------------------------------------------------------*/
 #pragma once
 #include "CorrectionStrategy.h"
-#include <functional>
+#include <array>
+#include <cstdint>
+#include <algorithm>
 
 
 constexpr size_t two_to_power_of(int exponent)
@@ -19,6 +21,68 @@ constexpr size_t calc_hamming_code_check_bits(size_t dataBits, size_t redundant_
 }
 
 
+// one mask per check bit, packed into 64-bit words: bit (position) of mask i is set
+// when the 1-based position has bit i set, i.e. when check bit i covers that position
+template <size_t TotalBits, size_t CheckBits>
+constexpr std::array<std::array<uint64_t, word_count(TotalBits)>, CheckBits> make_hamming_parity_masks()
+{
+    std::array<std::array<uint64_t, word_count(TotalBits)>, CheckBits> masks{};
+
+    for (size_t i = 0; i < CheckBits; ++i)
+        for (size_t position = 0; position < TotalBits; ++position)
+            if (((position + 1) >> i) & 1)
+                masks[i][position / 64] |= uint64_t(1) << (position % 64);
+
+    return masks;
+}
+
+
+// maps a syndrome to the 0-based index of the bit it identifies. Syndromes that point
+// past the end of the codeword can't come from a single error and map to NoPosition
+template <size_t TotalBits, size_t CheckBits, uint32_t NoPosition>
+constexpr std::array<uint32_t, two_to_power_of(CheckBits)> make_hamming_syndrome_table()
+{
+    std::array<uint32_t, two_to_power_of(CheckBits)> table{};
+
+    table[0] = NoPosition; // no error
+
+    for (size_t syndrome = 1; syndrome < table.size(); ++syndrome)
+        table[syndrome] = syndrome <= TotalBits ? static_cast<uint32_t>(syndrome - 1) : NoPosition;
+
+    return table;
+}
+
+
+// a contiguous stretch of (extended) data bits between two check bit positions
+struct HammingRun
+{
+    uint32_t data_offset;
+    uint32_t stored_offset;
+    uint32_t length;
+};
+
+
+// data bits sit between the check bits at 0-based positions 2^k - 1, so they are stored as
+// runs: run k - 1 starts right after check bit k and ends just before check bit k + 1
+template <size_t TotalBits, size_t CheckBits>
+constexpr std::array<HammingRun, CheckBits - 1> make_hamming_data_runs()
+{
+    std::array<HammingRun, CheckBits - 1> runs{};
+    size_t data_offset = 0;
+
+    for (size_t k = 1; k < CheckBits; ++k)
+    {
+        const auto start = two_to_power_of(static_cast<int>(k));
+        const auto end = std::min(two_to_power_of(static_cast<int>(k + 1)) - 1, TotalBits);
+
+        runs[k - 1] = { static_cast<uint32_t>(data_offset), static_cast<uint32_t>(start), static_cast<uint32_t>(end - start) };
+        data_offset += end - start;
+    }
+
+    return runs;
+}
+
+
 // Implements extended Hamming code (with extra parity bit on data at MSB)
 template <size_t NumDataBits>
 // ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
@@ -32,148 +96,252 @@ public:
     typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
     typedef DecodeResult<NumDataBits, TOTAL_BIT_COUNT> DecodeResult_t;
     typedef std::bitset<NumDataBits + 1> DecodedBits_t;
-    typedef std::function<void (StoredDataBits_t& data, size_t parityIdx, bool parityVal)> ParityCalcPostFunc_t;
     typedef Chunk<NumDataBits, TOTAL_BIT_COUNT> Chunk_t;
 
+    typedef CorrectionStrategy<NumDataBits, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+    using Strategy_t::LAST_STORED_WORD_MASK;
+    static constexpr size_t EXTENDED_WORD_COUNT = word_count(DATA_BIT_COUNT);
+
+    static constexpr uint32_t NO_POSITION = ~uint32_t(0);
+
+    // generated at compile time; see make_hamming_parity_masks, make_hamming_syndrome_table
+    // and make_hamming_data_runs
+    static constexpr auto PARITY_MASKS = make_hamming_parity_masks<TOTAL_BIT_COUNT, CHECK_BIT_COUNT>();
+    static constexpr auto SYNDROME_TABLE = make_hamming_syndrome_table<TOTAL_BIT_COUNT, CHECK_BIT_COUNT, NO_POSITION>();
+    static constexpr auto DATA_RUNS = make_hamming_data_runs<TOTAL_BIT_COUNT, CHECK_BIT_COUNT>();
+
 private:
-    static void compute_parity_bits(StoredDataBits_t& encoded, ParityCalcPostFunc_t func)
+    static bool check_parity_words(const uint64_t* encoded, size_t check_idx)
+    {
+        uint64_t acc = 0;
+
+        for (size_t w = 0; w < STORED_WORD_COUNT; ++w)
+            acc ^= encoded[w] & PARITY_MASKS[check_idx][w];
+
+        return parity64(acc);
+    }
+
+
+    // gathers the data bits of a packed codeword, drops the extended parity bit and returns
+    // whether that parity bit disagrees with the data
+    static bool fetch_decoded_words(const uint64_t* encoded, uint64_t* data)
+    {
+        std::array<uint64_t, EXTENDED_WORD_COUNT> extended{};
+
+        for (const auto& run : DATA_RUNS)
+            copy_word_bits(extended.data(), run.data_offset, encoded, run.stored_offset, run.length);
+
+        shift_words_right_1(data, extended.data(), DATA_WORD_COUNT, EXTENDED_WORD_COUNT > DATA_WORD_COUNT && (extended.back() & 1) != 0);
+        data[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        return (extended[0] & 1) != words_parity(data, DATA_WORD_COUNT);
+    }
+
+public:
+    // sets every Hamming check bit of a packed codeword (STORED_WORD_COUNT words) so that each
+    // check has even parity. Check bit positions are expected to be clear
+    static void set_parity_words(uint64_t* encoded)
     {
-        // compute parity bits
         for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
-        {
-            const size_t mask = 1 << i;
+            assign_word_bit(encoded, (size_t(1) << i) - 1, check_parity_words(encoded, i));
+    }
 
-            // compute parity value by looking at all bits
-            // with the ith bit set in their index
-            size_t counter = 0;
 
-            for (size_t position = 0; position < TOTAL_BIT_COUNT; ++position) {
-                const auto t = (mask & (position + 1));
+    // re-computes every check over a packed codeword. Each failing check contributes its bit,
+    // so a non-zero syndrome spells out the (1-based) position of a single bad bit
+    static size_t compute_syndrome_words(const uint64_t* encoded)
+    {
+        size_t syndrome = 0;
 
-                if (t != 0)
-                    if (encoded.test(position))
-                        ++counter;
-            }
+        for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+            syndrome |= static_cast<size_t>(check_parity_words(encoded, i)) << i;
 
-            // use even parity bit: counter should be an even value
-            // set parity bit to 1 if it's not
-            const auto parityBit = counter % 2 == 1;
+        return syndrome;
+    }
 
-            func(encoded, mask - 1, parityBit); // parity bit actual idx is 0-based
-        }
+
+    // encodes one packed data word (DATA_WORD_COUNT words) into one packed codeword.
+    // Produces exactly the same bits as encode()
+    static void encode_words(const uint64_t* data, uint64_t* encoded)
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> bits;
+        std::array<uint64_t, EXTENDED_WORD_COUNT> extended;
+
+        std::copy(data, data + DATA_WORD_COUNT, bits.begin());
+        bits.back() &= LAST_DATA_WORD_MASK;
+
+        // extended Hamming code: data parity bit at LSB, data above it
+        const auto top = shift_words_left_1(extended.data(), bits.data(), DATA_WORD_COUNT, words_parity(bits.data(), DATA_WORD_COUNT));
+
+        if (EXTENDED_WORD_COUNT > DATA_WORD_COUNT)
+            extended.back() = top ? 1 : 0;
+
+        std::fill(encoded, encoded + STORED_WORD_COUNT, 0);
+
+        for (const auto& run : DATA_RUNS)
+            copy_word_bits(encoded, run.stored_offset, extended.data(), run.data_offset, run.length);
+
+        set_parity_words(encoded);
     }
 
-    static bool is_power_of_two(size_t val)
+
+    // decodes one packed codeword into one packed data word and returns its DecodeStatus.
+    // Produces exactly the same data and outcome as decode()
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data)
     {
-        return val && !(val & val - 1);
+        size_t syndrome;
+
+        return decode_words(encoded, data, syndrome);
     }
 
 
-    static DecodedBits_t fetch_decoded_data(StoredDataBits_t& encoded)
+    // as above, also hands back the syndrome that was computed
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data, size_t& syndrome)
     {
-        size_t dataIdx = 0;
-        DecodedBits_t decoded;
+        std::array<uint64_t, STORED_WORD_COUNT> stored;
 
-        for (size_t i = 0; i < TOTAL_BIT_COUNT; ++i) {
-            if (is_power_of_two(i + 1)) continue;
+        std::copy(encoded, encoded + STORED_WORD_COUNT, stored.begin());
+        stored.back() &= LAST_STORED_WORD_MASK;
 
-            decoded[dataIdx++] = encoded.test(i);
-        }
+        syndrome = compute_syndrome_words(stored.data());
+        const auto corruptIdx = SYNDROME_TABLE[syndrome];
+        auto corrected = stored;
+
+        if (corruptIdx != NO_POSITION)
+            flip_word_bit(corrected.data(), corruptIdx);
+
+        // double error test: the extended parity bit must still match the data
+        auto de = fetch_decoded_words(corrected.data(), data);
 
-        return decoded;
+        if (syndrome == 0)
+            return de ? DECODE_UNCORRECTABLE : DECODE_CLEAN;
+
+        if (!de)
+            return DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+
+        // correction was meaningless, so return the data with no attempted correction
+        fetch_decoded_words(stored.data(), data);
+
+        return DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
     }
 
-public:
-    StoredDataBits_t encode(const std::bitset<NumDataBits>& unencodedData) const override
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
     {
-        // the parity bits for hamming code are actually interleaved among the
-        // data bits in a pattern: each parity bit is at a power-of-two index - 1
-        StoredDataBits_t encoded;
+        for (size_t i = 0; i < count; ++i)
+            encode_words(data + i * DATA_WORD_COUNT, encoded + i * STORED_WORD_COUNT);
+    }
+
 
-        // first, distribute data bits among correct locations
-        // for the extended Hamming code, we're going to need to add one extra parity bit
-        // as LSB of the data bits (so actually we're encoding NumDataBits + 1 bits)
-        auto extendedData = BitStream<DATA_BIT_COUNT>::convert_bitset_to_bitset(unencodedData);
-        extendedData <<= 1;
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            status[i] = decode_words(encoded + i * STORED_WORD_COUNT, data + i * DATA_WORD_COUNT);
+    }
+
+
+    // data bit i is extended bit i + 1, stored in one of DATA_RUNS. Flipping the bit at 0-based
+    // position p flips the check bits covering p + 1 and the data parity bit (extended bit 0, the
+    // first run), which in turn flips the check bits covering its own position
+    uint8_t update(StoredDataBits_t& stored, size_t bit_offset, uint64_t old_bits, uint64_t new_bits, size_t length) const override
+    {
+        assert(length <= WORD_BITS && bit_offset + length <= NumDataBits);
 
-        extendedData[0] = unencodedData.count() % 2 != 0; // add parity bit to data
-            
-        size_t idx_data = 0;
+        const auto delta = (old_bits ^ new_bits) & low_bits_mask(length);
 
-        for (size_t encode_idx = 0; encode_idx < TOTAL_BIT_COUNT; ++encode_idx)
+        // from about half the data bits on, encoding the change is faster
+        if (length * 2 >= NumDataBits)
         {
-            // is this a Hamming parity bit location? (idx is a power of 2)
-            // if so, ignore for now.
-            // we assume 1-based array for this snippet
-            if (is_power_of_two(encode_idx + 1))
+            this->update_by_encode(stored, bit_offset, delta, length);
+            return DECODE_CLEAN;
+        }
+
+        const auto first = bit_offset + 1;
+        const auto last = first + length;
+        size_t syndrome = 0;
+
+        // the changed range spans at most a few runs
+        for (const auto& run : DATA_RUNS)
+        {
+            if (run.data_offset >= last)
+                break;
+
+            const auto lo = std::max<size_t>(first, run.data_offset);
+            const auto hi = std::min<size_t>(last, run.data_offset + run.length);
+
+            if (lo >= hi)
                 continue;
-            
-            // normal data bit
-            encoded[encode_idx] = extendedData[idx_data++];
+
+            const auto position = run.stored_offset + lo - run.data_offset;
+            const auto piece = (delta >> (lo - first)) & low_bits_mask(hi - lo);
+
+            for (size_t j = 0; j < hi - lo; ++j)
+                syndrome ^= (position + j + 1) & (0 - ((piece >> j) & 1));
+
+            flip_bitset_bits(stored, position, hi - lo, piece);
         }
 
+        // the data parity bit (position 2) and check bits 0..6 (positions 0, 1, 3, ..., 63) share
+        // the first word; any other check bits get a word each
+        const uint64_t parity = parity64(delta);
 
-        // compute Hamming parity bits and set them
-        compute_parity_bits(encoded, [](StoredDataBits_t& data, size_t parityIdx, bool parityVal) { data[parityIdx] = parityVal; });
+        syndrome ^= (DATA_RUNS[0].stored_offset + 1) & (0 - parity);
 
-        return encoded;
-    }
+        uint64_t low_checks = parity << DATA_RUNS[0].stored_offset;
 
+        for (size_t i = 0; i < 7; ++i)
+            low_checks |= uint64_t((syndrome >> i) & 1) << ((size_t(1) << i) - 1);
 
-    DecodeResult_t decode(StoredDataBits_t storedData) const override
-    {
-        DecodeResult_t result;
-        StoredDataBits_t corrected = storedData;
-        auto corrupt = false;
-        size_t corruptIdx = 0, position = 1; // note that using 1-based position, will need correcting when we flip
+        flip_bitset_bits(stored, 0, std::min<size_t>(TOTAL_BIT_COUNT, WORD_BITS), low_checks);
 
-        // first, re-compute parity bits to check integrity of data
-        compute_parity_bits(storedData, [&corrupt, &corruptIdx, &position](StoredDataBits_t& data, size_t parityIdx, bool parityVal)
-        {
-            // does calculated parity val match the expected one? if not, a corrupt bit is detected
-            // note: we expect the correct bits to be set here for even parity. So we're always
-            // expecting FALSE for parity val
-            if (parityVal)  // parity bits of data are not correct!
-                corrupt = true;
+        for (auto high = syndrome >> 7; high != 0; high &= high - 1)
+            stored.flip((size_t(1) << (lowest_bit_index(high) + 7)) - 1);
 
-            // if we get non-zero parity, it is used to encode the position of the
-            // (at least one) bad bit
-            if (corrupt && parityVal)
-                corruptIdx += position;
+        return DECODE_CLEAN;
+    }
 
-            position *= 2;
-        });
 
-        if (corrupt && corruptIdx < TOTAL_BIT_COUNT) 
-            // correct the error (remember: corruptIdx is 1-based, bitset is 0-based)
-            corrected.flip(corruptIdx - 1);
+    StoredDataBits_t encode(const std::bitset<NumDataBits>& unencodedData) const override
+    {
+        // the parity bits for hamming code are actually interleaved among the
+        // data bits in a pattern: each parity bit is at a power-of-two index - 1.
+        // for the extended Hamming code, there is one extra parity bit as LSB of the
+        // data bits (so actually we're encoding NumDataBits + 1 bits). See encode_words
+        std::array<uint64_t, DATA_WORD_COUNT> data;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
 
-        // recover original data by removing the Hamming parity bits, which aren't needed anymore
-        auto decoded = fetch_decoded_data(corrected);
+        bitset_to_words(unencodedData, data.data());
+        encode_words(data.data(), encoded.data());
 
-        // remember this is the extended Hamming code, so there's actually an extra bit at LSB position
-        // which is a parity check. This is needed to perform double error detection, otherwise
-        // Hamming code can't detect double errors if we also correct single errors
-        auto recovered = BitStream<NumDataBits>::convert_bitset_to_bitset(decoded >> 1);
+        return words_to_bitset<TOTAL_BIT_COUNT>(encoded.data());
+    }
 
-        // check the parity bit to make sure there wasn't a double error
-        const auto paritySet = decoded.test(0);
-        const auto needsParitySet = recovered.count() % 2 != 0;
 
-        auto de = paritySet != needsParitySet; // double error test
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+
+        bitset_to_words(storedData, encoded.data());
+
+        // re-compute parity bits to check integrity of data, correct a single error and make sure
+        // the extended parity bit still agrees. See decode_words
+        const auto status = decode_words(encoded.data(), decoded.data());
 
-        result.decoded_bits = recovered;
-        result.success = !de;
-        result.error_detected = corrupt;
+        // remember this is the extended Hamming code, so a single error can be corrected, but
+        // a double error can only be detected. The decoded bits are then returned as stored
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+        result.success = (status & DECODE_UNCORRECTABLE) == 0;
+        result.error_detected = (status & DECODE_ERROR_DETECTED) != 0;
 
-        if (corrupt) {
-            if (de) {
+        if (result.error_detected) {
+            if (!result.success) {
                 result.num_corrupt_bits = 2;
                 result.num_corrected_bits = 0;
-
-                // our correction was meaningless, so return decoded bits with no attempted correction
-                auto f = fetch_decoded_data(storedData);
-                result.decoded_bits = BitStream<NumDataBits>::convert_bitset_to_bitset(f);
             } else {
                 result.num_corrupt_bits = 1;
                 result.num_corrected_bits = 1;
@@ -182,6 +350,23 @@ public:
 
         return result;
     } // end decode
+
+
+    CompactDecodeResult<NumDataBits> decode_compact(const StoredDataBits_t& storedData) const override
+    {
+        CompactDecodeResult<NumDataBits> result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        size_t syndrome;
+
+        bitset_to_words(storedData, encoded.data());
+
+        result.status = decode_words(encoded.data(), decoded.data(), syndrome);
+        result.syndrome = static_cast<uint16_t>(syndrome);
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+
+        return result;
+    }
 };
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,395 @@
+/*-----------------------------------------------------------------------------
+ * HsiaoCode.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include "CorrectionStrategy.h"
+#include "Chunk.h"
+#include <array>
+#include <algorithm>
+#include <cstdint>
+
+
+// smallest r with enough distinct odd weight (>= 3) columns for every data bit: there are
+// 2^(r - 1) odd weight r-bit columns, r of which have weight 1 and are taken by the check bits
+constexpr size_t calc_hsiao_code_check_bits(size_t dataBits, size_t check_bits = 2)
+{
+    return (size_t(1) << (check_bits - 1)) - check_bits >= dataBits ? check_bits : calc_hsiao_code_check_bits(dataBits, check_bits + 1);
+}
+
+
+// next larger value with the same number of set bits (Gosper's hack)
+constexpr uint64_t next_same_weight(uint64_t value)
+{
+    const auto lowest = value & (~value + 1);
+    const auto ripple = value + lowest;
+
+    return ripple | (((value ^ ripple) >> 2) / lowest);
+}
+
+
+// rotates a column of check_bits rows by one row
+constexpr uint64_t rotate_column(uint64_t column, size_t check_bits)
+{
+    return ((column << 1) | (column >> (check_bits - 1))) & ((uint64_t(1) << check_bits) - 1);
+}
+
+
+/*
+ * The parity check column of every data bit: odd weight, lightest weights first (all weight 3
+ * columns, then weight 5, ...), and within a weight picked so that every check bit covers
+ * about as many data bits as every other. Few, even row weights make shallow XOR trees for the
+ * check bits, and odd columns make every double error show up as an even weight syndrome
+ */
+template <size_t DataBits, size_t CheckBits>
+constexpr std::array<uint32_t, DataBits> make_hsiao_columns()
+{
+    std::array<uint32_t, DataBits> columns{};
+    std::array<size_t, CheckBits> row_weight{};
+    size_t taken = 0;
+
+    for (size_t weight = 3; weight <= CheckBits && taken < DataBits; weight += 2)
+    {
+        const uint64_t first = (uint64_t(1) << weight) - 1;
+        const uint64_t end = uint64_t(1) << CheckBits;
+
+        size_t available = 0;
+
+        for (auto c = first; c < end; c = next_same_weight(c))
+            ++available;
+
+        // the whole weight class fits: take it as is, it's balanced by symmetry
+        if (available <= DataBits - taken)
+        {
+            for (auto c = first; c < end; c = next_same_weight(c))
+            {
+                columns[taken++] = static_cast<uint32_t>(c);
+
+                for (size_t i = 0; i < CheckBits; ++i)
+                    row_weight[i] += (c >> i) & 1;
+            }
+
+            continue;
+        }
+
+        std::array<bool, (size_t(1) << CheckBits)> used{};
+
+        // otherwise take whole orbits under rotation of the rows: an orbit covers every row equally
+        // often, so the rows stay the same weight. The last CheckBits or so are left to the greedy
+        // pass below, which evens out what whole orbits can't
+        for (auto c = first; c < end && taken < DataBits; c = next_same_weight(c))
+        {
+            if (used[c])
+                continue;
+
+            size_t orbit = 1;
+
+            for (auto r = rotate_column(c, CheckBits); r != c; r = rotate_column(r, CheckBits))
+                ++orbit;
+
+            if (orbit + CheckBits > DataBits - taken)
+                continue;
+
+            for (auto r = c; orbit != 0; r = rotate_column(r, CheckBits), --orbit)
+            {
+                used[r] = true;
+                columns[taken++] = static_cast<uint32_t>(r);
+
+                for (size_t i = 0; i < CheckBits; ++i)
+                    row_weight[i] += (r >> i) & 1;
+            }
+        }
+
+        // the rest greedily: the unused column whose rows are the lightest so far
+        while (taken < DataBits)
+        {
+            uint64_t best = 0;
+            size_t best_cost = ~size_t(0);
+
+            for (auto c = first; c < end; c = next_same_weight(c))
+            {
+                size_t cost = 0;
+
+                for (size_t i = 0; i < CheckBits; ++i)
+                    cost += ((c >> i) & 1) * row_weight[i];
+
+                if (!used[c] && cost < best_cost)
+                {
+                    best = c;
+                    best_cost = cost;
+                }
+            }
+
+            used[best] = true;
+            columns[taken++] = static_cast<uint32_t>(best);
+
+            for (size_t i = 0; i < CheckBits; ++i)
+                row_weight[i] += (best >> i) & 1;
+        }
+    }
+
+    return columns;
+}
+
+
+// one mask per check bit over the whole (packed) codeword: the data bits whose column has that
+// check bit set, plus the check bit itself, so a row's parity over a valid codeword is even
+template <size_t DataBits, size_t CheckBits>
+constexpr std::array<std::array<uint64_t, word_count(DataBits + CheckBits)>, CheckBits> make_hsiao_row_masks()
+{
+    const auto columns = make_hsiao_columns<DataBits, CheckBits>();
+    std::array<std::array<uint64_t, word_count(DataBits + CheckBits)>, CheckBits> rows{};
+
+    for (size_t i = 0; i < CheckBits; ++i)
+    {
+        for (size_t bit = 0; bit < DataBits; ++bit)
+            if ((columns[bit] >> i) & 1)
+                rows[i][bit / 64] |= uint64_t(1) << (bit % 64);
+
+        rows[i][(DataBits + i) / 64] |= uint64_t(1) << ((DataBits + i) % 64);
+    }
+
+    return rows;
+}
+
+
+// maps a syndrome to the 0-based codeword position of the single bit error that causes it, or
+// NoPosition when no single error does
+template <size_t DataBits, size_t CheckBits, uint32_t NoPosition>
+constexpr std::array<uint32_t, (size_t(1) << CheckBits)> make_hsiao_syndrome_table()
+{
+    const auto columns = make_hsiao_columns<DataBits, CheckBits>();
+    std::array<uint32_t, (size_t(1) << CheckBits)> table{};
+
+    for (auto& entry : table)
+        entry = NoPosition;
+
+    for (size_t bit = 0; bit < DataBits; ++bit)
+        table[columns[bit]] = static_cast<uint32_t>(bit);
+
+    for (size_t i = 0; i < CheckBits; ++i)
+        table[size_t(1) << i] = static_cast<uint32_t>(DataBits + i);
+
+    return table;
+}
+
+
+/*
+ * Hsiao SEC-DED code (M. Y. Hsiao, "A Class of Optimal Minimum Odd-weight-column SEC-DED
+ * Codes", 1970): (13, 8), (39, 32), (72, 64), (137, 128), ...
+ *
+ * Systematic layout: data bits 0..NumDataBits-1 are stored as is, check bit i follows at
+ * NumDataBits + i. Every parity check column has odd weight, so a single error gives an odd
+ * weight syndrome that names the bad bit, and a double error an even weight non-zero syndrome.
+ * Double error detection therefore falls out of the syndrome, where HammingCode needs an
+ * extra parity pass over the data
+ */
+template <size_t NumDataBits>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class HsiaoCode : public CorrectionStrategy<NumDataBits, NumDataBits + calc_hsiao_code_check_bits(NumDataBits)>
+{
+public:
+    static constexpr size_t DATA_BIT_COUNT = NumDataBits;
+    static constexpr size_t CHECK_BIT_COUNT = calc_hsiao_code_check_bits(NumDataBits);
+    static constexpr size_t TOTAL_BIT_COUNT = DATA_BIT_COUNT + CHECK_BIT_COUNT;
+
+    static_assert(CHECK_BIT_COUNT <= 16, "syndromes are reported as 16 bits");
+
+    typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
+    typedef DecodeResult<NumDataBits, TOTAL_BIT_COUNT> DecodeResult_t;
+    typedef Chunk<NumDataBits, TOTAL_BIT_COUNT> Chunk_t;
+
+    typedef CorrectionStrategy<NumDataBits, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+    using Strategy_t::LAST_STORED_WORD_MASK;
+
+    static constexpr uint32_t NO_POSITION = ~uint32_t(0);
+
+    // generated at compile time; see make_hsiao_columns, make_hsiao_row_masks and
+    // make_hsiao_syndrome_table
+    static constexpr auto COLUMNS = make_hsiao_columns<DATA_BIT_COUNT, CHECK_BIT_COUNT>();
+    static constexpr auto ROW_MASKS = make_hsiao_row_masks<DATA_BIT_COUNT, CHECK_BIT_COUNT>();
+    static constexpr auto SYNDROME_TABLE = make_hsiao_syndrome_table<DATA_BIT_COUNT, CHECK_BIT_COUNT, NO_POSITION>();
+
+private:
+    static bool check_parity_words(const uint64_t* encoded, size_t check_idx)
+    {
+        uint64_t acc = 0;
+
+        for (size_t w = 0; w < STORED_WORD_COUNT; ++w)
+            acc ^= encoded[w] & ROW_MASKS[check_idx][w];
+
+        return parity64(acc);
+    }
+
+public:
+    // packed word kernels: encoded holds STORED_WORD_COUNT words, data DATA_WORD_COUNT words
+    static size_t compute_syndrome_words(const uint64_t* encoded)
+    {
+        size_t syndrome = 0;
+
+        for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+            syndrome |= static_cast<size_t>(check_parity_words(encoded, i)) << i;
+
+        return syndrome;
+    }
+
+
+    static void encode_words(const uint64_t* data, uint64_t* encoded)
+    {
+        std::fill(encoded, encoded + STORED_WORD_COUNT, 0);
+        std::copy(data, data + DATA_WORD_COUNT, encoded);
+        encoded[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        // check bits are still clear, so each row's parity is that of its data bits
+        for (size_t i = 0; i < CHECK_BIT_COUNT; ++i)
+            assign_word_bit(encoded, DATA_BIT_COUNT + i, check_parity_words(encoded, i));
+    }
+
+
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data)
+    {
+        size_t syndrome;
+
+        return decode_words(encoded, data, syndrome);
+    }
+
+
+    // as above, also hands back the syndrome that was computed
+    static uint8_t decode_words(const uint64_t* encoded, uint64_t* data, size_t& syndrome)
+    {
+        std::array<uint64_t, STORED_WORD_COUNT> stored;
+
+        std::copy(encoded, encoded + STORED_WORD_COUNT, stored.begin());
+        stored.back() &= LAST_STORED_WORD_MASK;
+
+        syndrome = compute_syndrome_words(stored.data());
+
+        uint8_t status = DECODE_CLEAN;
+
+        if (syndrome != 0)
+        {
+            const auto corruptIdx = SYNDROME_TABLE[syndrome];
+
+            // even weight (double error) and unused odd syndromes have no position
+            if (corruptIdx != NO_POSITION)
+            {
+                flip_word_bit(stored.data(), corruptIdx);
+                status = DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+            } else
+                status = DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
+        }
+
+        std::copy(stored.begin(), stored.begin() + DATA_WORD_COUNT, data);
+        data[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        return status;
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            encode_words(data + i * DATA_WORD_COUNT, encoded + i * STORED_WORD_COUNT);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            status[i] = decode_words(encoded + i * STORED_WORD_COUNT, data + i * DATA_WORD_COUNT);
+    }
+
+
+    // data bit i is stored bit i, and flipping it flips the check bits of its column
+    uint8_t update(StoredDataBits_t& stored, size_t bit_offset, uint64_t old_bits, uint64_t new_bits, size_t length) const override
+    {
+        assert(length <= WORD_BITS && bit_offset + length <= NumDataBits);
+
+        const auto delta = (old_bits ^ new_bits) & low_bits_mask(length);
+
+        // from about a quarter of the data bits on, encoding the change is faster
+        if (length * 4 >= NumDataBits)
+        {
+            this->update_by_encode(stored, bit_offset, delta, length);
+            return DECODE_CLEAN;
+        }
+
+        uint64_t syndrome = 0;
+
+        for (size_t i = 0; i < length; ++i)
+            syndrome ^= COLUMNS[bit_offset + i] & (0 - ((delta >> i) & 1));
+
+        flip_bitset_bits(stored, bit_offset, length, delta);
+        flip_bitset_bits(stored, DATA_BIT_COUNT, CHECK_BIT_COUNT, syndrome);
+
+        return DECODE_CLEAN;
+    }
+
+
+    StoredDataBits_t encode(const std::bitset<NumDataBits>& unencodedData) const override
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> data;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+
+        bitset_to_words(unencodedData, data.data());
+        encode_words(data.data(), encoded.data());
+
+        return words_to_bitset<TOTAL_BIT_COUNT>(encoded.data());
+    }
+
+
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        size_t syndrome;
+
+        bitset_to_words(storedData, encoded.data());
+
+        const auto status = decode_words(encoded.data(), decoded.data(), syndrome);
+
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+        result.success = (status & DECODE_UNCORRECTABLE) == 0;
+        result.error_detected = (status & DECODE_ERROR_DETECTED) != 0;
+
+        if (result.error_detected)
+        {
+            if (result.success)
+            {
+                result.num_corrupt_bits = 1;
+                result.num_corrected_bits = 1;
+            } else
+            {
+                // an even syndrome is a double error; an odd one no single error explains is at least 3
+                result.num_corrupt_bits = popcount64(syndrome) % 2 == 0 ? 2 : 3;
+                result.num_corrected_bits = 0;
+            }
+        }
+
+        return result;
+    }
+
+
+    CompactDecodeResult<NumDataBits> decode_compact(const StoredDataBits_t& storedData) const override
+    {
+        CompactDecodeResult<NumDataBits> result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        size_t syndrome;
+
+        bitset_to_words(storedData, encoded.data());
+
+        result.status = decode_words(encoded.data(), decoded.data(), syndrome);
+        result.syndrome = static_cast<uint16_t>(syndrome);
+        result.decoded_bits = words_to_bitset<NumDataBits>(decoded.data());
+
+        return result;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end HsiaoCode.h
+ *///////////////////////////////////////////////////////////////////////////*/
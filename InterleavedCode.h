@@ -0,0 +1,289 @@
+/*-----------------------------------------------------------------------------
+ * InterleavedCode.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <array>
+#include <vector>
+#include <algorithm>
+#include "CorrectionStrategy.h"
+#include "Chunk.h"
+
+
+/*
+ * Depth codewords of Strategy stored interleaved, so that neighbouring stored bits belong to
+ * different codewords: a burst of up to Depth adjacent bit errors hits each codeword at most
+ * once, and one of up to 2 * Depth at most twice. With a single error correcting Strategy like
+ * HammingCode that turns bursts it could only detect (or would miscorrect) into single errors
+ * it corrects.
+ *
+ * It is a strategy itself, so it works wherever the codes it wraps do (Chunk, ChunkArray, the
+ * batch API, fault injection). Its data word is the Depth data words of the codewords back to
+ * back; only the stored form is interleaved.
+ *
+ * Layout: the stored form is WORDS words (exactly Depth * N bits, N = Strategy's codeword
+ * size). Cut every codeword into ROWS = 64 / Depth slices of WORDS or WORDS - 1 consecutive
+ * bits, and let slice t of codeword c be row t * Depth + c of a 64 row bit matrix. The stored
+ * words are its columns, i.e. stored bit t * Depth + c of word x is bit x of that slice. Bit y
+ * of every stored word thus belongs to codeword y % Depth, across word boundaries too.
+ *
+ * Interleaving is one transpose64 per 64 stored words (consecutive codeword groups share the
+ * matrices), plus moving the slices in and out with word reads / writes; there is no per bit
+ * shuffling
+ */
+template <class Strategy, size_t Depth>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class InterleavedCode : public CorrectionStrategy<Depth * Strategy::NUM_DATA_BITS, Depth * Strategy::NUM_ENCODED_BITS>
+{
+public:
+    static_assert(Depth >= 2 && Depth <= WORD_BITS && (Depth & (Depth - 1)) == 0, "depth must be a power of two from 2 to 64");
+
+    typedef Strategy Inner_t;
+
+    static constexpr size_t DEPTH = Depth;
+    static constexpr size_t INNER_DATA_BITS = Strategy::NUM_DATA_BITS;
+    static constexpr size_t INNER_ENCODED_BITS = Strategy::NUM_ENCODED_BITS;
+
+    static constexpr size_t DATA_BIT_COUNT = Depth * INNER_DATA_BITS;
+    static constexpr size_t TOTAL_BIT_COUNT = Depth * INNER_ENCODED_BITS;
+    static constexpr size_t CHECK_BIT_COUNT = TOTAL_BIT_COUNT - DATA_BIT_COUNT;
+
+    typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
+    typedef DecodeResult<DATA_BIT_COUNT, TOTAL_BIT_COUNT> DecodeResult_t;
+    typedef Chunk<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Chunk_t;
+
+    typedef CorrectionStrategy<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+    using Strategy_t::LAST_STORED_WORD_MASK;
+
+    static constexpr size_t ROWS = WORD_BITS / Depth;                   // slices per codeword
+    static constexpr size_t WORDS = STORED_WORD_COUNT;                  // stored words, i.e. longest slice
+    static constexpr size_t FULL_ROWS = (TOTAL_BIT_COUNT - (WORDS - 1) * WORD_BITS) / Depth;    // slices of WORDS bits
+
+    // codeword groups per block of the batch paths; a multiple of 64, so blocks start on a matrix
+    static constexpr size_t BLOCK_GROUPS = 64;
+
+private:
+    static constexpr size_t IDW = Strategy::DATA_WORD_COUNT;
+    static constexpr size_t ISW = Strategy::STORED_WORD_COUNT;
+
+    // inner data words line up with the interleaved data word, so the batch paths can use it in place
+    static constexpr bool DATA_ALIGNED = INNER_DATA_BITS % WORD_BITS == 0;
+
+    Strategy m_strategy;
+
+
+    static constexpr size_t slice_length(size_t t)
+    {
+        return t < FULL_ROWS ? WORDS : WORDS - 1;
+    }
+
+    static constexpr size_t slice_offset(size_t t)
+    {
+        return t * (WORDS - 1) + (t < FULL_ROWS ? t : FULL_ROWS);
+    }
+
+
+    // calls fn(row, codeword, offset, length, shift) for each run of bits that stored words
+    // [first, end) (end - first <= 64) of consecutive groups take from the codewords: length bits
+    // at offset of codeword, which are bits [shift, shift + length) of row in the matrix
+    template <class Fn>
+    static void for_each_run(size_t first, size_t end, Fn&& fn)
+    {
+        for (auto g = first / WORDS; g * WORDS < end; ++g)
+        {
+            const auto lo = std::max(first, g * WORDS) - g * WORDS;
+            const auto hi = std::min(end, g * WORDS + WORDS) - g * WORDS;
+            const auto shift = g * WORDS + lo - first;
+
+            for (size_t t = 0; t < ROWS && slice_length(t) > lo; ++t)
+            {
+                const auto length = std::min(hi, slice_length(t)) - lo;
+
+                for (size_t c = 0; c < Depth; ++c)
+                    fn(t * Depth + c, g * Depth + c, slice_offset(t) + lo, length, shift);
+            }
+        }
+    }
+
+
+    // count groups of Depth codewords (ISW words each) -> count interleaved codewords
+    static void interleave(const uint64_t* codewords, size_t count, uint64_t* stored)
+    {
+        const auto total = count * WORDS;
+        uint64_t rows[64];
+
+        for (size_t first = 0; first < total; first += 64)
+        {
+            const auto end = std::min(first + 64, total);
+
+            std::fill(rows, rows + 64, 0);
+
+            for_each_run(first, end, [&](size_t row, size_t codeword, size_t offset, size_t length, size_t shift)
+            {
+                rows[row] |= read_word_bits(codewords + codeword * ISW, offset, length) << shift;
+            });
+
+            transpose64(rows);
+            std::copy(rows, rows + (end - first), stored + first);
+        }
+    }
+
+
+    // the reverse. Bits of codewords past INNER_ENCODED_BITS are left as they are
+    static void deinterleave(const uint64_t* stored, size_t count, uint64_t* codewords)
+    {
+        const auto total = count * WORDS;
+        uint64_t rows[64];
+
+        for (size_t first = 0; first < total; first += 64)
+        {
+            const auto end = std::min(first + 64, total);
+
+            std::copy(stored + first, stored + end, rows);
+            std::fill(rows + (end - first), rows + 64, 0);
+            transpose64(rows);
+
+            for_each_run(first, end, [&](size_t row, size_t codeword, size_t offset, size_t length, size_t shift)
+            {
+                write_word_bits(codewords + codeword * ISW, offset, length, rows[row] >> shift);
+            });
+        }
+    }
+
+
+    // interleaved data words -> inner data words (scratch is only used when they don't line up)
+    static const uint64_t* split_data(const uint64_t* data, size_t count, uint64_t* scratch)
+    {
+        if (DATA_ALIGNED)
+            return data;
+
+        for (size_t g = 0; g < count; ++g)
+            for (size_t c = 0; c < Depth; ++c)
+                copy_word_bits(scratch + (g * Depth + c) * IDW, 0, data + g * DATA_WORD_COUNT, c * INNER_DATA_BITS, INNER_DATA_BITS);
+
+        return scratch;
+    }
+
+
+    static void join_data(const uint64_t* inner, size_t count, uint64_t* data)
+    {
+        for (size_t g = 0; g < count; ++g)
+        {
+            data[g * DATA_WORD_COUNT + DATA_WORD_COUNT - 1] = 0;
+
+            for (size_t c = 0; c < Depth; ++c)
+                copy_word_bits(data + g * DATA_WORD_COUNT, c * INNER_DATA_BITS, inner + (g * Depth + c) * IDW, 0, INNER_DATA_BITS);
+        }
+    }
+
+
+public:
+    explicit InterleavedCode(const Strategy& strategy = Strategy()) : m_strategy(strategy)
+    {
+    }
+
+
+    const Strategy& inner() const
+    {
+        return m_strategy;
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        const auto block = std::min(count, BLOCK_GROUPS);
+        std::vector<uint64_t> inner_data(DATA_ALIGNED ? 0 : block * Depth * IDW);
+        std::vector<uint64_t> codewords(block * Depth * ISW);
+
+        for (size_t i = 0; i < count; i += BLOCK_GROUPS)
+        {
+            const auto n = std::min(BLOCK_GROUPS, count - i);
+
+            m_strategy.Strategy::encode_batch(split_data(data + i * DATA_WORD_COUNT, n, inner_data.data()), n * Depth, codewords.data());
+            interleave(codewords.data(), n, encoded + i * STORED_WORD_COUNT);
+        }
+    }
+
+
+    // a group's status is the OR of its codewords' statuses
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        const auto block = std::min(count, BLOCK_GROUPS);
+        std::vector<uint64_t> inner_data(DATA_ALIGNED ? 0 : block * Depth * IDW);
+        std::vector<uint64_t> codewords(block * Depth * ISW);
+        std::vector<uint8_t> inner_status(block * Depth);
+
+        for (size_t i = 0; i < count; i += BLOCK_GROUPS)
+        {
+            const auto n = std::min(BLOCK_GROUPS, count - i);
+            auto* out = DATA_ALIGNED ? data + i * DATA_WORD_COUNT : inner_data.data();
+
+            deinterleave(encoded + i * STORED_WORD_COUNT, n, codewords.data());
+            m_strategy.Strategy::decode_batch(codewords.data(), n * Depth, out, inner_status.data());
+
+            if (!DATA_ALIGNED)
+                join_data(inner_data.data(), n, data + i * DATA_WORD_COUNT);
+
+            for (size_t g = 0; g < n; ++g)
+            {
+                uint8_t flags = DECODE_CLEAN;
+
+                for (size_t c = 0; c < Depth; ++c)
+                    flags |= inner_status[g * Depth + c];
+
+                status[i + g] = flags;
+            }
+        }
+    }
+
+
+    StoredDataBits_t encode(const std::bitset<DATA_BIT_COUNT>& unencodedData) const override
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> data;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+
+        bitset_to_words(unencodedData, data.data());
+        encode_batch(data.data(), 1, encoded.data());
+
+        return words_to_bitset<TOTAL_BIT_COUNT>(encoded.data());
+    }
+
+
+    // decodes every codeword with Strategy::decode; counts are summed, success / detection combined
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, Depth * ISW> codewords = {};
+        std::array<uint64_t, DATA_WORD_COUNT> decoded = {};
+        std::array<uint64_t, IDW> inner_decoded;
+
+        bitset_to_words(storedData, encoded.data());
+        deinterleave(encoded.data(), 1, codewords.data());
+
+        result.success = true;
+
+        for (size_t c = 0; c < Depth; ++c)
+        {
+            const auto inner = m_strategy.decode(words_to_bitset<INNER_ENCODED_BITS>(codewords.data() + c * ISW));
+
+            bitset_to_words(inner.decoded_bits, inner_decoded.data());
+            copy_word_bits(decoded.data(), c * INNER_DATA_BITS, inner_decoded.data(), 0, INNER_DATA_BITS);
+
+            result.success = result.success && inner.success;
+            result.error_detected = result.error_detected || inner.error_detected;
+            result.num_corrupt_bits += inner.num_corrupt_bits;
+            result.num_corrected_bits += inner.num_corrected_bits;
+        }
+
+        result.decoded_bits = words_to_bitset<DATA_BIT_COUNT>(decoded.data());
+
+        return result;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end InterleavedCode.h
+ *///////////////////////////////////////////////////////////////////////////*/
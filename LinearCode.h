@@ -0,0 +1,829 @@
+/*-----------------------------------------------------------------------------
+ * LinearCode.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include "CorrectionStrategy.h"
+#include "Chunk.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/*
+ * Generator and parity check matrix of a binary linear (total_bits, data_bits) code, one packed
+ * row (row_words() words, bit j = codeword position j) after another. A data word u encodes to
+ * u * G; H has a row per check bit and H * c = 0 for every codeword c
+ */
+struct LinearCodeMatrices
+{
+    size_t data_bits = 0;
+    size_t total_bits = 0;
+    std::vector<uint64_t> generator;        // data_bits rows
+    std::vector<uint64_t> parity_check;     // total_bits - data_bits rows
+
+
+    size_t row_words() const { return word_count(total_bits); }
+    size_t check_bits() const { return total_bits - data_bits; }
+
+    const uint64_t* generator_row(size_t i) const { return generator.data() + i * row_words(); }
+    const uint64_t* parity_check_row(size_t i) const { return parity_check.data() + i * row_words(); }
+};
+
+
+/*
+ * Brings row_count packed rows of row_words words (bits [0, columns) used) to reduced row echelon
+ * form in place and returns the rank; pivots receives the pivot column of each of the first rank
+ * rows. Every row operation is repeated on companion (row_count rows of companion_words words)
+ * when it is given, so starting it from the identity records the transform
+ */
+inline size_t gf2_row_reduce(uint64_t* rows, size_t row_count, size_t row_words, size_t columns,
+                             std::vector<size_t>& pivots, uint64_t* companion = nullptr, size_t companion_words = 0)
+{
+    size_t rank = 0;
+
+    pivots.clear();
+
+    for (size_t column = 0; column < columns && rank < row_count; ++column)
+    {
+        size_t pivot = rank;
+
+        while (pivot < row_count && !test_word_bit(rows + pivot * row_words, column))
+            ++pivot;
+
+        if (pivot == row_count)
+            continue;
+
+        if (pivot != rank)
+        {
+            std::swap_ranges(rows + pivot * row_words, rows + (pivot + 1) * row_words, rows + rank * row_words);
+
+            if (companion != nullptr)
+                std::swap_ranges(companion + pivot * companion_words, companion + (pivot + 1) * companion_words, companion + rank * companion_words);
+        }
+
+        for (size_t r = 0; r < row_count; ++r)
+        {
+            if (r == rank || !test_word_bit(rows + r * row_words, column))
+                continue;
+
+            for (size_t w = 0; w < row_words; ++w)
+                rows[r * row_words + w] ^= rows[rank * row_words + w];
+
+            if (companion != nullptr)
+                for (size_t w = 0; w < companion_words; ++w)
+                    companion[r * companion_words + w] ^= companion[rank * companion_words + w];
+        }
+
+        pivots.push_back(column);
+        ++rank;
+    }
+
+    return rank;
+}
+
+
+// fills in the parity check matrix of matrices from its generator (a basis of the null space of
+// G: one row per non-pivot column of G's reduced form). False when G's rows are dependent
+inline bool derive_parity_check(LinearCodeMatrices& matrices)
+{
+    const auto row_words = matrices.row_words();
+    auto reduced = matrices.generator;
+    std::vector<size_t> pivots;
+
+    if (gf2_row_reduce(reduced.data(), matrices.data_bits, row_words, matrices.total_bits, pivots) != matrices.data_bits)
+        return false;
+
+    std::vector<bool> is_pivot(matrices.total_bits, false);
+
+    for (const auto pivot : pivots)
+        is_pivot[pivot] = true;
+
+    matrices.parity_check.assign(matrices.check_bits() * row_words, 0);
+
+    // the free column f with, at each pivot column, the bit that cancels f in that pivot's row
+    size_t row = 0;
+
+    for (size_t f = 0; f < matrices.total_bits; ++f)
+    {
+        if (is_pivot[f])
+            continue;
+
+        auto* h = matrices.parity_check.data() + row++ * row_words;
+
+        flip_word_bit(h, f);
+
+        for (size_t i = 0; i < pivots.size(); ++i)
+            if (test_word_bit(reduced.data() + i * row_words, f))
+                flip_word_bit(h, pivots[i]);
+    }
+
+    return true;
+}
+
+
+/*
+ * Reads a code from text: a line "G" followed by the generator rows, then optionally a line "H"
+ * followed by the parity check rows (derived from G when left out). A row is a string of 0 and
+ * 1, position 0 first; spaces within a row are ignored, and so are blank lines and lines
+ * starting with #. Both matrices must have full rank, and H total_bits - data_bits rows
+ */
+inline bool parse_linear_code_matrices(std::istream& in, LinearCodeMatrices& matrices, std::string& error)
+{
+    std::vector<std::string> rows[2];
+    int section = -1;
+    std::string line;
+    size_t line_number = 0;
+    size_t width = 0;       // of every row, G's and H's
+
+    while (std::getline(in, line))
+    {
+        ++line_number;
+
+        std::string bits;
+
+        for (const auto c : line)
+            if (c != ' ' && c != '\t' && c != '\r')
+                bits += c;
+
+        if (bits.empty() || bits[0] == '#')
+            continue;
+
+        if (bits == "G" || bits == "H")
+        {
+            section = bits == "G" ? 0 : 1;
+            continue;
+        }
+
+        if (section < 0 || bits.find_first_not_of("01") != std::string::npos)
+        {
+            error = "line " + std::to_string(line_number) + ": expected G, H or a row of 0 and 1";
+            return false;
+        }
+
+        if (width != 0 && bits.size() != width)
+        {
+            error = "line " + std::to_string(line_number) + ": row is " + std::to_string(bits.size()) + " bits, not " + std::to_string(width);
+            return false;
+        }
+
+        width = bits.size();
+        rows[section].push_back(bits);
+    }
+
+    if (rows[0].empty() || rows[0].size() >= width)
+    {
+        error = "expected a generator matrix with fewer rows than columns";
+        return false;
+    }
+
+    matrices.data_bits = rows[0].size();
+    matrices.total_bits = rows[0][0].size();
+
+    const auto row_words = matrices.row_words();
+
+    for (int m = 0; m < 2; ++m)
+    {
+        auto& packed = m == 0 ? matrices.generator : matrices.parity_check;
+
+        packed.assign(rows[m].size() * row_words, 0);
+
+        for (size_t r = 0; r < rows[m].size(); ++r)
+            for (size_t j = 0; j < rows[m][r].size(); ++j)
+                if (rows[m][r][j] == '1')
+                    flip_word_bit(packed.data() + r * row_words, j);
+    }
+
+    // LinearCode::build() checks the rest (G * H^T = 0)
+    auto reduced = matrices.generator;
+    std::vector<size_t> pivots;
+
+    if (gf2_row_reduce(reduced.data(), matrices.data_bits, row_words, matrices.total_bits, pivots) != matrices.data_bits)
+    {
+        error = "generator rows are linearly dependent";
+        return false;
+    }
+
+    if (rows[1].empty())
+        return derive_parity_check(matrices);
+
+    if (rows[1].size() != matrices.check_bits())
+    {
+        error = "expected " + std::to_string(matrices.check_bits()) + " parity check rows, not " + std::to_string(rows[1].size());
+        return false;
+    }
+
+    reduced = matrices.parity_check;
+
+    if (gf2_row_reduce(reduced.data(), matrices.check_bits(), row_words, matrices.total_bits, pivots) != matrices.check_bits())
+    {
+        error = "parity check rows are linearly dependent";
+        return false;
+    }
+
+    return true;
+}
+
+
+inline bool load_linear_code_matrices(const std::string& path, LinearCodeMatrices& matrices, std::string& error)
+{
+    std::ifstream in(path);
+
+    if (!in)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    if (!parse_linear_code_matrices(in, matrices, error))
+    {
+        error = path + ": " + error;
+        return false;
+    }
+
+    return true;
+}
+
+
+// the (23, 12) binary Golay code, generator polynomial 1 + x^2 + x^4 + x^5 + x^6 + x^10 + x^11, as
+// parse_linear_code_matrices reads it (minimum distance 7: LinearCode<12, 23> built with
+// CorrectWeight 3 corrects every 3 bit error)
+const char* const GOLAY_23_12 =
+    "# (23, 12) Golay code, cyclic (not systematic); H is derived\n"
+    "G\n"
+    "10101110001100000000000\n"
+    "01010111000110000000000\n"
+    "00101011100011000000000\n"
+    "00010101110001100000000\n"
+    "00001010111000110000000\n"
+    "00000101011100011000000\n"
+    "00000010101110001100000\n"
+    "00000001010111000110000\n"
+    "00000000101011100011000\n"
+    "00000000010101110001100\n"
+    "00000000001010111000110\n"
+    "00000000000101011100011\n";
+
+
+// the matrices of any linear Strategy (the codes of this project all are): G's rows are the
+// encoded unit vectors, H is derived from them
+template <class Strategy>
+LinearCodeMatrices linear_code_matrices_of(const Strategy& strategy = Strategy())
+{
+    LinearCodeMatrices matrices;
+    std::vector<uint64_t> unit(Strategy::DATA_WORD_COUNT);
+
+    matrices.data_bits = Strategy::NUM_DATA_BITS;
+    matrices.total_bits = Strategy::NUM_ENCODED_BITS;
+    matrices.generator.resize(matrices.data_bits * matrices.row_words());
+
+    for (size_t i = 0; i < matrices.data_bits; ++i)
+    {
+        std::fill(unit.begin(), unit.end(), 0);
+        flip_word_bit(unit.data(), i);
+        strategy.Strategy::encode_batch(unit.data(), 1, matrices.generator.data() + i * matrices.row_words());
+    }
+
+    derive_parity_check(matrices);
+
+    return matrices;
+}
+
+
+/*
+ * v * M for a fixed GF(2) matrix M of InputBits rows and OutputBits columns, by the method of
+ * four Russians: for every byte of v the XOR of each subset of its 8 rows of M is tabulated, so
+ * a product is one table row XORed in per input byte instead of one per set input bit. The table
+ * is ceil(InputBits / 8) * 256 rows of OutputBits, e.g. 32 KB for 64 x 72 and 1.2 MB for 512 x
+ * 523. Input bits past InputBits have all zero table rows, so they needn't be masked off
+ */
+template <size_t InputBits, size_t OutputBits>
+class Gf2ProductTable
+{
+public:
+    static constexpr size_t INPUT_BYTES = (InputBits + 7) / 8;
+    static constexpr size_t OUTPUT_WORDS = word_count(OutputBits);
+
+private:
+    std::vector<uint64_t> m_table;
+
+public:
+    Gf2ProductTable() = default;
+
+
+    // row(i) -> packed row i of M
+    template <class RowFn>
+    explicit Gf2ProductTable(RowFn&& row) : m_table(INPUT_BYTES * 256 * OUTPUT_WORDS, 0)
+    {
+        for (size_t chunk = 0; chunk < INPUT_BYTES; ++chunk)
+        {
+            auto* entries = m_table.data() + chunk * 256 * OUTPUT_WORDS;
+
+            // each subset is a smaller one plus its lowest row
+            for (size_t b = 1; b < 256; ++b)
+            {
+                const auto bit = chunk * 8 + lowest_bit_index(b);
+
+                if (bit >= InputBits)
+                    continue;
+
+                const auto* m = row(bit);
+                const auto* rest = entries + (b & (b - 1)) * OUTPUT_WORDS;
+
+                for (size_t w = 0; w < OUTPUT_WORDS; ++w)
+                    entries[b * OUTPUT_WORDS + w] = rest[w] ^ m[w];
+            }
+        }
+    }
+
+
+    void multiply(const uint64_t* v, uint64_t* out) const
+    {
+        const auto* entries = m_table.data();
+        std::array<uint64_t, OUTPUT_WORDS> acc{};
+
+        for (size_t chunk = 0; chunk < INPUT_BYTES; ++chunk, entries += 256 * OUTPUT_WORDS)
+        {
+            const auto* row = entries + ((v[chunk / 8] >> (chunk % 8 * 8)) & 0xff) * OUTPUT_WORDS;
+
+            for (size_t w = 0; w < OUTPUT_WORDS; ++w)
+                acc[w] ^= row[w];
+        }
+
+        std::copy(acc.begin(), acc.end(), out);
+    }
+};
+
+
+/*
+ * Any binary linear code as a strategy, from its generator matrix G and parity check matrix H
+ * (LinearCodeMatrices; see parse_linear_code_matrices / load_linear_code_matrices for reading
+ * them from a file and linear_code_matrices_of for those of an existing strategy). Shortened
+ * Hamming, Hsiao, Golay or a custom code can be tried out without a class of its own.
+ *
+ * Encoding is u * G and the syndrome H * c, both Gf2ProductTable lookups. The data is read back
+ * through a right inverse of G: K columns of G where it has full rank (the pivots of its reduced
+ * form) carry the data, and the inverse of that K x K block turns them back into it. When G is
+ * systematic with the data first ([I | P]) the data is copied both ways instead, and encoding
+ * only looks up u * P.
+ *
+ * Decoding corrects up to CorrectWeight errors (set when the code is built): each syndrome of an
+ * error pattern of at most that weight maps, in a hash table, to its coset leader (the lightest
+ * pattern giving it). A syndrome that two patterns of the same lowest weight share can't be told
+ * apart and is reported uncorrectable, as is one outside the table. With CorrectWeight = 1 that's
+ * SEC-DED decoding for SEC-DED codes (HsiaoCode decodes exactly the same way); CorrectWeight
+ * above what the minimum distance allows makes some corrections miscorrections.
+ *
+ * Built codes share their tables, so copies are cheap
+ */
+template <size_t NumDataBits, size_t NumEncodedBits>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class LinearCode : public CorrectionStrategy<NumDataBits, NumEncodedBits>
+{
+public:
+    static constexpr size_t DATA_BIT_COUNT = NumDataBits;
+    static constexpr size_t TOTAL_BIT_COUNT = NumEncodedBits;
+    static constexpr size_t CHECK_BIT_COUNT = TOTAL_BIT_COUNT - DATA_BIT_COUNT;
+
+    static_assert(DATA_BIT_COUNT > 0 && CHECK_BIT_COUNT > 0, "a code needs data and check bits");
+    static_assert(CHECK_BIT_COUNT <= 64, "syndromes are single words");
+    static_assert(TOTAL_BIT_COUNT <= 65536, "positions are 16 bits");
+
+    typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
+    typedef DecodeResult<DATA_BIT_COUNT, TOTAL_BIT_COUNT> DecodeResult_t;
+    typedef Chunk<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Chunk_t;
+
+    typedef CorrectionStrategy<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+    using Strategy_t::LAST_STORED_WORD_MASK;
+
+    // error patterns enumerated for the coset leader table at most
+    static constexpr size_t MAX_PATTERNS = size_t(1) << 24;
+
+private:
+    static constexpr uint8_t AMBIGUOUS = 0x80;     // flag on CosetLeader::weight
+
+    struct CosetLeader
+    {
+        uint64_t syndrome;      // 0: free slot
+        uint32_t positions;     // first of weight entries in Tables::positions
+        uint8_t weight;
+    };
+
+    struct Tables
+    {
+        Gf2ProductTable<DATA_BIT_COUNT, TOTAL_BIT_COUNT> encoder;                 // left empty when systematic
+        Gf2ProductTable<DATA_BIT_COUNT, CHECK_BIT_COUNT> check_encoder;          // only when systematic
+        Gf2ProductTable<TOTAL_BIT_COUNT, CHECK_BIT_COUNT> syndrome;
+        Gf2ProductTable<TOTAL_BIT_COUNT, DATA_BIT_COUNT> extractor;   // left empty when systematic
+        bool systematic = false;
+
+        std::vector<CosetLeader> leaders;       // open addressing, power of two slots
+        std::vector<uint16_t> positions;
+        size_t correct_weight = 0;
+    };
+
+    std::shared_ptr<const Tables> m_tables;
+    std::string m_error;
+
+
+    static size_t slot_of(uint64_t syndrome, size_t slot_count)
+    {
+        return static_cast<size_t>((syndrome * 0x9E3779B97F4A7C15ull) >> 32) & (slot_count - 1);
+    }
+
+
+    static const CosetLeader* find_leader(const Tables& tables, uint64_t syndrome)
+    {
+        const auto slot_count = tables.leaders.size();
+
+        for (auto slot = slot_of(syndrome, slot_count);; slot = (slot + 1) & (slot_count - 1))
+        {
+            const auto& leader = tables.leaders[slot];
+
+            if (leader.syndrome == syndrome)
+                return &leader;
+
+            if (leader.syndrome == 0)
+                return nullptr;
+        }
+    }
+
+
+    // every pattern of weight 1..correct_weight in order of weight, with the syndrome the columns
+    // of H give it. False if there would be more than MAX_PATTERNS of them
+    static bool build_leaders(Tables& tables, const std::vector<uint64_t>& columns, size_t correct_weight)
+    {
+        size_t pattern_count = 0;
+        size_t binomial = 1;
+
+        for (size_t w = 1; w <= correct_weight; ++w)
+        {
+            binomial = binomial * (TOTAL_BIT_COUNT - w + 1) / w;
+            pattern_count += binomial;
+
+            if (binomial > MAX_PATTERNS || pattern_count > MAX_PATTERNS)
+                return false;
+        }
+
+        const auto syndrome_count = CHECK_BIT_COUNT < 63 ? std::min(pattern_count, size_t(1) << CHECK_BIT_COUNT) : pattern_count;
+        size_t slot_count = 16;
+
+        while (slot_count < 2 * syndrome_count)
+            slot_count *= 2;
+
+        tables.leaders.assign(slot_count, CosetLeader{ 0, 0, 0 });
+        tables.correct_weight = correct_weight;
+
+        std::vector<size_t> pattern(correct_weight);
+
+        for (size_t w = 1; w <= correct_weight; ++w)
+        {
+            for (size_t i = 0; i < w; ++i)
+                pattern[i] = i;
+
+            while (true)
+            {
+                uint64_t syndrome = 0;
+
+                for (size_t i = 0; i < w; ++i)
+                    syndrome ^= columns[pattern[i]];
+
+                // a syndrome of 0 is a codeword: that pattern is undetectable, nothing to correct
+                if (syndrome != 0)
+                {
+                    auto slot = slot_of(syndrome, slot_count);
+
+                    while (tables.leaders[slot].syndrome != 0 && tables.leaders[slot].syndrome != syndrome)
+                        slot = (slot + 1) & (slot_count - 1);
+
+                    auto& leader = tables.leaders[slot];
+
+                    if (leader.syndrome == 0)
+                    {
+                        leader = { syndrome, static_cast<uint32_t>(tables.positions.size()), static_cast<uint8_t>(w) };
+
+                        for (size_t i = 0; i < w; ++i)
+                            tables.positions.push_back(static_cast<uint16_t>(pattern[i]));
+                    } else if (leader.weight == w)
+                        leader.weight |= AMBIGUOUS;
+                }
+
+                // next w-subset of the positions in lexicographic order
+                size_t i = w;
+
+                while (i > 0 && pattern[i - 1] == TOTAL_BIT_COUNT - w + i - 1)
+                    --i;
+
+                if (i == 0)
+                    break;
+
+                ++pattern[i - 1];
+
+                for (size_t j = i; j < w; ++j)
+                    pattern[j] = pattern[j - 1] + 1;
+            }
+        }
+
+        return true;
+    }
+
+
+    bool fail(const std::string& error)
+    {
+        m_error = error;
+        m_tables.reset();
+
+        return false;
+    }
+
+public:
+    // not usable until build() succeeds
+    LinearCode() = default;
+
+
+    // asserts if the matrices are no good; see build()
+    explicit LinearCode(const LinearCodeMatrices& matrices, size_t correct_weight = 1)
+    {
+        const auto built = build(matrices, correct_weight);
+
+        assert(built);
+        (void)built;
+    }
+
+
+    /*
+     * Checks the matrices (sizes, G and H of full rank, G * H^T = 0) and builds the tables; on
+     * failure returns false and says why in error(). correct_weight is the number of bit errors
+     * to correct; the coset leader table holds up to sum C(N, w), w <= correct_weight, entries
+     */
+    bool build(const LinearCodeMatrices& matrices, size_t correct_weight = 1)
+    {
+        const auto row_words = matrices.row_words();
+
+        if (matrices.data_bits != DATA_BIT_COUNT || matrices.total_bits != TOTAL_BIT_COUNT)
+            return fail("matrices are for a (" + std::to_string(matrices.total_bits) + ", " + std::to_string(matrices.data_bits) +
+                        ") code, not (" + std::to_string(TOTAL_BIT_COUNT) + ", " + std::to_string(DATA_BIT_COUNT) + ")");
+
+        if (matrices.generator.size() != DATA_BIT_COUNT * row_words || matrices.parity_check.size() != CHECK_BIT_COUNT * row_words)
+            return fail("matrix sizes don't match the code");
+
+        if (correct_weight > TOTAL_BIT_COUNT)
+            return fail("can't correct more errors than there are bits");
+
+        // the data's right inverse: A * G = reduced form, so A * G_pivots = I
+        auto reduced = matrices.generator;
+        std::vector<uint64_t> transform(DATA_BIT_COUNT * DATA_WORD_COUNT, 0);
+        std::vector<size_t> pivots;
+
+        for (size_t i = 0; i < DATA_BIT_COUNT; ++i)
+            flip_word_bit(transform.data() + i * DATA_WORD_COUNT, i);
+
+        if (gf2_row_reduce(reduced.data(), DATA_BIT_COUNT, row_words, TOTAL_BIT_COUNT, pivots, transform.data(), DATA_WORD_COUNT) != DATA_BIT_COUNT)
+            return fail("generator rows are linearly dependent");
+
+        auto h_reduced = matrices.parity_check;
+        std::vector<size_t> h_pivots;
+
+        if (gf2_row_reduce(h_reduced.data(), CHECK_BIT_COUNT, row_words, TOTAL_BIT_COUNT, h_pivots) != CHECK_BIT_COUNT)
+            return fail("parity check rows are linearly dependent");
+
+        // H^T: one single word row (the syndrome of a one bit error) per codeword position
+        std::vector<uint64_t> columns(TOTAL_BIT_COUNT, 0);
+
+        for (size_t r = 0; r < CHECK_BIT_COUNT; ++r)
+            for (size_t j = 0; j < TOTAL_BIT_COUNT; ++j)
+                if (test_word_bit(matrices.parity_check_row(r), j))
+                    columns[j] |= uint64_t(1) << r;
+
+        for (size_t i = 0; i < DATA_BIT_COUNT; ++i)
+        {
+            uint64_t syndrome = 0;
+
+            for (size_t j = 0; j < TOTAL_BIT_COUNT; ++j)
+                if (test_word_bit(matrices.generator_row(i), j))
+                    syndrome ^= columns[j];
+
+            if (syndrome != 0)
+                return fail("generator row " + std::to_string(i) + " fails the parity checks (G * H^T != 0)");
+        }
+
+        // codeword position pivots[i] contributes row i of A to the data
+        std::vector<uint64_t> data_rows(TOTAL_BIT_COUNT * DATA_WORD_COUNT, 0);
+        bool systematic = true;
+
+        for (size_t i = 0; i < DATA_BIT_COUNT; ++i)
+        {
+            std::copy(transform.begin() + i * DATA_WORD_COUNT, transform.begin() + (i + 1) * DATA_WORD_COUNT, data_rows.begin() + pivots[i] * DATA_WORD_COUNT);
+
+            for (size_t j = 0; j < DATA_BIT_COUNT; ++j)
+                systematic = systematic && pivots[i] == i && test_word_bit(transform.data() + i * DATA_WORD_COUNT, j) == (i == j);
+        }
+
+        auto tables = std::make_shared<Tables>();
+
+        tables->syndrome = Gf2ProductTable<TOTAL_BIT_COUNT, CHECK_BIT_COUNT>([&](size_t j) { return &columns[j]; });
+        tables->systematic = systematic;
+
+        // systematic codes only need the check bits computed (a table of one word rows), and the data copied
+        if (systematic)
+        {
+            std::vector<uint64_t> check_rows(DATA_BIT_COUNT);
+
+            for (size_t i = 0; i < DATA_BIT_COUNT; ++i)
+                check_rows[i] = read_word_bits(matrices.generator_row(i), DATA_BIT_COUNT, CHECK_BIT_COUNT);
+
+            tables->check_encoder = Gf2ProductTable<DATA_BIT_COUNT, CHECK_BIT_COUNT>([&](size_t i) { return &check_rows[i]; });
+        } else
+        {
+            tables->encoder = Gf2ProductTable<DATA_BIT_COUNT, TOTAL_BIT_COUNT>([&](size_t i) { return matrices.generator_row(i); });
+            tables->extractor = Gf2ProductTable<TOTAL_BIT_COUNT, DATA_BIT_COUNT>([&](size_t j) { return data_rows.data() + j * DATA_WORD_COUNT; });
+        }
+
+        if (!build_leaders(*tables, columns, correct_weight))
+            return fail("too many error patterns of weight " + std::to_string(correct_weight) + " or less");
+
+        m_tables = tables;
+        m_error.clear();
+
+        return true;
+    }
+
+
+    bool built() const { return m_tables != nullptr; }
+    const std::string& error() const { return m_error; }
+
+
+    // this and everything below only once built
+    bool systematic() const
+    {
+        assert(built());
+
+        return m_tables->systematic;
+    }
+
+
+    size_t correct_weight() const
+    {
+        assert(built());
+
+        return m_tables->correct_weight;
+    }
+
+
+    // packed word kernels: encoded holds STORED_WORD_COUNT words, data DATA_WORD_COUNT words
+    void encode_words(const uint64_t* data, uint64_t* encoded) const
+    {
+        assert(built());
+
+        const auto& tables = *m_tables;
+
+        if (!tables.systematic)
+        {
+            tables.encoder.multiply(data, encoded);
+            return;
+        }
+
+        uint64_t check;
+
+        std::copy(data, data + DATA_WORD_COUNT, encoded);
+        std::fill(encoded + DATA_WORD_COUNT, encoded + STORED_WORD_COUNT, 0);
+        encoded[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+        tables.check_encoder.multiply(data, &check);
+        write_word_bits(encoded, DATA_BIT_COUNT, CHECK_BIT_COUNT, check);
+    }
+
+
+    // as decode_words below; weight receives the number of bits flipped, or the weight of the
+    // ambiguous pattern (or correct_weight + 1 without one) when uncorrectable
+    uint8_t decode_words(const uint64_t* encoded, uint64_t* data, uint64_t& syndrome, size_t& weight) const
+    {
+        assert(built());
+
+        const auto& tables = *m_tables;
+        std::array<uint64_t, STORED_WORD_COUNT> stored;
+        uint8_t status = DECODE_CLEAN;
+
+        std::copy(encoded, encoded + STORED_WORD_COUNT, stored.begin());
+        stored.back() &= LAST_STORED_WORD_MASK;
+
+        tables.syndrome.multiply(stored.data(), &syndrome);
+        weight = 0;
+
+        if (syndrome != 0)
+        {
+            const auto* leader = find_leader(tables, syndrome);
+
+            if (leader != nullptr && (leader->weight & AMBIGUOUS) == 0)
+            {
+                for (size_t i = 0; i < leader->weight; ++i)
+                    flip_word_bit(stored.data(), tables.positions[leader->positions + i]);
+
+                weight = leader->weight;
+                status = DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+            } else
+            {
+                weight = leader != nullptr ? leader->weight & ~AMBIGUOUS : tables.correct_weight + 1;
+                status = DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
+            }
+        }
+
+        if (tables.systematic)
+        {
+            std::copy(stored.begin(), stored.begin() + DATA_WORD_COUNT, data);
+            data[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+        } else
+            tables.extractor.multiply(stored.data(), data);
+
+        return status;
+    }
+
+
+    // decodes one packed codeword into one packed data word and returns its DecodeStatus
+    uint8_t decode_words(const uint64_t* encoded, uint64_t* data) const
+    {
+        uint64_t syndrome;
+        size_t weight;
+
+        return decode_words(encoded, data, syndrome, weight);
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            encode_words(data + i * DATA_WORD_COUNT, encoded + i * STORED_WORD_COUNT);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        for (size_t i = 0; i < count; ++i)
+            status[i] = decode_words(encoded + i * STORED_WORD_COUNT, data + i * DATA_WORD_COUNT);
+    }
+
+
+    StoredDataBits_t encode(const std::bitset<DATA_BIT_COUNT>& unencodedData) const override
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> data;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+
+        bitset_to_words(unencodedData, data.data());
+        encode_words(data.data(), encoded.data());
+
+        return words_to_bitset<TOTAL_BIT_COUNT>(encoded.data());
+    }
+
+
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        uint64_t syndrome;
+        size_t weight;
+
+        bitset_to_words(storedData, encoded.data());
+
+        const auto status = decode_words(encoded.data(), decoded.data(), syndrome, weight);
+
+        result.decoded_bits = words_to_bitset<DATA_BIT_COUNT>(decoded.data());
+        result.success = (status & DECODE_UNCORRECTABLE) == 0;
+        result.error_detected = (status & DECODE_ERROR_DETECTED) != 0;
+        result.num_corrupt_bits = weight;
+        result.num_corrected_bits = result.success ? weight : 0;
+
+        return result;
+    }
+
+
+    // the syndrome is reported as its low 16 bits
+    CompactDecodeResult<DATA_BIT_COUNT> decode_compact(const StoredDataBits_t& storedData) const override
+    {
+        CompactDecodeResult<DATA_BIT_COUNT> result;
+        std::array<uint64_t, STORED_WORD_COUNT> encoded;
+        std::array<uint64_t, DATA_WORD_COUNT> decoded;
+        uint64_t syndrome;
+        size_t weight;
+
+        bitset_to_words(storedData, encoded.data());
+
+        result.status = decode_words(encoded.data(), decoded.data(), syndrome, weight);
+        result.syndrome = static_cast<uint16_t>(syndrome);
+        result.decoded_bits = words_to_bitset<DATA_BIT_COUNT>(decoded.data());
+
+        return result;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end LinearCode.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,229 @@
+/*-----------------------------------------------------------------------------
+ * MappedFile.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/*
+ * A whole file mapped into memory with POSIX mmap, shared with the file, so writes to data()
+ * end up in it. Failures are reported through the return value of the open calls, with the
+ * reason in error().
+ *
+ * The hint / flush calls take byte ranges of the file and widen them to whole pages, so callers
+ * working through the file block by block can pass their block bounds as they are
+ */
+class MappedFile
+{
+    int m_fd;
+    uint8_t* m_data;
+    size_t m_size;
+    bool m_writable;
+    std::string m_error;
+
+
+    bool fail(const std::string& what, const std::string& path)
+    {
+        m_error = what + " " + path + ": " + strerror(errno);
+        close();
+
+        return false;
+    }
+
+
+    bool map(const std::string& path)
+    {
+        // mmap can't map nothing; an empty file is an empty, unmapped range
+        if (m_size == 0)
+            return true;
+
+        const int protection = m_writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* p = mmap(nullptr, m_size, protection, MAP_SHARED, m_fd, 0);
+
+        if (p == MAP_FAILED)
+            return fail("can't map", path);
+
+        m_data = static_cast<uint8_t*>(p);
+
+        return true;
+    }
+
+
+    // [offset, offset + length) clipped to the file and widened to pages; false if empty
+    bool page_range(size_t offset, size_t length, uint8_t*& start, size_t& bytes) const
+    {
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+        if (m_data == nullptr || offset >= m_size)
+            return false;
+
+        const auto end = std::min(offset + length, m_size);
+        const auto first = offset / page * page;
+
+        start = m_data + first;
+        bytes = end - first;
+
+        return bytes > 0;
+    }
+
+
+public:
+    MappedFile() : m_fd(-1), m_data(nullptr), m_size(0), m_writable(false)
+    {
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+
+    bool open_read(const std::string& path)
+    {
+        return open(path, false);
+    }
+
+
+    // an existing file, for reading and writing in place
+    bool open_write(const std::string& path)
+    {
+        return open(path, true);
+    }
+
+
+    bool open(const std::string& path, bool writable)
+    {
+        struct stat info;
+
+        close();
+        m_writable = writable;
+        m_fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+
+        if (m_fd < 0)
+            return fail("can't open", path);
+
+        if (fstat(m_fd, &info) != 0)
+            return fail("can't stat", path);
+
+        m_size = static_cast<size_t>(info.st_size);
+
+        return map(path);
+    }
+
+
+    // creates (or truncates) path and sizes it to size bytes, which read as zero until written
+    bool create(const std::string& path, size_t size)
+    {
+        close();
+        m_writable = true;
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+        if (m_fd < 0)
+            return fail("can't create", path);
+
+        if (ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+            return fail("can't size", path);
+
+        m_size = size;
+
+        return map(path);
+    }
+
+
+    void close()
+    {
+        if (m_data != nullptr)
+            munmap(m_data, m_size);
+
+        if (m_fd >= 0)
+            ::close(m_fd);
+
+        m_fd = -1;
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+
+    uint8_t* data()
+    {
+        return m_data;
+    }
+
+
+    const uint8_t* data() const
+    {
+        return m_data;
+    }
+
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+
+    const std::string& error() const
+    {
+        return m_error;
+    }
+
+
+    // the file will be read front to back: more aggressive readahead, pages dropped behind
+    void advise_sequential() const
+    {
+        if (m_data != nullptr)
+            madvise(m_data, m_size, MADV_SEQUENTIAL);
+    }
+
+
+    // starts reading a range in ahead of use
+    void prefetch(size_t offset, size_t length) const
+    {
+        uint8_t* start;
+        size_t bytes;
+
+        if (page_range(offset, length, start, bytes))
+            madvise(start, bytes, MADV_WILLNEED);
+    }
+
+
+    // done with a range: its pages leave this mapping (written ones stay in the page cache and
+    // reach the file as usual)
+    void release(size_t offset, size_t length) const
+    {
+        uint8_t* start;
+        size_t bytes;
+
+        if (page_range(offset, length, start, bytes))
+            madvise(start, bytes, MADV_DONTNEED);
+    }
+
+
+    // writes a range back to the file: starts it, or with wait, returns once it is on disk
+    bool flush(size_t offset, size_t length, bool wait) const
+    {
+        uint8_t* start;
+        size_t bytes;
+
+        if (!page_range(offset, length, start, bytes))
+            return true;
+
+        return msync(start, bytes, wait ? MS_SYNC : MS_ASYNC) == 0;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end MappedFile.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,459 @@
+/*-----------------------------------------------------------------------------
+ * PackedWords.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+
+/*
+ * Helpers for bits packed into arrays of 64-bit words. Bit i lives in word i / 64, at
+ * bit i % 64 of that word (first bit is LSB, same as std::bitset). The batch encode/decode
+ * paths work on these directly so they don't have to go through a bitset per codeword
+ */
+constexpr size_t WORD_BITS = 64;
+
+
+constexpr size_t word_count(size_t bits)
+{
+    return (bits + WORD_BITS - 1) / WORD_BITS;
+}
+
+
+// mask with the lowest n bits set (n may be a full 64)
+constexpr uint64_t low_bits_mask(size_t n)
+{
+    return n >= WORD_BITS ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+}
+
+
+inline size_t popcount64(uint64_t word)
+{
+    // bitset::count compiles down to a popcount instruction where one is available
+    return std::bitset<64>(word).count();
+}
+
+
+inline bool parity64(uint64_t word)
+{
+    return (popcount64(word) & 1) != 0;
+}
+
+
+// index of the lowest set bit; word must not be 0
+inline size_t lowest_bit_index(uint64_t word)
+{
+    return popcount64((word & (~word + 1)) - 1);
+}
+
+
+inline bool words_parity(const uint64_t* words, size_t count)
+{
+    uint64_t acc = 0;
+
+    for (size_t i = 0; i < count; ++i)
+        acc ^= words[i];
+
+    return parity64(acc);
+}
+
+
+inline bool test_word_bit(const uint64_t* words, size_t idx)
+{
+    return ((words[idx / WORD_BITS] >> (idx % WORD_BITS)) & 1) != 0;
+}
+
+
+inline void flip_word_bit(uint64_t* words, size_t idx)
+{
+    words[idx / WORD_BITS] ^= uint64_t(1) << (idx % WORD_BITS);
+}
+
+
+inline void assign_word_bit(uint64_t* words, size_t idx, bool value)
+{
+    const auto mask = uint64_t(1) << (idx % WORD_BITS);
+
+    words[idx / WORD_BITS] = value ? words[idx / WORD_BITS] | mask : words[idx / WORD_BITS] & ~mask;
+}
+
+
+// on buffers of one word, words[word + 1] below is only reached for bits straddling a word
+// boundary, which don't exist there. GCC can't see that through a runtime offset and warns
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#endif
+
+// reads len (<= 64) bits starting at bit offset; result is right-aligned
+inline uint64_t read_word_bits(const uint64_t* words, size_t offset, size_t len)
+{
+    const auto word = offset / WORD_BITS;
+    const auto shift = offset % WORD_BITS;
+
+    auto value = words[word] >> shift;
+
+    // value straddles two words
+    if (shift != 0 && shift + len > WORD_BITS)
+        value |= words[word + 1] << (WORD_BITS - shift);
+
+    return value & low_bits_mask(len);
+}
+
+
+// overwrites len (<= 64) bits starting at bit offset with the low bits of value
+inline void write_word_bits(uint64_t* words, size_t offset, size_t len, uint64_t value)
+{
+    const auto word = offset / WORD_BITS;
+    const auto shift = offset % WORD_BITS;
+    const auto mask = low_bits_mask(len);
+
+    value &= mask;
+
+    words[word] = (words[word] & ~(mask << shift)) | (value << shift);
+
+    if (shift != 0 && shift + len > WORD_BITS)
+    {
+        const auto spill = WORD_BITS - shift;
+
+        words[word + 1] = (words[word + 1] & ~(mask >> spill)) | (value >> spill);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+
+// copies len bits from src (starting at bit src_offset) into dst (starting at bit dst_offset)
+inline void copy_word_bits(uint64_t* dst, size_t dst_offset, const uint64_t* src, size_t src_offset, size_t len)
+{
+    while (len > 0)
+    {
+        const auto n = len < WORD_BITS ? len : WORD_BITS;
+
+        write_word_bits(dst, dst_offset, n, read_word_bits(src, src_offset, n));
+
+        dst_offset += n;
+        src_offset += n;
+        len -= n;
+    }
+}
+
+
+// dst = src << 1 over count words, shifting carry_in into bit 0. Returns the bit shifted out of the top
+inline bool shift_words_left_1(uint64_t* dst, const uint64_t* src, size_t count, bool carry_in)
+{
+    uint64_t carry = carry_in ? 1 : 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto next = src[i] >> (WORD_BITS - 1);
+
+        dst[i] = (src[i] << 1) | carry;
+        carry = next;
+    }
+
+    return carry != 0;
+}
+
+
+// dst = src >> 1 over count words, shifting carry_in into the top bit of the last word
+inline void shift_words_right_1(uint64_t* dst, const uint64_t* src, size_t count, bool carry_in = false)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint64_t next = i + 1 < count ? src[i + 1] & 1 : (carry_in ? 1 : 0);
+
+        dst[i] = (src[i] >> 1) | (next << (WORD_BITS - 1));
+    }
+}
+
+
+// transposes a 64 x 64 bit matrix in place: bit c of rows[r] ends up as bit r of rows[c].
+// Used to turn 64 packed words into 64 bit slices (one word per bit position) and back
+inline void transpose64(uint64_t* rows)
+{
+    uint64_t mask = 0x00000000FFFFFFFFull;
+
+    for (size_t width = 32; width != 0; width >>= 1, mask ^= mask << width)
+    {
+        // swap the off-diagonal width x width blocks of every 2 * width x 2 * width block
+        for (size_t k = 0; k < 64; k = ((k | width) + 1) & ~width)
+        {
+            const auto t = ((rows[k] >> width) ^ rows[k | width]) & mask;
+
+            rows[k] ^= t << width;
+            rows[k | width] ^= t;
+        }
+    }
+}
+
+
+inline bool host_is_little_endian()
+{
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+    return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#else
+    const uint16_t probe = 1;
+
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+#endif
+}
+
+
+// clears the bits of the last (partial) byte of a length_bits long buffer that lie past its end
+inline void mask_tail_byte(uint8_t* bytes, size_t length_bits)
+{
+    if (length_bits % 8 != 0)
+        bytes[length_bits / 8] &= static_cast<uint8_t>((1u << (length_bits % 8)) - 1);
+}
+
+
+// conversion between bytes (first bit is LSB of the first byte) and packed words. On little endian
+// hosts these are the same layout in memory, so it's a straight copy
+inline void bytes_to_words(const uint8_t* buf, size_t length_bits, uint64_t* words)
+{
+    const auto num_bytes = (length_bits + 7) / 8;
+
+    memset(words, 0, word_count(length_bits) * sizeof(uint64_t));
+
+    if (host_is_little_endian())
+    {
+        memcpy(words, buf, num_bytes);
+    } else
+    {
+        for (size_t i = 0; i < num_bytes; ++i)
+            words[i / 8] |= static_cast<uint64_t>(buf[i]) << (8 * (i % 8));
+    }
+
+    if (length_bits % WORD_BITS != 0)
+        words[length_bits / WORD_BITS] &= low_bits_mask(length_bits % WORD_BITS);
+}
+
+
+// writes ceil(length_bits / 8) bytes; bits past length_bits in the last byte are zero
+inline void words_to_bytes(const uint64_t* words, size_t length_bits, uint8_t* buf)
+{
+    const auto num_bytes = (length_bits + 7) / 8;
+
+    if (host_is_little_endian())
+    {
+        memcpy(buf, words, num_bytes);
+    } else
+    {
+        for (size_t i = 0; i < num_bytes; ++i)
+            buf[i] = static_cast<uint8_t>(words[i / 8] >> (8 * (i % 8)));
+    }
+
+    mask_tail_byte(buf, length_bits);
+}
+
+
+/*
+ * std::bitset has no word access, but every mainstream implementation (libstdc++, libc++, MSVC)
+ * stores it as an array of words with the first bit at the LSB of the first word. On a little
+ * endian host that is exactly the byte layout used above, which lets conversions be a memcpy
+ * instead of a loop over single bits. Verified once per Size; when it doesn't hold (e.g. big
+ * endian) the conversions below fall back to portable word-at-a-time bitset operations
+ */
+template <size_t Size>
+bool bitset_is_byte_packed()
+{
+    static const bool packed = []
+    {
+        if (!host_is_little_endian() || sizeof(std::bitset<Size>) < (Size + 7) / 8)
+            return false;
+
+        const size_t probes[] = { 0, 1, 7, 8, 31, 32, 63, 64, 65, Size - 1 };
+        uint8_t bytes[sizeof(std::bitset<Size>)];
+
+        for (const auto probe : probes)
+        {
+            if (probe >= Size)
+                continue;
+
+            std::bitset<Size> bits;
+            bits.set(probe);
+            memcpy(bytes, &bits, sizeof(bytes));
+
+            for (size_t i = 0; i < sizeof(bytes); ++i)
+                if (bytes[i] != (i == probe / 8 ? 1u << (probe % 8) : 0u))
+                    return false;
+        }
+
+        return true;
+    }();
+
+    return packed;
+}
+
+
+// conversion between a bitset and its packed word form (exactly word_count(Size) words).
+// Unused high bits of the last word are ignored on input and written as zero
+template <size_t Size>
+void bitset_to_words(const std::bitset<Size>& bits, uint64_t* words)
+{
+    if (bitset_is_byte_packed<Size>())
+    {
+        memset(words, 0, word_count(Size) * sizeof(uint64_t));
+        memcpy(words, &bits, (Size + 7) / 8);
+        return;
+    }
+
+    const std::bitset<Size> low_word(~uint64_t(0));
+
+    for (size_t i = 0; i < word_count(Size); ++i)
+        words[i] = ((bits >> (i * WORD_BITS)) & low_word).to_ullong();
+}
+
+
+template <size_t Size>
+std::bitset<Size> words_to_bitset(const uint64_t* words)
+{
+    std::bitset<Size> bits;
+
+    if (bitset_is_byte_packed<Size>())
+    {
+        memcpy(static_cast<void*>(&bits), words, (Size + 7) / 8);
+        mask_tail_byte(reinterpret_cast<uint8_t*>(&bits), Size);
+        return bits;
+    }
+
+    // highest word first, so every word ends up shifted into place
+    for (size_t i = word_count(Size); i-- > 0;)
+    {
+        bits <<= WORD_BITS;
+        bits |= std::bitset<Size>(words[i]);
+    }
+
+    return bits;
+}
+
+
+// storage word index word of a byte packed bitset, read / written with one fixed size copy (a
+// plain load or store) except for a short last word
+template <size_t Size>
+uint64_t load_bitset_word(const std::bitset<Size>& bits, size_t word)
+{
+    constexpr auto BYTES = sizeof(std::bitset<Size>);
+    const auto src = reinterpret_cast<const uint8_t*>(&bits) + word * sizeof(uint64_t);
+    uint64_t value = 0;
+
+    if ((word + 1) * sizeof(uint64_t) <= BYTES)
+        memcpy(&value, src, sizeof(uint64_t));
+    else
+        memcpy(&value, src, BYTES - word * sizeof(uint64_t));
+
+    return value;
+}
+
+
+template <size_t Size>
+void store_bitset_word(std::bitset<Size>& bits, size_t word, uint64_t value)
+{
+    constexpr auto BYTES = sizeof(std::bitset<Size>);
+    const auto dst = reinterpret_cast<uint8_t*>(&bits) + word * sizeof(uint64_t);
+
+    if ((word + 1) * sizeof(uint64_t) <= BYTES)
+        memcpy(dst, &value, sizeof(uint64_t));
+    else
+        memcpy(dst, &value, BYTES - word * sizeof(uint64_t));
+}
+
+
+// reads len (<= 64) bits of a bitset starting at bit offset; result is right-aligned
+template <size_t Size>
+uint64_t read_bitset_bits(const std::bitset<Size>& bits, size_t offset, size_t len)
+{
+    if (bitset_is_byte_packed<Size>())
+    {
+        const auto word = offset / WORD_BITS;
+        const auto shift = offset % WORD_BITS;
+
+        auto value = load_bitset_word(bits, word) >> shift;
+
+        if (shift != 0 && shift + len > WORD_BITS)
+            value |= load_bitset_word(bits, word + 1) << (WORD_BITS - shift);
+
+        return value & low_bits_mask(len);
+    }
+
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < len; ++i)
+        value |= uint64_t(bits[offset + i]) << i;
+
+    return value;
+}
+
+
+// flips the bits of a bitset starting at bit offset where the low len (<= 64) bits of mask are set
+template <size_t Size>
+void flip_bitset_bits(std::bitset<Size>& bits, size_t offset, size_t len, uint64_t mask)
+{
+    mask &= low_bits_mask(len);
+
+    if (bitset_is_byte_packed<Size>())
+    {
+        const auto word = offset / WORD_BITS;
+        const auto shift = offset % WORD_BITS;
+
+        store_bitset_word(bits, word, load_bitset_word(bits, word) ^ (mask << shift));
+
+        if (shift != 0 && shift + len > WORD_BITS)
+            store_bitset_word(bits, word + 1, load_bitset_word(bits, word + 1) ^ (mask >> (WORD_BITS - shift)));
+
+        return;
+    }
+
+    for (; mask != 0; mask &= mask - 1)
+        bits.flip(offset + lowest_bit_index(mask));
+}
+
+
+// conversion between a bitset and bytes. bytes_to_bitset reads ceil(length_bits / 8) bytes
+// (length_bits <= Size); bitset_to_bytes writes num_bytes (<= ceil(Size / 8)) bytes
+template <size_t Size>
+std::bitset<Size> bytes_to_bitset(const uint8_t* buf, size_t length_bits)
+{
+    std::bitset<Size> bits;
+
+    if (bitset_is_byte_packed<Size>())
+    {
+        memcpy(static_cast<void*>(&bits), buf, (length_bits + 7) / 8);
+        mask_tail_byte(reinterpret_cast<uint8_t*>(&bits), length_bits);
+        return bits;
+    }
+
+    uint64_t words[word_count(Size)];
+
+    bytes_to_words(buf, length_bits, words);
+    memset(words + word_count(length_bits), 0, (word_count(Size) - word_count(length_bits)) * sizeof(uint64_t));
+
+    return words_to_bitset<Size>(words);
+}
+
+
+template <size_t Size>
+void bitset_to_bytes(const std::bitset<Size>& bits, uint8_t* buf, size_t num_bytes)
+{
+    if (bitset_is_byte_packed<Size>())
+    {
+        memcpy(buf, &bits, num_bytes);
+        return;
+    }
+
+    uint64_t words[word_count(Size)];
+    uint8_t bytes[(Size + 7) / 8];
+
+    bitset_to_words(bits, words);
+    words_to_bytes(words, Size, bytes);
+    memcpy(buf, bytes, num_bytes);
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end PackedWords.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -3,6 +3,8 @@
  *---------------------------------------------------------------------------*/
 #pragma once
 #include <bitset>
+#include <array>
+#include <algorithm>
 #include "CorrectionStrategy.h"
 
 
@@ -10,9 +12,14 @@ template <size_t NumDataBits>
 // ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
 class ParityBit: public CorrectionStrategy<NumDataBits, NumDataBits + 1>
 {
+    typedef CorrectionStrategy<NumDataBits, NumDataBits + 1> Strategy_t;
     typedef typename CorrectionStrategy<NumDataBits, NumDataBits + 1>::DecodeResult DecodeResult;
 
 public:
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+    using Strategy_t::LAST_DATA_WORD_MASK;
+    using Strategy_t::LAST_STORED_WORD_MASK;
 
     // given a piece of data (in terms of bits), encodes data with parity bit
     std::bitset<NumDataBits + 1> encode(const typename CorrectionStrategy<NumDataBits, NumDataBits + 1>::DataBits& data) const override
@@ -47,11 +54,81 @@ public:
 
         // no error correction, so stored data is also returned data
         // just need to remove the parity bit that was added as LSB
-        for (size_t i = 1; i < storedData.size(); ++i)
-            result.decoded_bits[i - 1] = storedData[i];
+        result.decoded_bits = BitStream<NumDataBits>::convert_bitset_to_bitset(storedData >> 1);
 
         return result;
     }
+
+
+    CompactDecodeResult<NumDataBits> decode_compact(
+        const typename CorrectionStrategy<NumDataBits, NumDataBits + 1>::StoredBits& storedData) const override
+    {
+        CompactDecodeResult<NumDataBits> result;
+
+        // the syndrome of a single parity check is just the failing check itself
+        result.syndrome = storedData.count() % 2;
+        result.status = result.syndrome != 0 ? DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE : DECODE_CLEAN;
+        result.decoded_bits = BitStream<NumDataBits>::convert_bitset_to_bitset(storedData >> 1);
+
+        return result;
+    }
+
+
+    // data bit i is stored bit i + 1; the parity bit flips once per changed bit
+    uint8_t update(typename Strategy_t::StoredBits& stored, size_t bit_offset, uint64_t old_bits, uint64_t new_bits, size_t length) const override
+    {
+        assert(length <= WORD_BITS && bit_offset + length <= NumDataBits);
+
+        const auto delta = (old_bits ^ new_bits) & low_bits_mask(length);
+
+        flip_bitset_bits(stored, 1 + bit_offset, length, delta);
+        flip_bitset_bits(stored, 0, 1, parity64(delta));
+
+        return DECODE_CLEAN;
+    }
+
+
+    // same layout as encode(): data shifted up one bit, parity bit at LSB
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        std::array<uint64_t, DATA_WORD_COUNT> bits;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto in = data + i * DATA_WORD_COUNT;
+            const auto out = encoded + i * STORED_WORD_COUNT;
+
+            std::copy(in, in + DATA_WORD_COUNT, bits.begin());
+            bits.back() &= LAST_DATA_WORD_MASK;
+
+            const auto top = shift_words_left_1(out, bits.data(), DATA_WORD_COUNT, words_parity(bits.data(), DATA_WORD_COUNT));
+
+            // data filled its last word exactly, so the top bit spills into a word of its own
+            if (STORED_WORD_COUNT > DATA_WORD_COUNT)
+                out[STORED_WORD_COUNT - 1] = top ? 1 : 0;
+        }
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        std::array<uint64_t, STORED_WORD_COUNT> bits;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto in = encoded + i * STORED_WORD_COUNT;
+            const auto out = data + i * DATA_WORD_COUNT;
+
+            std::copy(in, in + STORED_WORD_COUNT, bits.begin());
+            bits.back() &= LAST_STORED_WORD_MASK;
+
+            // no error correction: drop the parity bit and report whether the parity check failed
+            shift_words_right_1(out, bits.data(), DATA_WORD_COUNT, STORED_WORD_COUNT > DATA_WORD_COUNT && (bits.back() & 1) != 0);
+            out[DATA_WORD_COUNT - 1] &= LAST_DATA_WORD_MASK;
+
+            status[i] = words_parity(bits.data(), STORED_WORD_COUNT) ? DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE : DECODE_CLEAN;
+        }
+    }
 };
 
 /*/////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,568 @@
+/*-----------------------------------------------------------------------------
+ * ReedSolomon.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include "CorrectionStrategy.h"
+#include "Chunk.h"
+#include "GaloisField.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// g(x) = (x + alpha^0)(x + alpha^1)...(x + alpha^(CheckSymbols - 1)); entry j is the
+// coefficient of x^j, the last one (x^CheckSymbols) is 1
+template <size_t CheckSymbols>
+constexpr std::array<uint8_t, CheckSymbols + 1> make_rs_generator()
+{
+    std::array<uint8_t, CheckSymbols + 1> g{};
+    uint8_t root = 1;
+
+    g[0] = 1;
+
+    for (size_t i = 0; i < CheckSymbols; ++i)
+    {
+        // g *= (x + root)
+        for (size_t j = i + 1; j > 0; --j)
+            g[j] = g[j - 1] ^ gf256_mul_slow(g[j], root, GF256::PRIMITIVE_POLY);
+
+        g[0] = gf256_mul_slow(g[0], root, GF256::PRIMITIVE_POLY);
+        root = gf256_mul_slow(root, 2, GF256::PRIMITIVE_POLY);
+    }
+
+    return g;
+}
+
+
+// systematic parity of every data symbol on its own: entry [j][i] is what data symbol i adds to
+// check symbol j, i.e. the coefficient of x^(CheckSymbols - 1 - j) in x^(N - 1 - i) mod g(x).
+// The code is linear, so a parity symbol is the sum of these times the data
+template <size_t N, size_t K>
+constexpr std::array<std::array<uint8_t, K>, N - K> make_rs_parity_matrix()
+{
+    constexpr size_t R = N - K;
+
+    const auto g = make_rs_generator<R>();
+    std::array<std::array<uint8_t, K>, R> matrix{};
+
+    // remainder of x^d mod g, coefficient of x^j at [j]; starts at d = R - 1
+    std::array<uint8_t, R> rem{};
+    rem[R - 1] = 1;
+
+    for (size_t d = R; d < N; ++d)
+    {
+        // rem = x * rem mod g; x^R = sum of g_j x^j below R in GF(2^m)
+        const auto carry = rem[R - 1];
+
+        for (size_t j = R - 1; j > 0; --j)
+            rem[j] = rem[j - 1] ^ gf256_mul_slow(carry, g[j], GF256::PRIMITIVE_POLY);
+
+        rem[0] = gf256_mul_slow(carry, g[0], GF256::PRIMITIVE_POLY);
+
+        const auto i = N - 1 - d;
+
+        for (size_t j = 0; j < R; ++j)
+            matrix[j][i] = rem[R - 1 - j];
+    }
+
+    return matrix;
+}
+
+
+/*
+ * Reed-Solomon code RS(N, K) over GF(2^8): K data bytes, N - K check bytes, corrects any
+ * (N - K) / 2 bad bytes however many bits in them are wrong, so a burst of up to
+ * 8 * ((N - K) / 2 - 1) + 1 bits is always fixed. E.g. RS(255, 223) (16 symbols) for storage
+ * blocks, RS(10, 8) for a 64 bit word.
+ *
+ * Systematic, symbol s is bits 8s..8s+7 of the data / codeword (same as bytes of a BitStream):
+ * the data bytes are stored as is and the check bytes follow. As a polynomial, symbol s is the
+ * coefficient of x^(N - 1 - s), and codewords are multiples of g(x), whose roots are
+ * alpha^0..alpha^(N - K - 1).
+ *
+ * Decoding computes the N - K syndromes; all zero means clean. Otherwise Berlekamp-Massey finds
+ * the error locator, a Chien search its roots (the error positions), and Forney's formula the
+ * error values. Fewer roots than the locator's degree means more errors than can be corrected.
+ *
+ * The batch paths transpose STRIPE codewords into symbol columns (all first symbols, all
+ * second symbols, ...) and do encoding and syndromes as column operations, using the split
+ * nibble region multiply of GF256, which vectorizes. Only codewords with a non-zero syndrome
+ * go on to the (scalar) locator search
+ */
+template <size_t N, size_t K>
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class ReedSolomon : public CorrectionStrategy<K * 8, N * 8>
+{
+    static_assert(K > 0 && K < N && N <= GF256::ORDER, "RS(N, K) over GF(2^8) needs 0 < K < N <= 255");
+
+    // nibble tables of PARITY_MATRIX, [i * CHECK_SYMBOL_COUNT + j] for data symbol i and check
+    // symbol j, and of alpha^i for syndrome i. Built on first use and shared after that
+    static const std::vector<GF256::NibbleTable>& parity_tables()
+    {
+        static const std::vector<GF256::NibbleTable> tables = []
+        {
+            std::vector<GF256::NibbleTable> t(K * (N - K));
+
+            for (size_t i = 0; i < K; ++i)
+                for (size_t j = 0; j < N - K; ++j)
+                    t[i * (N - K) + j] = GF256::nibble_table(PARITY_MATRIX[j][i]);
+
+            return t;
+        }();
+
+        return tables;
+    }
+
+
+    static const std::vector<GF256::NibbleTable>& syndrome_tables()
+    {
+        static const std::vector<GF256::NibbleTable> tables = []
+        {
+            std::vector<GF256::NibbleTable> t(N - K);
+
+            for (size_t i = 0; i < N - K; ++i)
+                t[i] = GF256::nibble_table(GF256::exp(i));
+
+            return t;
+        }();
+
+        return tables;
+    }
+
+
+public:
+    static constexpr size_t SYMBOL_BITS = 8;
+    static constexpr size_t SYMBOL_COUNT = N;
+    static constexpr size_t DATA_SYMBOL_COUNT = K;
+    static constexpr size_t CHECK_SYMBOL_COUNT = N - K;
+    static constexpr size_t CORRECTABLE_SYMBOLS = CHECK_SYMBOL_COUNT / 2;
+
+    static constexpr size_t DATA_BIT_COUNT = K * SYMBOL_BITS;
+    static constexpr size_t CHECK_BIT_COUNT = CHECK_SYMBOL_COUNT * SYMBOL_BITS;
+    static constexpr size_t TOTAL_BIT_COUNT = N * SYMBOL_BITS;
+
+    static constexpr size_t STRIPE = 256;      // codewords per block in the batch paths
+    static constexpr size_t COLUMN_TILE = 512; // bytes per column per pass in the column kernels
+
+    typedef std::bitset<TOTAL_BIT_COUNT> StoredDataBits_t;
+    typedef DecodeResult<DATA_BIT_COUNT, TOTAL_BIT_COUNT> DecodeResult_t;
+    typedef Chunk<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Chunk_t;
+
+    typedef CorrectionStrategy<DATA_BIT_COUNT, TOTAL_BIT_COUNT> Strategy_t;
+    using Strategy_t::DATA_WORD_COUNT;
+    using Strategy_t::STORED_WORD_COUNT;
+
+    static constexpr auto GENERATOR = make_rs_generator<CHECK_SYMBOL_COUNT>();
+    static constexpr auto PARITY_MATRIX = make_rs_parity_matrix<N, K>();
+
+
+    // single codeword kernels, on symbols (bytes)
+    static void encode_symbols(const uint8_t* data, uint8_t* codeword)
+    {
+        uint8_t* parity = codeword + K;
+
+        std::copy(data, data + K, codeword);
+        std::fill(parity, parity + CHECK_SYMBOL_COUNT, 0);
+
+        // LFSR division by g: parity holds the running remainder, highest degree first
+        for (size_t i = 0; i < K; ++i)
+        {
+            const uint8_t feedback = data[i] ^ parity[0];
+
+            std::copy(parity + 1, parity + CHECK_SYMBOL_COUNT, parity);
+            parity[CHECK_SYMBOL_COUNT - 1] = 0;
+
+            if (feedback == 0)
+                continue;
+
+            const auto row = GF256::mul_row(feedback);
+
+            for (size_t j = 0; j < CHECK_SYMBOL_COUNT; ++j)
+                parity[j] ^= row[GENERATOR[CHECK_SYMBOL_COUNT - 1 - j]];
+        }
+    }
+
+
+    // S_i = c(alpha^i); returns whether any is non-zero
+    static bool compute_syndromes(const uint8_t* codeword, uint8_t* syndromes)
+    {
+        const uint8_t* rows[CHECK_SYMBOL_COUNT];
+        uint8_t any = 0;
+
+        for (size_t i = 0; i < CHECK_SYMBOL_COUNT; ++i)
+        {
+            rows[i] = GF256::mul_row(GF256::exp(i));
+            syndromes[i] = codeword[0];
+        }
+
+        // Horner, S_i = S_i * alpha^i + c_k, all syndromes side by side so they don't wait on
+        // each other's lookups
+        for (size_t k = 1; k < N; ++k)
+            for (size_t i = 0; i < CHECK_SYMBOL_COUNT; ++i)
+                syndromes[i] = rows[i][syndromes[i]] ^ codeword[k];
+
+        for (size_t i = 0; i < CHECK_SYMBOL_COUNT; ++i)
+            any |= syndromes[i];
+
+        return any != 0;
+    }
+
+
+    // finds the errors behind non-zero syndromes: symbol indices and the values to XOR in.
+    // Returns DECODE_CORRECTED or DECODE_UNCORRECTABLE (with DECODE_ERROR_DETECTED)
+    static uint8_t locate_errors(const uint8_t* syndromes, size_t* positions, uint8_t* values, size_t& count)
+    {
+        constexpr size_t R = CHECK_SYMBOL_COUNT;
+
+        const uint8_t failed = DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
+
+        // Berlekamp-Massey: shortest LFSR lambda generating the syndromes
+        std::array<uint8_t, R + 1> lambda{};
+        std::array<uint8_t, R + 1> prev{};
+        std::array<uint8_t, R + 1> temp{};
+        size_t degree = 0;
+        size_t shift = 1;
+        uint8_t prev_discrepancy = 1;
+
+        lambda[0] = 1;
+        prev[0] = 1;
+
+        for (size_t r = 0; r < R; ++r)
+        {
+            uint8_t discrepancy = syndromes[r];
+
+            for (size_t i = 1; i <= degree; ++i)
+                discrepancy ^= GF256::mul(lambda[i], syndromes[r - i]);
+
+            if (discrepancy == 0)
+            {
+                ++shift;
+                continue;
+            }
+
+            const auto scale = GF256::div(discrepancy, prev_discrepancy);
+
+            temp = lambda;
+
+            for (size_t i = shift; i <= R; ++i)
+                lambda[i] ^= GF256::mul(scale, prev[i - shift]);
+
+            if (2 * degree <= r)
+            {
+                degree = r + 1 - degree;
+                prev = temp;
+                prev_discrepancy = discrepancy;
+                shift = 1;
+            } else
+                ++shift;
+        }
+
+        if (degree > CORRECTABLE_SYMBOLS)
+            return failed;
+
+        // Chien search: symbol k (power e = N - 1 - k) is bad when lambda(alpha^-e) = 0
+        count = 0;
+
+        for (size_t k = 0; k < N && count < degree; ++k)
+        {
+            const auto inverse_log = GF256::ORDER - (N - 1 - k);   // log of alpha^-e
+            uint8_t sum = 0;
+
+            for (size_t i = 0; i <= degree; ++i)
+                if (lambda[i] != 0)
+                    sum ^= GF256::EXP[(GF256::LOG[lambda[i]] + inverse_log * i) % GF256::ORDER];
+
+            if (sum == 0)
+                positions[count++] = k;
+        }
+
+        // a root outside the (possibly shortened) codeword: too many errors
+        if (count != degree)
+            return failed;
+
+        // Forney: omega = S * lambda mod x^R, value = X * omega(X^-1) / lambda'(X^-1)
+        std::array<uint8_t, R> omega{};
+
+        for (size_t i = 0; i < R; ++i)
+            for (size_t j = 0; j <= std::min(i, degree); ++j)
+                omega[i] ^= GF256::mul(syndromes[i - j], lambda[j]);
+
+        for (size_t n = 0; n < count; ++n)
+        {
+            const auto power = N - 1 - positions[n];
+            const auto inverse_log = (GF256::ORDER - power) % GF256::ORDER;
+            uint8_t numerator = 0;
+            uint8_t denominator = 0;
+
+            for (size_t i = 0; i < R; ++i)
+                if (omega[i] != 0)
+                    numerator ^= GF256::EXP[(GF256::LOG[omega[i]] + inverse_log * i) % GF256::ORDER];
+
+            // formal derivative: only the odd terms survive in characteristic 2
+            for (size_t i = 1; i <= degree; i += 2)
+                if (lambda[i] != 0)
+                    denominator ^= GF256::EXP[(GF256::LOG[lambda[i]] + inverse_log * (i - 1)) % GF256::ORDER];
+
+            if (denominator == 0)
+                return failed;
+
+            values[n] = GF256::mul(GF256::exp(power), GF256::div(numerator, denominator));
+
+            if (values[n] == 0)
+                return failed;
+        }
+
+        return DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+    }
+
+
+    // corrects codeword in place; corrupt_bits receives the number of bits that were flipped back
+    static uint8_t decode_symbols(uint8_t* codeword, size_t& corrupt_bits)
+    {
+        uint8_t syndromes[CHECK_SYMBOL_COUNT];
+
+        return decode_symbols(codeword, syndromes, corrupt_bits);
+    }
+
+
+    // as above, also hands back the CHECK_SYMBOL_COUNT syndromes
+    static uint8_t decode_symbols(uint8_t* codeword, uint8_t* syndromes, size_t& corrupt_bits)
+    {
+        corrupt_bits = 0;
+
+        if (!compute_syndromes(codeword, syndromes))
+            return DECODE_CLEAN;
+
+        size_t positions[CORRECTABLE_SYMBOLS + 1];
+        uint8_t values[CORRECTABLE_SYMBOLS + 1];
+        size_t count = 0;
+
+        const auto status = locate_errors(syndromes, positions, values, count);
+
+        if (status & DECODE_CORRECTED)
+        {
+            for (size_t n = 0; n < count; ++n)
+            {
+                codeword[positions[n]] ^= values[n];
+                corrupt_bits += popcount64(values[n]);
+            }
+        }
+
+        return status;
+    }
+
+
+    /*
+     * Column (shard) form, as used by storage stripes: data[i] points at `length` bytes holding
+     * symbol i of `length` codewords, parity[j] receives check symbol j of each. Every check
+     * column is a sum of data columns times a constant (PARITY_MATRIX), which is what the region
+     * multiply is for. Works through the columns COLUMN_TILE bytes at a time, so the check
+     * columns being summed into stay in L1 while every data column streams through once
+     */
+    static void encode_columns(const uint8_t* const* data, uint8_t* const* parity, size_t length)
+    {
+        const auto& tables = parity_tables();
+
+        for (size_t first = 0; first < length; first += COLUMN_TILE)
+        {
+            const auto n = std::min(COLUMN_TILE, length - first);
+
+            for (size_t j = 0; j < CHECK_SYMBOL_COUNT; ++j)
+                GF256::region<false>(tables[j], data[0] + first, nullptr, parity[j] + first, n);
+
+            for (size_t i = 1; i < K; ++i)
+                for (size_t j = 0; j < CHECK_SYMBOL_COUNT; ++j)
+                    GF256::region<true>(tables[i * CHECK_SYMBOL_COUNT + j], data[i] + first, parity[j] + first, parity[j] + first, n);
+        }
+    }
+
+
+    // syndrome columns of the N codeword columns, by Horner's rule as in compute_syndromes:
+    // S_i = S_i * alpha^i + c_k, one region operation per (symbol, syndrome)
+    static void syndrome_columns(const uint8_t* const* codeword, uint8_t* const* syndromes, size_t length)
+    {
+        const auto& tables = syndrome_tables();
+
+        for (size_t first = 0; first < length; first += COLUMN_TILE)
+        {
+            const auto n = std::min(COLUMN_TILE, length - first);
+
+            for (size_t i = 0; i < CHECK_SYMBOL_COUNT; ++i)
+                std::copy(codeword[0] + first, codeword[0] + first + n, syndromes[i] + first);
+
+            for (size_t k = 1; k < N; ++k)
+                for (size_t i = 0; i < CHECK_SYMBOL_COUNT; ++i)
+                    GF256::region<true>(tables[i], syndromes[i] + first, codeword[k] + first, syndromes[i] + first, n);
+        }
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        std::vector<uint8_t> columns(N * STRIPE);
+        const uint8_t* data_columns[K];
+        uint8_t* parity_columns[CHECK_SYMBOL_COUNT];
+        uint8_t bytes[N];
+
+        for (size_t i = 0; i < K; ++i)
+            data_columns[i] = &columns[i * STRIPE];
+
+        for (size_t j = 0; j < CHECK_SYMBOL_COUNT; ++j)
+            parity_columns[j] = &columns[(K + j) * STRIPE];
+
+        for (size_t first = 0; first < count; first += STRIPE)
+        {
+            const auto block = std::min(STRIPE, count - first);
+
+            for (size_t b = 0; b < block; ++b)
+            {
+                words_to_bytes(data + (first + b) * DATA_WORD_COUNT, DATA_BIT_COUNT, bytes);
+
+                for (size_t i = 0; i < K; ++i)
+                    columns[i * STRIPE + b] = bytes[i];
+            }
+
+            encode_columns(data_columns, parity_columns, block);
+
+            for (size_t b = 0; b < block; ++b)
+            {
+                for (size_t s = 0; s < N; ++s)
+                    bytes[s] = columns[s * STRIPE + b];
+
+                bytes_to_words(bytes, TOTAL_BIT_COUNT, encoded + (first + b) * STORED_WORD_COUNT);
+            }
+        }
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        std::vector<uint8_t> columns((N + CHECK_SYMBOL_COUNT) * STRIPE);
+        const uint8_t* symbols[N];
+        uint8_t* syndromes[CHECK_SYMBOL_COUNT];
+        uint8_t bytes[N];
+
+        for (size_t s = 0; s < N; ++s)
+            symbols[s] = &columns[s * STRIPE];
+
+        for (size_t i = 0; i < CHECK_SYMBOL_COUNT; ++i)
+            syndromes[i] = &columns[(N + i) * STRIPE];
+
+        for (size_t first = 0; first < count; first += STRIPE)
+        {
+            const auto block = std::min(STRIPE, count - first);
+
+            for (size_t b = 0; b < block; ++b)
+            {
+                words_to_bytes(encoded + (first + b) * STORED_WORD_COUNT, TOTAL_BIT_COUNT, bytes);
+
+                for (size_t s = 0; s < N; ++s)
+                    columns[s * STRIPE + b] = bytes[s];
+            }
+
+            syndrome_columns(symbols, syndromes, block);
+
+            for (size_t b = 0; b < block; ++b)
+            {
+                uint8_t syndrome[CHECK_SYMBOL_COUNT];
+                uint8_t any = 0;
+
+                for (size_t i = 0; i < CHECK_SYMBOL_COUNT; ++i)
+                {
+                    syndrome[i] = syndromes[i][b];
+                    any |= syndrome[i];
+                }
+
+                for (size_t s = 0; s < K; ++s)
+                    bytes[s] = columns[s * STRIPE + b];
+
+                status[first + b] = DECODE_CLEAN;
+
+                if (any != 0)
+                {
+                    size_t positions[CORRECTABLE_SYMBOLS + 1];
+                    uint8_t values[CORRECTABLE_SYMBOLS + 1];
+                    size_t errors = 0;
+
+                    status[first + b] = locate_errors(syndrome, positions, values, errors);
+
+                    if (status[first + b] & DECODE_CORRECTED)
+                        for (size_t n = 0; n < errors; ++n)
+                            if (positions[n] < K)
+                                bytes[positions[n]] ^= values[n];
+                }
+
+                bytes_to_words(bytes, DATA_BIT_COUNT, data + (first + b) * DATA_WORD_COUNT);
+            }
+        }
+    }
+
+
+    StoredDataBits_t encode(const std::bitset<DATA_BIT_COUNT>& unencodedData) const override
+    {
+        uint8_t data[K];
+        uint8_t codeword[N];
+
+        bitset_to_bytes<DATA_BIT_COUNT>(unencodedData, data, K);
+        encode_symbols(data, codeword);
+
+        return bytes_to_bitset<TOTAL_BIT_COUNT>(codeword, TOTAL_BIT_COUNT);
+    }
+
+
+    DecodeResult_t decode(StoredDataBits_t storedData) const override
+    {
+        DecodeResult_t result;
+        uint8_t codeword[N];
+        size_t corrupt_bits;
+
+        bitset_to_bytes<TOTAL_BIT_COUNT>(storedData, codeword, N);
+
+        const auto status = decode_symbols(codeword, corrupt_bits);
+
+        result.decoded_bits = bytes_to_bitset<DATA_BIT_COUNT>(codeword, DATA_BIT_COUNT);
+        result.success = (status & DECODE_UNCORRECTABLE) == 0;
+        result.error_detected = (status & DECODE_ERROR_DETECTED) != 0;
+
+        if (result.success)
+        {
+            result.num_corrupt_bits = corrupt_bits;
+            result.num_corrected_bits = corrupt_bits;
+        } else
+        {
+            // more than CORRECTABLE_SYMBOLS bad symbols, so at least that many bad bits
+            result.num_corrupt_bits = CORRECTABLE_SYMBOLS + 1;
+            result.num_corrected_bits = 0;
+        }
+
+        return result;
+    }
+
+
+    // syndrome: the first and last syndrome symbols, S_0 | S_(N - K - 1) << 8
+    CompactDecodeResult<DATA_BIT_COUNT> decode_compact(const StoredDataBits_t& storedData) const override
+    {
+        CompactDecodeResult<DATA_BIT_COUNT> result;
+        uint8_t codeword[N];
+        size_t corrupt_bits;
+
+        uint8_t syndromes[CHECK_SYMBOL_COUNT];
+
+        bitset_to_bytes<TOTAL_BIT_COUNT>(storedData, codeword, N);
+
+        result.status = decode_symbols(codeword, syndromes, corrupt_bits);
+        result.syndrome = syndromes[0];
+
+        if (CHECK_SYMBOL_COUNT > 1)
+            result.syndrome |= static_cast<uint16_t>(syndromes[CHECK_SYMBOL_COUNT - 1] << 8);
+
+        result.decoded_bits = bytes_to_bitset<DATA_BIT_COUNT>(codeword, DATA_BIT_COUNT);
+
+        return result;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end ReedSolomon.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,459 @@
+/*-----------------------------------------------------------------------------
+ * RuntimeCode.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "PackedWords.h"
+#include "DecodeResult.h"
+#include "Chunk.h"
+#include "HammingCode.h"
+
+
+/*
+ * Codes whose width is a constructor argument rather than a template parameter, for picking
+ * the code size from configuration without a switch over template instantiations. They only
+ * have the packed word API (see CorrectionStrategy::encode_batch / decode_batch for the layout),
+ * and for a given width produce exactly the same codewords and statuses as the templates they
+ * mirror, so either can read what the other wrote.
+ *
+ * Everything that depends on the width is worked out in the constructor. Per codeword
+ * temporaries live on the stack, which caps the width at MAX_DATA_BITS
+ */
+class RuntimeCode
+{
+public:
+    static constexpr size_t MAX_DATA_BITS = 4096;
+    static constexpr size_t MAX_DATA_WORDS = word_count(MAX_DATA_BITS);
+    static constexpr size_t MAX_STORED_WORDS = word_count(MAX_DATA_BITS + 1 + calc_hamming_code_check_bits(MAX_DATA_BITS + 1));
+
+    // codes of up to this many data words get kernels with the word counts fixed at compile time
+    // (see RuntimeKernelSelect); wider ones read them at run time
+    static constexpr size_t SPECIALIZED_WORDS = 8;
+
+protected:
+    size_t m_data_bits;
+    size_t m_total_bits;
+    size_t m_data_words;
+    size_t m_stored_words;
+    uint64_t m_last_data_mask;
+    uint64_t m_last_stored_mask;
+
+
+    RuntimeCode(size_t data_bits, size_t total_bits)
+        : m_data_bits(data_bits),
+          m_total_bits(total_bits),
+          m_data_words(word_count(data_bits)),
+          m_stored_words(word_count(total_bits)),
+          m_last_data_mask(low_bits_mask(data_bits - (word_count(data_bits) - 1) * WORD_BITS)),
+          m_last_stored_mask(low_bits_mask(total_bits - (word_count(total_bits) - 1) * WORD_BITS))
+    {
+        assert(supports(data_bits));
+    }
+
+public:
+    virtual ~RuntimeCode() = default;
+
+
+    static bool supports(size_t data_bits)
+    {
+        return data_bits > 0 && data_bits <= MAX_DATA_BITS;
+    }
+
+
+    size_t data_bits() const { return m_data_bits; }
+    size_t total_bits() const { return m_total_bits; }
+    size_t check_bits() const { return m_total_bits - m_data_bits; }
+
+    // packed sizes of one data word / one codeword
+    size_t data_word_count() const { return m_data_words; }
+    size_t stored_word_count() const { return m_stored_words; }
+
+
+    virtual void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const = 0;
+
+    // status receives one DecodeStatus byte per codeword
+    virtual void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const = 0;
+
+
+    void encode_words(const uint64_t* data, uint64_t* encoded) const
+    {
+        encode_batch(data, 1, encoded);
+    }
+
+
+    uint8_t decode_words(const uint64_t* encoded, uint64_t* data) const
+    {
+        uint8_t status;
+
+        decode_batch(encoded, 1, data, &status);
+
+        return status;
+    }
+};
+
+
+/*
+ * Picks Code's batch kernels for its word counts: Code::kernels<DataWords, StoredWords>() when
+ * there are at most SPECIALIZED_WORDS data words, so that the per word loops have fixed trip
+ * counts and unroll like the templates' do, else Code::kernels<0, 0>(), which reads the counts
+ * from the code. The stored form is at most one word longer than the data
+ */
+template <class Code, size_t DataWords = 1>
+struct RuntimeKernelSelect
+{
+    static typename Code::Kernels_t pick(size_t data_words, size_t stored_words)
+    {
+        if (data_words != DataWords)
+            return RuntimeKernelSelect<Code, DataWords + 1>::pick(data_words, stored_words);
+
+        assert(stored_words == DataWords || stored_words == DataWords + 1);
+
+        return stored_words == DataWords ? Code::template kernels<DataWords, DataWords>() : Code::template kernels<DataWords, DataWords + 1>();
+    }
+};
+
+
+template <class Code>
+struct RuntimeKernelSelect<Code, RuntimeCode::SPECIALIZED_WORDS + 1>
+{
+    static typename Code::Kernels_t pick(size_t, size_t)
+    {
+        return Code::template kernels<0, 0>();
+    }
+};
+
+
+// ParityBit<N> with N picked at run time: data shifted up one bit, parity bit at LSB
+class RuntimeParityBit : public RuntimeCode
+{
+public:
+    struct Kernels_t
+    {
+        void (RuntimeParityBit::*encode)(const uint64_t*, size_t, uint64_t*) const;
+        void (RuntimeParityBit::*decode)(const uint64_t*, size_t, uint64_t*, uint8_t*) const;
+    };
+
+private:
+    template <class, size_t> friend struct RuntimeKernelSelect;
+
+    Kernels_t m_kernels;
+
+
+    template <size_t DW, size_t SW>
+    static Kernels_t kernels()
+    {
+        return { &RuntimeParityBit::encode_kernel<DW, SW>, &RuntimeParityBit::decode_kernel<DW, SW> };
+    }
+
+
+    // DW / SW: data / stored words, or 0 to use the code's
+    template <size_t DW, size_t SW>
+    void encode_kernel(const uint64_t* data, size_t count, uint64_t* encoded) const
+    {
+        const auto dw = DW != 0 ? DW : m_data_words;
+        const auto sw = SW != 0 ? SW : m_stored_words;
+        const auto last_mask = m_last_data_mask;
+
+        for (size_t i = 0; i < count; ++i, data += dw, encoded += sw)
+        {
+            // only the last data word needs masking, so it's shifted on its own rather than copying the data
+            const auto last = data[dw - 1] & last_mask;
+            const auto carry = shift_words_left_1(encoded, data, dw - 1, words_parity(data, dw - 1) != parity64(last));
+
+            encoded[dw - 1] = (last << 1) | (carry ? 1 : 0);
+
+            // data filled its last word exactly, so the top bit spills into a word of its own
+            if (sw > dw)
+                encoded[sw - 1] = last >> (WORD_BITS - 1);
+        }
+    }
+
+
+    template <size_t DW, size_t SW>
+    void decode_kernel(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const
+    {
+        const auto dw = DW != 0 ? DW : m_data_words;
+        const auto sw = SW != 0 ? SW : m_stored_words;
+        const auto last_data_mask = m_last_data_mask;
+        const auto last_stored_mask = m_last_stored_mask;
+
+        for (size_t i = 0; i < count; ++i, encoded += sw, data += dw)
+        {
+            // as in encode_kernel, only the last stored word is masked
+            const auto last = encoded[sw - 1] & last_stored_mask;
+
+            shift_words_right_1(data, encoded, sw - 1, (last & 1) != 0);
+
+            if (sw == dw)
+                data[dw - 1] = last >> 1;
+
+            data[dw - 1] &= last_data_mask;
+
+            status[i] = words_parity(encoded, sw - 1) != parity64(last) ? DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE : DECODE_CLEAN;
+        }
+    }
+
+public:
+    explicit RuntimeParityBit(size_t data_bits)
+        : RuntimeCode(data_bits, data_bits + 1),
+          m_kernels(RuntimeKernelSelect<RuntimeParityBit>::pick(m_data_words, m_stored_words))
+    {
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        (this->*m_kernels.encode)(data, count, encoded);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        (this->*m_kernels.decode)(encoded, count, data, status);
+    }
+};
+
+
+/*
+ * HammingCode<N> (extended, SEC-DED) with N picked at run time. The parity masks and syndrome
+ * table that HammingCode generates at compile time are built by the constructor, and so is the
+ * placement of the data bits: where HammingCode shifts the data up past the extended parity bit
+ * and copies its runs (which the compiler folds into fixed shifts), this splits the runs
+ * beforehand into pieces that lie within one data word and one stored word, each moved with a
+ * single shift and mask. The extended parity bit always sits at stored bit 2
+ */
+class RuntimeHammingCode : public RuntimeCode
+{
+public:
+    static constexpr uint32_t NO_POSITION = ~uint32_t(0);
+    static constexpr size_t EXTENDED_PARITY_POSITION = 2;
+
+    struct Kernels_t
+    {
+        void (RuntimeHammingCode::*encode)(const uint64_t*, size_t, uint64_t*) const;
+        void (RuntimeHammingCode::*decode)(const uint64_t*, size_t, uint64_t*, uint8_t*) const;
+    };
+
+private:
+    template <class, size_t> friend struct RuntimeKernelSelect;
+
+    // mask bits at data_shift of data word data_word are bits at stored_shift of stored word stored_word
+    struct Piece
+    {
+        uint64_t mask;
+        uint16_t data_word;
+        uint16_t stored_word;
+        uint8_t data_shift;
+        uint8_t stored_shift;
+    };
+
+    size_t m_check_bits;
+    std::vector<uint64_t> m_parity_masks;       // m_check_bits masks of m_stored_words words
+    std::vector<uint32_t> m_syndrome_table;
+    std::vector<Piece> m_pieces;
+    Kernels_t m_kernels;
+
+
+    template <size_t DW, size_t SW>
+    static Kernels_t kernels()
+    {
+        return { &RuntimeHammingCode::encode_kernel<DW, SW>, &RuntimeHammingCode::decode_kernel<DW, SW> };
+    }
+
+
+    // length data bits from data_offset are stored from stored_offset
+    void add_pieces(size_t data_offset, size_t stored_offset, size_t length)
+    {
+        while (length > 0)
+        {
+            const auto n = std::min({ length, WORD_BITS - data_offset % WORD_BITS, WORD_BITS - stored_offset % WORD_BITS });
+
+            m_pieces.push_back({ low_bits_mask(n), static_cast<uint16_t>(data_offset / WORD_BITS), static_cast<uint16_t>(stored_offset / WORD_BITS),
+                                 static_cast<uint8_t>(data_offset % WORD_BITS), static_cast<uint8_t>(stored_offset % WORD_BITS) });
+
+            data_offset += n;
+            stored_offset += n;
+            length -= n;
+        }
+    }
+
+
+    template <size_t SW>
+    size_t compute_syndrome(const uint64_t* stored) const
+    {
+        const auto sw = SW != 0 ? SW : m_stored_words;
+        const auto* mask = m_parity_masks.data();
+        size_t syndrome = 0;
+
+        for (size_t i = 0; i < m_check_bits; ++i, mask += sw)
+        {
+            uint64_t acc = 0;
+
+            for (size_t w = 0; w < sw; ++w)
+                acc ^= stored[w] & mask[w];
+
+            syndrome |= static_cast<size_t>(parity64(acc)) << i;
+        }
+
+        return syndrome;
+    }
+
+
+    // DW / SW: data / stored words, or 0 to use the code's
+    template <size_t DW, size_t SW>
+    void encode_kernel(const uint64_t* data, size_t count, uint64_t* encoded) const
+    {
+        const auto dw = DW != 0 ? DW : m_data_words;
+        const auto sw = SW != 0 ? SW : m_stored_words;
+
+        const auto* pieces = m_pieces.data();
+        const auto piece_count = m_pieces.size();
+        uint64_t stored[SW != 0 ? SW : MAX_STORED_WORDS];
+
+        // built on the stack rather than in encoded, which the compiler would have to assume aliases the pieces
+        for (size_t i = 0; i < count; ++i, data += dw, encoded += sw)
+        {
+            std::fill(stored, stored + sw, 0);
+
+            // the pieces only read the code's data bits
+            for (size_t p = 0; p < piece_count; ++p)
+                stored[pieces[p].stored_word] |= ((data[pieces[p].data_word] >> pieces[p].data_shift) & pieces[p].mask) << pieces[p].stored_shift;
+
+            // ORed in without branching on the data: these are as good as random, so branches mispredict
+            stored[0] |= uint64_t(words_parity(stored, sw)) << EXTENDED_PARITY_POSITION;
+
+            // check bit i sits at 2^i - 1, which no other check covers
+            const auto syndrome = compute_syndrome<SW>(stored);
+
+            for (size_t c = 0; c < m_check_bits; ++c)
+            {
+                const auto position = (size_t(1) << c) - 1;
+
+                stored[position / WORD_BITS] |= uint64_t((syndrome >> c) & 1) << (position % WORD_BITS);
+            }
+
+            std::copy(stored, stored + sw, encoded);
+        }
+    }
+
+
+    // data bits of a corrected codeword; returns whether the extended parity bit disagrees with them
+    template <size_t DW>
+    bool fetch_data(const uint64_t* stored, uint64_t* data) const
+    {
+        const auto dw = DW != 0 ? DW : m_data_words;
+
+        std::fill(data, data + dw, 0);
+
+        for (const auto& piece : m_pieces)
+            data[piece.data_word] |= ((stored[piece.stored_word] >> piece.stored_shift) & piece.mask) << piece.data_shift;
+
+        return ((stored[0] >> EXTENDED_PARITY_POSITION) & 1) != words_parity(data, dw);
+    }
+
+
+    // see HammingCode::decode_words
+    template <size_t DW, size_t SW>
+    void decode_kernel(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const
+    {
+        const auto dw = DW != 0 ? DW : m_data_words;
+        const auto sw = SW != 0 ? SW : m_stored_words;
+        uint64_t stored[SW != 0 ? SW : MAX_STORED_WORDS];
+
+        for (size_t i = 0; i < count; ++i, encoded += sw, data += dw)
+        {
+            std::copy(encoded, encoded + sw, stored);
+            stored[sw - 1] &= m_last_stored_mask;
+
+            const auto syndrome = compute_syndrome<SW>(stored);
+            const auto corrupt_idx = m_syndrome_table[syndrome];
+
+            if (corrupt_idx != NO_POSITION)
+                flip_word_bit(stored, corrupt_idx);
+
+            const auto de = fetch_data<DW>(stored, data);
+
+            if (syndrome == 0)
+                status[i] = de ? DECODE_UNCORRECTABLE : DECODE_CLEAN;
+            else if (!de)
+                status[i] = DECODE_ERROR_DETECTED | DECODE_CORRECTED;
+            else
+            {
+                // correction was meaningless, so return the data as stored
+                if (corrupt_idx != NO_POSITION)
+                    flip_word_bit(stored, corrupt_idx);
+
+                fetch_data<DW>(stored, data);
+                status[i] = DECODE_ERROR_DETECTED | DECODE_UNCORRECTABLE;
+            }
+        }
+    }
+
+public:
+    explicit RuntimeHammingCode(size_t data_bits)
+        : RuntimeCode(data_bits, data_bits + 1 + calc_hamming_code_check_bits(data_bits + 1)),
+          m_check_bits(calc_hamming_code_check_bits(data_bits + 1)),
+          m_parity_masks(m_check_bits * m_stored_words, 0),
+          m_syndrome_table(size_t(1) << m_check_bits, NO_POSITION),
+          m_kernels(RuntimeKernelSelect<RuntimeHammingCode>::pick(m_data_words, m_stored_words))
+    {
+        // see make_hamming_parity_masks, make_hamming_syndrome_table and make_hamming_data_runs
+        for (size_t i = 0; i < m_check_bits; ++i)
+            for (size_t position = 0; position < m_total_bits; ++position)
+                if (((position + 1) >> i) & 1)
+                    m_parity_masks[i * m_stored_words + position / 64] |= uint64_t(1) << (position % 64);
+
+        for (size_t syndrome = 1; syndrome < m_syndrome_table.size() && syndrome <= m_total_bits; ++syndrome)
+            m_syndrome_table[syndrome] = static_cast<uint32_t>(syndrome - 1);
+
+        // extended data bit e is data bit e - 1; e = 0 is the extended parity bit
+        size_t extended_offset = 0;
+
+        for (size_t k = 1; k < m_check_bits; ++k)
+        {
+            const auto start = size_t(1) << k;
+            const auto end = std::min((size_t(1) << (k + 1)) - 1, m_total_bits);
+            const auto skip = extended_offset == 0 ? 1 : 0;
+
+            add_pieces(extended_offset + skip - 1, start + skip, end - start - skip);
+            extended_offset += end - start;
+        }
+    }
+
+
+    void encode_batch(const uint64_t* data, size_t count, uint64_t* encoded) const override
+    {
+        (this->*m_kernels.encode)(data, count, encoded);
+    }
+
+
+    void decode_batch(const uint64_t* encoded, size_t count, uint64_t* data, uint8_t* status) const override
+    {
+        (this->*m_kernels.decode)(encoded, count, data, status);
+    }
+};
+
+
+// "parity" or "hamming" of data_bits bits, or nullptr for an unknown name or unsupported width
+inline std::unique_ptr<RuntimeCode> make_runtime_code(const std::string& name, size_t data_bits)
+{
+    if (!RuntimeCode::supports(data_bits))
+        return nullptr;
+
+    if (name == "parity")
+        return std::unique_ptr<RuntimeCode>(new RuntimeParityBit(data_bits));
+
+    if (name == "hamming")
+        return std::unique_ptr<RuntimeCode>(new RuntimeHammingCode(data_bits));
+
+    return nullptr;
+}
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end RuntimeCode.h
+ *///////////////////////////////////////////////////////////////////////////*/
@@ -0,0 +1,279 @@
+/*-----------------------------------------------------------------------------
+ * Scrubber.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "ChunkArray.h"
+#include "ThreadPool.h"
+
+
+/*
+ * Walks a ChunkArray decoding every codeword and writing corrected ones back, so single bit
+ * errors get repaired before a second one lands in the same codeword and makes it
+ * uncorrectable. Codewords that can't be corrected are counted but left alone.
+ *
+ * The region is scrubbed in slices spread over a ThreadPool. Slices are handed out at a rate
+ * that keeps within a bytes (of data) per second budget, so scrubbing doesn't crowd out
+ * foreground work; pacing is done by the thread driving the pass, never by sleeping workers,
+ * and stop() cuts a wait short.
+ *
+ * Every slice has a lock, held while the slice is scrubbed. Scrubber::read / write take the
+ * locks of the slices they touch, so a write-back can't put a stale codeword over newer data.
+ * While a scrubber exists, access the region through it: ChunkArray::read / write directly
+ * are not synchronized with scrubbing
+ */
+template <class Strategy>
+class Scrubber
+{
+public:
+    typedef ChunkArray<Strategy> Region_t;
+
+    // chunks per slice. A multiple of 64, so every slice starts on a storage word boundary and
+    // concurrent write-backs to neighbouring slices never touch the same word
+    static constexpr size_t SLICE_CHUNKS = 1024;
+
+    // monitoring snapshot
+    struct Stats
+    {
+        uint64_t passes;            // completed passes
+        uint64_t chunks_scrubbed;   // over all passes
+        uint64_t corrected;         // codewords corrected and written back
+        uint64_t uncorrectable;     // codewords found with an error that couldn't be corrected
+        double pass_progress;       // fraction of the current pass done, 0 to 1
+    };
+
+
+private:
+    Region_t& m_region;
+    ThreadPool& m_pool;
+
+    std::atomic<uint64_t> m_bytes_per_second;   // 0 = unlimited
+    std::chrono::steady_clock::time_point m_next_slot;
+
+    std::atomic<uint64_t> m_passes;
+    std::atomic<uint64_t> m_chunks_scrubbed;
+    std::atomic<uint64_t> m_corrected;
+    std::atomic<uint64_t> m_uncorrectable;
+    std::atomic<uint64_t> m_pass_chunks;        // chunks done in the current pass
+
+    std::unique_ptr<std::mutex[]> m_slice_locks;   // one per slice
+
+    std::thread m_background;
+    std::atomic<bool> m_stop;
+    std::mutex m_stop_lock;                     // guards the throttle wait on m_stop_signal
+    std::condition_variable m_stop_signal;
+
+
+    size_t slice_count() const
+    {
+        return (m_region.chunk_count() + SLICE_CHUNKS - 1) / SLICE_CHUNKS;
+    }
+
+
+    // the slices holding bytes [offset, offset + len) (len > 0), locked in order
+    void lock_slices(size_t offset, size_t len)
+    {
+        const auto last = (offset + len - 1) / Region_t::DATA_BYTES_PER_CHUNK / SLICE_CHUNKS;
+
+        for (auto slice = offset / Region_t::DATA_BYTES_PER_CHUNK / SLICE_CHUNKS; slice <= last; ++slice)
+            m_slice_locks[slice].lock();
+    }
+
+    void unlock_slices(size_t offset, size_t len)
+    {
+        const auto last = (offset + len - 1) / Region_t::DATA_BYTES_PER_CHUNK / SLICE_CHUNKS;
+
+        for (auto slice = offset / Region_t::DATA_BYTES_PER_CHUNK / SLICE_CHUNKS; slice <= last; ++slice)
+            m_slice_locks[slice].unlock();
+    }
+
+
+    void scrub_slice(size_t first, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m_slice_locks[first / SLICE_CHUNKS]);
+
+        const auto result = m_region.repair(first, count, true, [](size_t, uint8_t) {});
+
+        m_corrected.fetch_add(result.corrected, std::memory_order_relaxed);
+        m_uncorrectable.fetch_add(result.uncorrectable, std::memory_order_relaxed);
+        m_chunks_scrubbed.fetch_add(count, std::memory_order_relaxed);
+        m_pass_chunks.fetch_add(count, std::memory_order_relaxed);
+    }
+
+
+    // blocks until bytes more may be scrubbed under the budget. False if stop() was called
+    bool throttle(size_t bytes)
+    {
+        const auto rate = m_bytes_per_second.load(std::memory_order_relaxed);
+        const auto now = std::chrono::steady_clock::now();
+
+        if (rate == 0)
+        {
+            m_next_slot = now;
+            return !m_stop.load(std::memory_order_relaxed);
+        }
+
+        // after idling, start from now rather than bursting to catch up
+        if (m_next_slot < now)
+            m_next_slot = now;
+
+        const auto start = m_next_slot;
+
+        m_next_slot += std::chrono::nanoseconds(static_cast<int64_t>(bytes * 1e9 / rate));
+
+        std::unique_lock<std::mutex> lock(m_stop_lock);
+
+        return !m_stop_signal.wait_until(lock, start, [this] { return m_stop.load(std::memory_order_relaxed); });
+    }
+
+
+public:
+    Scrubber(Region_t& region, ThreadPool& pool, uint64_t bytes_per_second = 0)
+        : m_region(region), m_pool(pool), m_bytes_per_second(bytes_per_second),
+          m_next_slot(std::chrono::steady_clock::now()),
+          m_passes(0), m_chunks_scrubbed(0), m_corrected(0), m_uncorrectable(0), m_pass_chunks(0),
+          m_slice_locks(new std::mutex[slice_count()]), m_stop(false)
+    {
+    }
+
+    ~Scrubber()
+    {
+        stop();
+    }
+
+    Scrubber(const Scrubber&) = delete;
+    Scrubber& operator=(const Scrubber&) = delete;
+
+
+    // may be changed while scrubbing; 0 = as fast as the pool allows
+    void set_rate(uint64_t bytes_per_second)
+    {
+        m_bytes_per_second.store(bytes_per_second, std::memory_order_relaxed);
+    }
+
+    uint64_t rate() const
+    {
+        return m_bytes_per_second.load(std::memory_order_relaxed);
+    }
+
+
+    // ChunkArray::read / write, synchronized with scrubbing (see above)
+    typename Region_t::AccessResult read(size_t offset, size_t len, uint8_t* buf)
+    {
+        if (len == 0)
+            return typename Region_t::AccessResult();
+
+        lock_slices(offset, len);
+        const auto result = m_region.read(offset, len, buf);
+        unlock_slices(offset, len);
+
+        return result;
+    }
+
+    typename Region_t::AccessResult write(size_t offset, const uint8_t* buf, size_t len)
+    {
+        if (len == 0)
+            return typename Region_t::AccessResult();
+
+        lock_slices(offset, len);
+        const auto result = m_region.write(offset, buf, len);
+        unlock_slices(offset, len);
+
+        return result;
+    }
+
+
+    // scrubs the whole region once, on the pool and the calling thread. Returns early (without
+    // counting the pass) if stop() is called meanwhile. Only one pass may run at a time
+    void scrub_pass()
+    {
+        const auto num_slices = slice_count();
+
+        // slices handed out per round, one per thread
+        const auto round = m_pool.size() + 1;
+
+        m_pass_chunks.store(0, std::memory_order_relaxed);
+
+        for (size_t slice = 0; slice < num_slices; slice += round)
+        {
+            if (m_stop.load(std::memory_order_relaxed))
+                return;
+
+            const auto slices = std::min(round, num_slices - slice);
+            const auto first = slice * SLICE_CHUNKS;
+            const auto chunks = std::min(slices * SLICE_CHUNKS, m_region.chunk_count() - first);
+
+            if (!throttle(chunks * Region_t::DATA_BYTES_PER_CHUNK))
+                return;
+
+            m_pool.parallel_for(slices, [&](size_t i)
+            {
+                const auto begin = first + i * SLICE_CHUNKS;
+
+                scrub_slice(begin, std::min(SLICE_CHUNKS, m_region.chunk_count() - begin));
+            });
+        }
+
+        m_passes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    // keeps running passes on a background thread until stop()
+    void start()
+    {
+        if (m_background.joinable())
+            return;
+
+        m_stop.store(false);
+        m_background = std::thread([this]
+        {
+            while (!m_stop.load(std::memory_order_relaxed))
+                scrub_pass();
+        });
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_stop_lock);
+            m_stop.store(true);
+        }
+
+        m_stop_signal.notify_all();
+
+        if (m_background.joinable())
+            m_background.join();
+
+        m_stop.store(false);
+    }
+
+    bool running() const
+    {
+        return m_background.joinable();
+    }
+
+
+    Stats stats() const
+    {
+        Stats s;
+
+        s.passes = m_passes.load(std::memory_order_relaxed);
+        s.chunks_scrubbed = m_chunks_scrubbed.load(std::memory_order_relaxed);
+        s.corrected = m_corrected.load(std::memory_order_relaxed);
+        s.uncorrectable = m_uncorrectable.load(std::memory_order_relaxed);
+        s.pass_progress = m_region.chunk_count() == 0 ? 1.0 :
+            static_cast<double>(m_pass_chunks.load(std::memory_order_relaxed)) / m_region.chunk_count();
+
+        return s;
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end Scrubber.h
+ *///////////////////////////////////////////////////////////////////////////*/
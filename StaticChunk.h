@@ -0,0 +1,151 @@
+/*-----------------------------------------------------------------------------
+ * StaticChunk.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <bitset>
+#include <cassert>
+#include <string>
+#include "BitStream.h"
+#include "CorrectionStrategy.h"
+
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+#include "EccTelemetry.h"
+#endif
+
+
+/*
+ * Represents a chunk of memory, like Chunk, but with the correction strategy picked at compile
+ * time: Strategy is the concrete strategy type (e.g. HammingCode<64>) and is held by value.
+ * encode()/decode() are called non-virtually, so they can be inlined, and copying a chunk
+ * doesn't touch a shared_ptr refcount. Use Chunk when the strategy is only known at runtime
+ */
+template <class Strategy>
+class StaticChunk
+{
+public:
+    static constexpr size_t NumDataBits = Strategy::NUM_DATA_BITS;
+    static constexpr size_t NumEncodedBits = Strategy::NUM_ENCODED_BITS;
+
+    typedef BitStream<NumDataBits> DataBits;
+    typedef BitStream<NumEncodedBits> StoredBits;
+
+
+private:
+
+    // note: first bit is LSB
+    StoredBits m_stored;
+    DataBits m_original; // uncorrupted original data
+    Strategy m_strategy;
+
+
+    // erase this chunk
+    void clear_contents()
+    {
+        m_original = DataBits();
+        m_stored = m_strategy.Strategy::encode(m_original);
+    }
+
+
+
+public:
+    explicit StaticChunk(const Strategy& strategy = Strategy()) : m_strategy(strategy)
+    {
+        clear_contents();
+    }
+
+
+    // allows some type T to be stored in this memory chunk. T doesn't necessarily have to
+    // take up all data bits
+    void store(BitStream<NumDataBits>& bs)
+    {
+        // qualified calls: resolved at compile time rather than through the vtable
+        m_stored = m_strategy.Strategy::encode(bs);
+        m_original = bs;
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        TelemetrySource::count_encode_of<Strategy>();
+#endif
+    }
+
+    // partial write, see Chunk::update
+    uint8_t update(size_t bit_offset, uint64_t new_bits, size_t length)
+    {
+        assert(length <= WORD_BITS && bit_offset + length <= NumDataBits);
+
+        const auto old_bits = read_bitset_bits(m_original, bit_offset, length);
+        uint8_t status = DECODE_CLEAN;
+
+        // a write of every data bit keeps nothing of the old codeword: encode the new one, as store() does
+        if (length == NumDataBits)
+        {
+            flip_bitset_bits(m_original, 0, length, old_bits ^ new_bits);
+            m_stored = m_strategy.Strategy::encode(m_original);
+        }
+        else
+        {
+            status = m_strategy.Strategy::update(m_stored, bit_offset, old_bits, new_bits, length);
+
+            if (!decode_unrepaired(status))
+                flip_bitset_bits(m_original, bit_offset, length, old_bits ^ new_bits);
+        }
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        TelemetrySource::count_encode_of<Strategy>();
+#endif
+
+        return status;
+    }
+
+
+    DecodeResult<NumDataBits, NumEncodedBits> retrieve() const
+    {
+        auto result = m_strategy.Strategy::decode(m_stored);
+
+        // return the actual original data as well, in case error detection has
+        // failed to detect an error and the data is actually corrupt
+        result.original_bits = m_original;
+        result.stored_bits = m_stored;
+
+        result.correct = result.original_bits == result.decoded_bits;
+
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        TelemetrySource::count_decode_of<Strategy>(result.status(), result.correct);
+#endif
+
+        return result;
+    }
+
+
+    // hot path retrieval, see Chunk::retrieve_compact
+    CompactDecodeResult<NumDataBits> retrieve_compact() const
+    {
+#if ECC_TELEMETRY && ECC_TELEMETRY_CHUNKS
+        auto result = m_strategy.Strategy::decode_compact(m_stored);
+
+        TelemetrySource::count_decode_of<Strategy>(result.status, m_original == result.decoded_bits);
+
+        return result;
+#else
+        return m_strategy.Strategy::decode_compact(m_stored);
+#endif
+    }
+
+
+    void corrupt(size_t bit_idx)
+    {
+        m_stored.flip(bit_idx);
+    }
+
+
+    std::string to_string() const
+    {
+        return m_stored.to_string();
+    }
+
+    StoredBits get() const
+    {
+        return BitStream<NumEncodedBits>(m_stored);
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end StaticChunk.h
+ *///////////////////////////////////////////////////////////////////////////*/
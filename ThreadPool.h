@@ -0,0 +1,299 @@
+/*-----------------------------------------------------------------------------
+ * ThreadPool.h
+ *---------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/*
+ * Fixed set of worker threads taking tasks off a shared queue. Long running work (scrubbing,
+ * fault injection) is handed to it through parallel_for, so several users can share one pool
+ * without waiting on each other's tasks
+ */
+class ThreadPool
+{
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_task_ready;
+    bool m_stopping;
+
+
+    // the pool and worker number of the calling thread, if it is a pool worker
+    struct WorkerId
+    {
+        const ThreadPool* pool;
+        size_t index;
+    };
+
+    static WorkerId& current_worker()
+    {
+        static thread_local WorkerId id = { nullptr, 0 };
+        return id;
+    }
+
+
+    void worker_loop(size_t index)
+    {
+        current_worker() = { this, index };
+
+        for (;;)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+
+                m_task_ready.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+
+                // remaining tasks are still run when stopping, so nobody waits on a dropped one
+                if (m_tasks.empty())
+                    return;
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+
+            task();
+        }
+    }
+
+
+public:
+    // num_threads = 0 means one per hardware thread
+    explicit ThreadPool(size_t num_threads = 0) : m_stopping(false)
+    {
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        m_workers.reserve(num_threads);
+
+        for (size_t i = 0; i < num_threads; ++i)
+            m_workers.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+
+        m_task_ready.notify_all();
+
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+
+    size_t size() const
+    {
+        return m_workers.size();
+    }
+
+
+    // the calling thread's number among the workers, [0, size()); size() if it isn't one of them
+    size_t worker_index() const
+    {
+        const auto& id = current_worker();
+
+        return id.pool == this ? id.index : size();
+    }
+
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+
+        m_task_ready.notify_one();
+    }
+
+
+    // calls fn(i) for every i in [0, count) on the workers and the calling thread, returning once
+    // all calls are done. Indices are handed out one at a time, so uneven work balances itself.
+    // Safe to call from a worker: the caller keeps taking indices instead of just blocking
+    template <class Fn>
+    void parallel_for(size_t count, Fn&& fn)
+    {
+        if (count == 0)
+            return;
+
+        struct State
+        {
+            std::atomic<size_t> next{ 0 };
+            std::atomic<size_t> done{ 0 };
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+
+        // shared, since helper tasks may only get to run after parallel_for has returned. Those
+        // find no index left and never touch fn
+        auto state = std::make_shared<State>();
+        auto* body = &fn;
+
+        auto work = [state, count, body]
+        {
+            for (size_t i; (i = state->next.fetch_add(1)) < count;)
+            {
+                (*body)(i);
+
+                if (state->done.fetch_add(1) + 1 == count)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->finished.notify_all();
+                }
+            }
+        };
+
+        const auto helpers = std::min(count - 1, size());
+
+        for (size_t i = 0; i < helpers; ++i)
+            submit(work);
+
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done.load() == count; });
+    }
+
+
+    // same contract as parallel_for (count < 2^32), but every thread starts on its own contiguous
+    // range of indices and only touches shared state once it runs dry: it then steals the upper
+    // half of the biggest range left. Suits many cheap, evenly sized calls, where a shared
+    // counter would be contended on every index.
+    //
+    // Worker i starts on range i and the calling thread on the last one (unless they are taken, as
+    // when the caller is a worker itself), so calls with the same count start every worker on the
+    // same indices each time. Which ones it ends up running still depends on who steals what
+    template <class Fn>
+    void parallel_for_stealing(size_t count, Fn&& fn)
+    {
+        if (count == 0)
+            return;
+
+        assert(count <= 0xFFFFFFFFull);
+
+        // [lo, hi) of one thread, packed as hi << 32 | lo so it can be updated with a single CAS
+        struct alignas(64) Range
+        {
+            std::atomic<uint64_t> packed{ 0 };
+        };
+
+        struct State
+        {
+            std::unique_ptr<Range[]> ranges;
+            std::unique_ptr<std::atomic<bool>[]> claimed;
+            size_t num_ranges = 0;
+            std::atomic<size_t> done{ 0 };
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+
+        const auto pack = [](uint64_t lo, uint64_t hi) { return hi << 32 | lo; };
+
+        auto state = std::make_shared<State>();
+        auto* body = &fn;
+
+        state->num_ranges = std::min(count, size() + 1);
+        state->ranges.reset(new Range[state->num_ranges]);
+        state->claimed.reset(new std::atomic<bool>[state->num_ranges]);
+
+        for (size_t i = 0; i < state->num_ranges; ++i)
+        {
+            state->ranges[i].packed.store(pack(count * i / state->num_ranges, count * (i + 1) / state->num_ranges));
+            state->claimed[i].store(false);
+        }
+
+        auto work = [this, state, count, body, pack]
+        {
+            // there are as many ranges as calls of work, so one is always left
+            auto self = std::min(worker_index(), state->num_ranges - 1);
+
+            if (state->claimed[self].exchange(true))
+                for (self = 0; state->claimed[self].exchange(true); ++self)
+                    assert(self + 1 < state->num_ranges);
+
+            auto& own = state->ranges[self].packed;
+
+            for (;;)
+            {
+                auto range = own.load();
+                const auto lo = range & 0xFFFFFFFF;
+                const auto hi = range >> 32;
+
+                if (lo < hi)
+                {
+                    if (!own.compare_exchange_weak(range, pack(lo + 1, hi)))
+                        continue;
+
+                    (*body)(static_cast<size_t>(lo));
+
+                    if (state->done.fetch_add(1) + 1 == count)
+                    {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->finished.notify_all();
+                    }
+
+                    continue;
+                }
+
+                // own range is empty: steal the upper half of the largest one left. Nobody else
+                // writes an empty range, and indices never return to one, so a plain store is safe
+                size_t victim = self;
+                uint64_t victim_range = 0;
+                uint64_t largest = 0;
+
+                for (size_t i = 0; i < state->num_ranges; ++i)
+                {
+                    const auto r = state->ranges[i].packed.load();
+                    const auto left = (r >> 32) - (r & 0xFFFFFFFF);
+
+                    if ((r >> 32) > (r & 0xFFFFFFFF) && left > largest)
+                    {
+                        victim = i;
+                        victim_range = r;
+                        largest = left;
+                    }
+                }
+
+                if (largest == 0)
+                    return;
+
+                const auto v_lo = victim_range & 0xFFFFFFFF;
+                const auto v_hi = victim_range >> 32;
+                const auto mid = v_lo + (v_hi - v_lo) / 2;
+
+                if (state->ranges[victim].packed.compare_exchange_strong(victim_range, pack(v_lo, mid)))
+                    own.store(pack(mid, v_hi));
+            }
+        };
+
+        for (size_t i = 1; i < state->num_ranges; ++i)
+            submit(work);
+
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done.load() == count; });
+    }
+};
+
+/*/////////////////////////////////////////////////////////////////////////////
+ * end ThreadPool.h
+ *///////////////////////////////////////////////////////////////////////////*/